@@ -36,6 +36,9 @@ struct rw_semaphore {
 #define RWSEM_ACTIVE_WRITE_BIAS		(RWSEM_WAITING_BIAS + RWSEM_ACTIVE_BIAS)
 	spinlock_t		wait_lock;
 	struct list_head	wait_list;
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	struct thread_info	*owner;
+#endif
 };
 
 #define __RWSEM_INITIALIZER(name) \
@@ -50,6 +53,9 @@ static inline void init_rwsem(struct rw_semaphore *sem)
 	sem->count = RWSEM_UNLOCKED_VALUE;
 	spin_lock_init(&sem->wait_lock);
 	INIT_LIST_HEAD(&sem->wait_list);
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	sem->owner = NULL;
+#endif
 }
 
 static inline void __down_read(struct rw_semaphore *sem)
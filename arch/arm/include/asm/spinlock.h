@@ -21,6 +21,13 @@ static inline void dsb_sev(void)
 #endif
 }
 
+#ifdef CONFIG_QUEUED_SPINLOCKS
+/*
+ * Contended spinlocks queue up on per-cpu nodes instead of all spinning
+ * on the lock word; the generic code builds on the ldrex/strex atomics.
+ */
+#include <asm-generic/qspinlock.h>
+#else
 /*
  * ARMv6 Spin-locking.
  *
@@ -91,6 +98,7 @@ static inline void arch_spin_unlock(arch_spinlock_t *lock)
 
 	dsb_sev();
 }
+#endif /* CONFIG_QUEUED_SPINLOCKS */
 
 /*
  * RWLOCKS
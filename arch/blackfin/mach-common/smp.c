@@ -141,6 +141,7 @@ static irqreturn_t ipi_handler_int0(int irq, void *dev_instance)
 	unsigned int cpu = smp_processor_id();
 
 	platform_clear_ipi(cpu, IRQ_SUPPLE_0);
+	scheduler_ipi();
 	return IRQ_HANDLED;
 }
 
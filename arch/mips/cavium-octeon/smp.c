@@ -42,6 +42,8 @@ static irqreturn_t mailbox_interrupt(int irq, void *dev_id)
 	/* Clear the mailbox to clear the interrupt */
 	cvmx_write_csr(CVMX_CIU_MBOX_CLRX(coreid), action);
 
+	if (action & SMP_RESCHEDULE_YOURSELF)
+		scheduler_ipi();
 	if (action & SMP_CALL_FUNCTION)
 		smp_call_function_interrupt();
 
@@ -33,8 +33,6 @@
 
 #include "mmu_decl.h"
 
-DEFINE_PER_CPU(struct mmu_gather, mmu_gathers);
-
 #ifdef CONFIG_SMP
 
 /*
@@ -97,21 +95,24 @@ static void pte_free_submit(struct pte_freelist_batch *batch)
 
 void pgtable_free_tlb(struct mmu_gather *tlb, void *table, unsigned shift)
 {
-	/* This is safe since tlb_gather_mmu has disabled preemption */
-	struct pte_freelist_batch **batchp = &__get_cpu_var(pte_freelist_cur);
+	/*
+	 * The mmu_gather no longer disables preemption, so pin the cpu while
+	 * we play with its batch.
+	 */
+	struct pte_freelist_batch **batchp = &get_cpu_var(pte_freelist_cur);
 	unsigned long pgf;
 
 	if (atomic_read(&tlb->mm->mm_users) < 2 ||
 	    cpumask_equal(mm_cpumask(tlb->mm), cpumask_of(smp_processor_id()))){
 		pgtable_free(table, shift);
-		return;
+		goto out;
 	}
 
 	if (*batchp == NULL) {
 		*batchp = (struct pte_freelist_batch *)__get_free_page(GFP_ATOMIC);
 		if (*batchp == NULL) {
 			pgtable_free_now(table, shift);
-			return;
+			goto out;
 		}
 		(*batchp)->index = 0;
 	}
@@ -122,17 +123,19 @@ void pgtable_free_tlb(struct mmu_gather *tlb, void *table, unsigned shift)
 		pte_free_submit(*batchp);
 		*batchp = NULL;
 	}
+out:
+	put_cpu_var(pte_freelist_cur);
 }
 
 void pte_free_finish(void)
 {
-	/* This is safe since tlb_gather_mmu has disabled preemption */
-	struct pte_freelist_batch **batchp = &__get_cpu_var(pte_freelist_cur);
+	struct pte_freelist_batch **batchp = &get_cpu_var(pte_freelist_cur);
 
-	if (*batchp == NULL)
-		return;
-	pte_free_submit(*batchp);
-	*batchp = NULL;
+	if (*batchp != NULL) {
+		pte_free_submit(*batchp);
+		*batchp = NULL;
+	}
+	put_cpu_var(pte_freelist_cur);
 }
 
 #endif /* CONFIG_SMP */
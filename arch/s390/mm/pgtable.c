@@ -36,7 +36,6 @@ struct rcu_table_freelist {
 	((PAGE_SIZE - sizeof(struct rcu_table_freelist)) \
 	  / sizeof(unsigned long))
 
-DEFINE_PER_CPU(struct mmu_gather, mmu_gathers);
 static DEFINE_PER_CPU(struct rcu_table_freelist *, rcu_table_freelist);
 
 static void __page_table_free(struct mm_struct *mm, unsigned long *table);
@@ -71,7 +70,7 @@ static void rcu_table_freelist_callback(struct rcu_head *head)
 	free_page((unsigned long) batch);
 }
 
-void rcu_table_freelist_finish(void)
+static void __rcu_table_freelist_finish(void)
 {
 	struct rcu_table_freelist *batch = __get_cpu_var(rcu_table_freelist);
 
@@ -81,6 +80,13 @@ void rcu_table_freelist_finish(void)
 	__get_cpu_var(rcu_table_freelist) = NULL;
 }
 
+void rcu_table_freelist_finish(void)
+{
+	preempt_disable();
+	__rcu_table_freelist_finish();
+	preempt_enable();
+}
+
 static void smp_sync(void *arg)
 {
 }
@@ -173,20 +179,24 @@ void crst_table_free_rcu(struct mm_struct *mm, unsigned long *table)
 	spin_lock_bh(&mm->context.list_lock);
 	list_del(&page->lru);
 	spin_unlock_bh(&mm->context.list_lock);
+	/* The mmu_gather is preemptible, pin the cpu and its freelist */
+	preempt_disable();
 	if (atomic_read(&mm->mm_users) < 2 &&
 	    cpumask_equal(mm_cpumask(mm), cpumask_of(smp_processor_id()))) {
 		__crst_table_free(mm, table);
-		return;
+		goto out;
 	}
 	batch = rcu_table_freelist_get(mm);
 	if (!batch) {
 		smp_call_function(smp_sync, NULL, 1);
 		__crst_table_free(mm, table);
-		return;
+		goto out;
 	}
 	batch->table[--batch->crst_index] = table;
 	if (batch->pgt_index >= batch->crst_index)
-		rcu_table_freelist_finish();
+		__rcu_table_freelist_finish();
+out:
+	preempt_enable();
 }
 
 #ifdef CONFIG_64BIT
@@ -355,16 +365,18 @@ void page_table_free_rcu(struct mm_struct *mm, unsigned long *table)
 	struct page *page;
 	unsigned long bits;
 
+	/* The mmu_gather is preemptible, pin the cpu and its freelist */
+	preempt_disable();
 	if (atomic_read(&mm->mm_users) < 2 &&
 	    cpumask_equal(mm_cpumask(mm), cpumask_of(smp_processor_id()))) {
 		page_table_free(mm, table);
-		return;
+		goto out;
 	}
 	batch = rcu_table_freelist_get(mm);
 	if (!batch) {
 		smp_call_function(smp_sync, NULL, 1);
 		page_table_free(mm, table);
-		return;
+		goto out;
 	}
 	bits = (mm->context.noexec || mm->context.has_pgste) ? 3UL : 1UL;
 	bits <<= (__pa(table) & (PAGE_SIZE - 1)) / 256 / sizeof(unsigned long);
@@ -376,7 +388,9 @@ void page_table_free_rcu(struct mm_struct *mm, unsigned long *table)
 	table = (unsigned long *)(((unsigned long) table) | bits);
 	batch->table[batch->pgt_index++] = table;
 	if (batch->pgt_index >= batch->crst_index)
-		rcu_table_freelist_finish();
+		__rcu_table_freelist_finish();
+out:
+	preempt_enable();
 }
 
 void disable_noexec(struct mm_struct *mm, struct task_struct *tsk)
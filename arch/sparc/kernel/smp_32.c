@@ -227,6 +227,7 @@ void smp_flush_tlb_page(struct vm_area_struct *vma, unsigned long page)
 void smp_reschedule_irq(void)
 {
 	set_need_resched();
+	scheduler_ipi();
 }
 
 void smp_flush_page_to_ram(unsigned long page)
@@ -19,6 +19,7 @@
 #include <linux/io.h>
 #include <linux/irq.h>
 #include <linux/module.h>
+#include <linux/sched.h>
 #include <asm/cacheflush.h>
 
 HV_Topology smp_topology __write_once;
@@ -185,11 +186,12 @@ void flush_icache_range(unsigned long start, unsigned long end)
 static irqreturn_t handle_reschedule_ipi(int irq, void *token)
 {
 	/*
-	 * Nothing to do here; when we return from interrupt, the
-	 * rescheduling will occur there. But do bump the interrupt
-	 * profiler count in the meantime.
+	 * Process any queued remote wakeups; when we return from
+	 * interrupt, the rescheduling will occur there.  Bump the
+	 * interrupt profiler count in the meantime.
 	 */
 	__get_cpu_var(irq_stat).irq_resched_count++;
+	scheduler_ipi();
 
 	return IRQ_HANDLED;
 }
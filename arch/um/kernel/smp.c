@@ -7,9 +7,6 @@
 #include "asm/pgalloc.h"
 #include "asm/tlb.h"
 
-/* For some reason, mmu_gathers are referenced when CONFIG_SMP is off. */
-DEFINE_PER_CPU(struct mmu_gather, mmu_gathers);
-
 #ifdef CONFIG_SMP
 
 #include "linux/sched.h"
@@ -174,6 +171,7 @@ void IPI_handler(int cpu)
 
 		case 'R':
 			set_tsk_need_resched(current);
+			scheduler_ipi();
 			break;
 
 		case 'S':
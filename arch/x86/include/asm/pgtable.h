@@ -102,6 +102,11 @@ static inline int pmd_young(pmd_t pmd)
 	return pmd_flags(pmd) & _PAGE_ACCESSED;
 }
 
+static inline int pmd_dirty(pmd_t pmd)
+{
+	return pmd_flags(pmd) & _PAGE_DIRTY;
+}
+
 static inline int pte_write(pte_t pte)
 {
 	return pte_flags(pte) & _PAGE_RW;
@@ -350,6 +355,8 @@ static inline pgprot_t pgprot_modify(pgprot_t oldprot, pgprot_t newprot)
 }
 
 #define pte_pgprot(x) __pgprot(pte_flags(x) & PTE_FLAGS_MASK)
+/* protection for the ptes that replace a huge pmd */
+#define pmd_pgprot(x) __pgprot(pmd_flags(x) & ~(_PAGE_PSE | _PAGE_SPLITTING))
 
 #define canon_pgprot(p) __pgprot(massage_pgprot(p))
 
@@ -413,6 +420,33 @@ static inline int pte_hidden(pte_t pte)
 	return pte_flags(pte) & _PAGE_HIDDEN;
 }
 
+#ifdef CONFIG_NUMA_BALANCING
+/*
+ * NUMA hinting ptes reuse the PROT_NONE encoding: the hardware sees them
+ * as not present, so any access faults, but they are pte_present() for
+ * the rest of mm.  A PROT_NONE vma never gets past access_error() in the
+ * fault path, so a fault on such a pte in an accessible vma can only be
+ * a hinting fault.
+ */
+static inline int pte_numa(pte_t pte)
+{
+	return (pte_flags(pte) & (_PAGE_PROTNONE | _PAGE_PRESENT)) ==
+		_PAGE_PROTNONE;
+}
+
+static inline pte_t pte_mknuma(pte_t pte)
+{
+	pte = pte_clear_flags(pte, _PAGE_PRESENT);
+	return pte_set_flags(pte, _PAGE_PROTNONE);
+}
+
+static inline pte_t pte_mknonnuma(pte_t pte)
+{
+	pte = pte_clear_flags(pte, _PAGE_PROTNONE);
+	return pte_set_flags(pte, _PAGE_PRESENT | _PAGE_ACCESSED);
+}
+#endif
+
 static inline int pmd_present(pmd_t pmd)
 {
 	return pmd_flags(pmd) & _PAGE_PRESENT;
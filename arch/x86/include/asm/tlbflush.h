@@ -145,6 +145,10 @@ static inline void flush_tlb_range(struct vm_area_struct *vma,
 void native_flush_tlb_others(const struct cpumask *cpumask,
 			     struct mm_struct *mm, unsigned long va);
 
+#ifdef CONFIG_ARCH_WANT_BATCHED_UNMAP_TLB_FLUSH
+extern void arch_tlbbatch_flush(const struct cpumask *cpumask);
+#endif
+
 #define TLBSTATE_OK	1
 #define TLBSTATE_LAZY	2
 
@@ -669,6 +669,10 @@ __SYSCALL(__NR_fanotify_init, sys_fanotify_init)
 __SYSCALL(__NR_fanotify_mark, sys_fanotify_mark)
 #define __NR_prlimit64				302
 __SYSCALL(__NR_prlimit64, sys_prlimit64)
+#define __NR_sched_setattr			303
+__SYSCALL(__NR_sched_setattr, sys_sched_setattr)
+#define __NR_sched_getattr			304
+__SYSCALL(__NR_sched_getattr, sys_sched_getattr)
 
 #ifndef __NO_STUBS
 #define __ARCH_WANT_OLD_READDIR
@@ -37,6 +37,10 @@ EXPORT_SYMBOL(clear_page);
 
 EXPORT_SYMBOL(csum_partial);
 
+/* Fallback for this_cpu_cmpxchg_double() on cpus without cmpxchg16b */
+extern void this_cpu_cmpxchg16b_emu(void);
+EXPORT_SYMBOL(this_cpu_cmpxchg16b_emu);
+
 /*
  * Export string functions. We normally rely on gcc builtin for most of these,
  * but gcc sometimes decides not to inline them.
@@ -323,6 +323,32 @@ void flush_tlb_page(struct vm_area_struct *vma, unsigned long va)
 	preempt_enable();
 }
 
+#ifdef CONFIG_ARCH_WANT_BATCHED_UNMAP_TLB_FLUSH
+static void do_flush_tlb_batched(void *info)
+{
+	local_flush_tlb();
+	if (percpu_read(cpu_tlbstate.state) == TLBSTATE_LAZY)
+		leave_mm(smp_processor_id());
+}
+
+/*
+ * Reclaim unmaps pages from many mms without flushing each pte and
+ * collects the cpus those mms were running on.  Flush them all at once;
+ * the entries may belong to any mm, so this flushes every non-global
+ * entry instead of looking at the active mm.
+ */
+void arch_tlbbatch_flush(const struct cpumask *cpumask)
+{
+	int cpu = get_cpu();
+
+	if (cpumask_test_cpu(cpu, cpumask))
+		do_flush_tlb_batched(NULL);
+	if (cpumask_any_but(cpumask, cpu) < nr_cpu_ids)
+		smp_call_function_many(cpumask, do_flush_tlb_batched, NULL, 1);
+	put_cpu();
+}
+#endif
+
 static void do_flush_tlb_all(void *info)
 {
 	__flush_tlb_all();
@@ -274,6 +274,8 @@ int register_node(struct node *node, int num, struct node *parent)
 
 		scan_unevictable_register_node(node);
 
+		kswapd_register_node(node);
+
 		hugetlb_register_node(node);
 
 		compaction_register_node(node);
@@ -298,6 +300,7 @@ void unregister_node(struct node *node)
 	sysdev_remove_file(&node->sysdev, &attr_vmstat);
 
 	scan_unevictable_unregister_node(node);
+	kswapd_unregister_node(node);
 	hugetlb_unregister_node(node);		/* no-op, if memoryless node */
 
 	sysdev_unregister(&node->sysdev);
@@ -104,16 +104,36 @@ static void give_pages(struct virtnet_info *vi, struct page *page)
 	vi->pages = page;
 }
 
+/*
+ * Refill the chain in one go when it runs dry, a big packet buffer takes
+ * MAX_SKB_FRAGS + 2 pages anyway.
+ */
+static void refill_pages(struct virtnet_info *vi, gfp_t gfp_mask)
+{
+	struct page *page, *next;
+	LIST_HEAD(list);
+
+	alloc_pages_bulk_list(gfp_mask, MAX_SKB_FRAGS + 2, &list);
+	list_for_each_entry_safe(page, next, &list, lru) {
+		list_del(&page->lru);
+		page->private = (unsigned long)vi->pages;
+		vi->pages = page;
+	}
+}
+
 static struct page *get_a_page(struct virtnet_info *vi, gfp_t gfp_mask)
 {
-	struct page *p = vi->pages;
+	struct page *p;
+
+	if (!vi->pages)
+		refill_pages(vi, gfp_mask);
 
+	p = vi->pages;
 	if (p) {
 		vi->pages = (struct page *)p->private;
 		/* clear private here, it is used to chain pages */
 		p->private = 0;
-	} else
-		p = alloc_page(gfp_mask);
+	}
 	return p;
 }
 
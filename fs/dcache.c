@@ -35,6 +35,7 @@
 #include <linux/hardirq.h>
 #include <linux/bit_spinlock.h>
 #include <linux/rculist_bl.h>
+#include <linux/memcontrol.h>
 #include "internal.h"
 
 /*
@@ -47,10 +48,11 @@
  *   - the s_anon list (see __d_drop)
  * dcache_lru_lock protects:
  *   - the dcache lru lists and counters
+ *   - the memcg dentry lru lists and counters
  * d_lock protects:
  *   - d_flags
  *   - d_name
- *   - d_lru
+ *   - d_lru, d_memcg_lru
  *   - d_count
  *   - d_unhashed()
  *   - d_parent and d_subdirs
@@ -64,6 +66,9 @@
  *     dcache_hash_bucket lock
  *     s_anon lock
  *
+ * dcache_lru_lock
+ *   sb_lock
+ *
  * If there is an ancestor relationship:
  * dentry->d_parent->...->d_parent->d_lock
  *   ...
@@ -236,6 +241,43 @@ static void dentry_unlink_inode(struct dentry * dentry)
 		iput(inode);
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+/*
+ * An unused dentry is also on the lru list of the memcg it is charged
+ * to, if any, so that memcg reclaim can prune it without walking the
+ * whole dcache.
+ */
+static inline void dentry_memcg_lru_add(struct dentry *dentry)
+{
+	mem_cgroup_kmem_lru_add(dentry, &dentry->d_memcg_lru,
+				MEM_CGROUP_KMEM_DENTRY_LRU);
+}
+
+static inline void dentry_memcg_lru_del(struct dentry *dentry)
+{
+	mem_cgroup_kmem_lru_del(dentry, &dentry->d_memcg_lru,
+				MEM_CGROUP_KMEM_DENTRY_LRU);
+}
+
+static inline void dentry_memcg_lru_move_tail(struct dentry *dentry)
+{
+	mem_cgroup_kmem_lru_move_tail(dentry, &dentry->d_memcg_lru,
+				      MEM_CGROUP_KMEM_DENTRY_LRU);
+}
+#else
+static inline void dentry_memcg_lru_add(struct dentry *dentry)
+{
+}
+
+static inline void dentry_memcg_lru_del(struct dentry *dentry)
+{
+}
+
+static inline void dentry_memcg_lru_move_tail(struct dentry *dentry)
+{
+}
+#endif
+
 /*
  * dentry_lru_(add|del|move_tail) must be called with d_lock held.
  */
@@ -246,6 +288,7 @@ static void dentry_lru_add(struct dentry *dentry)
 		list_add(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 		dentry->d_sb->s_nr_dentry_unused++;
 		dentry_stat.nr_unused++;
+		dentry_memcg_lru_add(dentry);
 		spin_unlock(&dcache_lru_lock);
 	}
 }
@@ -255,6 +298,7 @@ static void __dentry_lru_del(struct dentry *dentry)
 	list_del_init(&dentry->d_lru);
 	dentry->d_sb->s_nr_dentry_unused--;
 	dentry_stat.nr_unused--;
+	dentry_memcg_lru_del(dentry);
 }
 
 static void dentry_lru_del(struct dentry *dentry)
@@ -276,6 +320,7 @@ static void dentry_lru_move_tail(struct dentry *dentry)
 	} else {
 		list_move_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 	}
+	dentry_memcg_lru_move_tail(dentry);
 	spin_unlock(&dcache_lru_lock);
 }
 
@@ -860,6 +905,121 @@ static void prune_dcache(int count)
 	spin_unlock(&sb_lock);
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+/**
+ * shrink_dcache_memcg_lru - shrink the dentries charged to one memcg
+ * @mem:	memory cgroup whose own dentry LRU to shrink
+ * @count:	number of entries to look at, decremented as we go
+ *
+ * The memcg LRU mixes the dentries of all superblocks.  Runs of dentries
+ * of one superblock are taken off its tail, with the superblock pinned the
+ * same way as in prune_dcache().  A dentry whose superblock is going away
+ * is rotated to the head of the LRU.
+ */
+static void shrink_dcache_memcg_lru(struct mem_cgroup *mem, int *count)
+{
+	struct list_head *lru = mem_cgroup_kmem_lru(mem,
+						MEM_CGROUP_KMEM_DENTRY_LRU);
+	struct super_block *sb;
+	struct dentry *dentry;
+	LIST_HEAD(referenced);
+	LIST_HEAD(isolated);
+	LIST_HEAD(tmp);
+	int cnt = *count;
+
+	spin_lock(&dcache_lru_lock);
+	while (cnt > 0 && !list_empty(lru)) {
+		dentry = list_entry(lru->prev, struct dentry, d_memcg_lru);
+		sb = dentry->d_sb;
+
+		spin_lock(&sb_lock);
+		if (list_empty(&sb->s_instances)) {
+			spin_unlock(&sb_lock);
+			list_move(&dentry->d_memcg_lru, lru);
+			cnt--;
+			continue;
+		}
+		sb->s_count++;
+		spin_unlock(&sb_lock);
+
+		/* see prune_dcache() */
+		if (!down_read_trylock(&sb->s_umount)) {
+			list_move(&dentry->d_memcg_lru, lru);
+			cnt--;
+			goto put;
+		}
+		if (!sb->s_root) {
+			list_move(&dentry->d_memcg_lru, lru);
+			cnt--;
+			goto unlock;
+		}
+
+		while (cnt > 0 && !list_empty(lru)) {
+			dentry = list_entry(lru->prev, struct dentry,
+					    d_memcg_lru);
+			if (dentry->d_sb != sb)
+				break;
+			if (!spin_trylock(&dentry->d_lock)) {
+				spin_unlock(&dcache_lru_lock);
+				cpu_relax();
+				spin_lock(&dcache_lru_lock);
+				continue;
+			}
+			if (dentry->d_flags & DCACHE_REFERENCED) {
+				dentry->d_flags &= ~DCACHE_REFERENCED;
+				list_move(&dentry->d_memcg_lru, &referenced);
+			} else {
+				list_move(&dentry->d_memcg_lru, &isolated);
+				list_move_tail(&dentry->d_lru, &tmp);
+			}
+			spin_unlock(&dentry->d_lock);
+			cnt--;
+			cond_resched_lock(&dcache_lru_lock);
+		}
+		list_splice_init(&referenced, lru);
+		spin_unlock(&dcache_lru_lock);
+
+		shrink_dentry_list(&tmp);
+
+		/* pruned dentries have taken themselves off &isolated */
+		spin_lock(&dcache_lru_lock);
+		list_splice_init(&isolated, lru);
+unlock:
+		up_read(&sb->s_umount);
+put:
+		spin_lock(&sb_lock);
+		__put_super(sb);
+		spin_unlock(&sb_lock);
+		cond_resched_lock(&dcache_lru_lock);
+	}
+	spin_unlock(&dcache_lru_lock);
+
+	*count = cnt;
+}
+
+/**
+ * prune_dcache_memcg - shrink the dcache of a memory cgroup
+ * @mem: memory cgroup whose dentries to free
+ * @count: number of entries to look at
+ *
+ * Like prune_dcache(), but only looks at the unused dentries charged to
+ * @mem or, with use_hierarchy, to its descendants.
+ */
+static void prune_dcache_memcg(struct mem_cgroup *mem, int count)
+{
+	struct mem_cgroup *iter;
+
+	for (iter = mem_cgroup_iter(mem, NULL); iter;
+	     iter = mem_cgroup_iter(mem, iter)) {
+		shrink_dcache_memcg_lru(iter, &count);
+		if (count <= 0) {
+			mem_cgroup_iter_break(mem, iter);
+			break;
+		}
+	}
+}
+#endif
+
 /**
  * shrink_dcache_sb - shrink dcache for a superblock
  * @sb: superblock
@@ -1258,8 +1418,30 @@ static int shrink_dcache_memory(struct shrinker *shrink, int nr, gfp_t gfp_mask)
 	return (dentry_stat.nr_unused / 100) * sysctl_vfs_cache_pressure;
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+/*
+ * Like shrink_dcache_memory(), but for the unused dentries charged to a
+ * memory cgroup.
+ */
+static int shrink_dcache_memcg(struct shrinker *shrink, struct mem_cgroup *mem,
+			       int nr, gfp_t gfp_mask)
+{
+	if (nr) {
+		if (!(gfp_mask & __GFP_FS))
+			return -1;
+		prune_dcache_memcg(mem, nr);
+	}
+
+	return (mem_cgroup_kmem_lru_count(mem, MEM_CGROUP_KMEM_DENTRY_LRU) / 100) *
+		sysctl_vfs_cache_pressure;
+}
+#endif
+
 static struct shrinker dcache_shrinker = {
 	.shrink = shrink_dcache_memory,
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	.shrink_memcg = shrink_dcache_memcg,
+#endif
 	.seeks = DEFAULT_SEEKS,
 };
 
@@ -1309,6 +1491,9 @@ struct dentry *d_alloc(struct dentry * parent, const struct qstr *name)
 	dentry->d_fsdata = NULL;
 	INIT_HLIST_BL_NODE(&dentry->d_hash);
 	INIT_LIST_HEAD(&dentry->d_lru);
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	INIT_LIST_HEAD(&dentry->d_memcg_lru);
+#endif
 	INIT_LIST_HEAD(&dentry->d_subdirs);
 	INIT_LIST_HEAD(&dentry->d_alias);
 	INIT_LIST_HEAD(&dentry->d_u.d_child);
@@ -3031,7 +3216,7 @@ static void __init dcache_init(void)
 	 * of the dcache. 
 	 */
 	dentry_cache = KMEM_CACHE(dentry,
-		SLAB_RECLAIM_ACCOUNT|SLAB_PANIC|SLAB_MEM_SPREAD);
+		SLAB_RECLAIM_ACCOUNT|SLAB_PANIC|SLAB_MEM_SPREAD|SLAB_ACCOUNT);
 	
 	register_shrinker(&dcache_shrinker);
 
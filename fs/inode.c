@@ -25,6 +25,7 @@
 #include <linux/async.h>
 #include <linux/posix_acl.h>
 #include <linux/ima.h>
+#include <linux/memcontrol.h>
 
 /*
  * This is needed for the following functions:
@@ -70,6 +71,9 @@ static unsigned int i_hash_shift __read_mostly;
  *
  * A "dirty" list is maintained for each super block,
  * allowing for low-overhead inode sync() operations.
+ *
+ * An "unused" inode is also on the LRU list of the memory
+ * cgroup it is charged to, if any.
  */
 
 static LIST_HEAD(inode_lru);
@@ -204,6 +208,7 @@ int inode_init_always(struct super_block *sb, struct inode *inode)
 	mapping->assoc_mapping = NULL;
 	mapping->backing_dev_info = &default_backing_dev_info;
 	mapping->writeback_index = 0;
+	mapping->ra_history = NULL;
 
 	/*
 	 * If the block_device provides a backing_dev_info for client
@@ -274,6 +279,7 @@ void __destroy_inode(struct inode *inode)
 	if (inode->i_default_acl && inode->i_default_acl != ACL_NOT_CACHED)
 		posix_acl_release(inode->i_default_acl);
 #endif
+	kfree(inode->i_data.ra_history);
 	this_cpu_dec(nr_inodes);
 }
 EXPORT_SYMBOL(__destroy_inode);
@@ -308,6 +314,9 @@ void inode_init_once(struct inode *inode)
 	INIT_LIST_HEAD(&inode->i_devices);
 	INIT_LIST_HEAD(&inode->i_wb_list);
 	INIT_LIST_HEAD(&inode->i_lru);
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	INIT_LIST_HEAD(&inode->i_memcg_lru);
+#endif
 	INIT_RADIX_TREE(&inode->i_data.page_tree, GFP_ATOMIC);
 	spin_lock_init(&inode->i_data.tree_lock);
 	spin_lock_init(&inode->i_data.i_mmap_lock);
@@ -346,11 +355,64 @@ void ihold(struct inode *inode)
 }
 EXPORT_SYMBOL(ihold);
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+static inline void inode_memcg_lru_add(struct inode *inode)
+{
+	mem_cgroup_kmem_lru_add(inode, &inode->i_memcg_lru,
+				MEM_CGROUP_KMEM_INODE_LRU);
+}
+
+static inline void inode_memcg_lru_del(struct inode *inode)
+{
+	mem_cgroup_kmem_lru_del(inode, &inode->i_memcg_lru,
+				MEM_CGROUP_KMEM_INODE_LRU);
+}
+
+/*
+ * prune_icache_lru() walks either the global LRU, linked through i_lru,
+ * or the LRU of a memcg, linked through i_memcg_lru.
+ */
+static inline struct inode *inode_lru_entry(struct list_head *item,
+					    bool memcg)
+{
+	if (memcg)
+		return list_entry(item, struct inode, i_memcg_lru);
+	return list_entry(item, struct inode, i_lru);
+}
+
+static inline struct list_head *inode_lru_item(struct inode *inode,
+					       bool memcg)
+{
+	return memcg ? &inode->i_memcg_lru : &inode->i_lru;
+}
+#else
+static inline void inode_memcg_lru_add(struct inode *inode)
+{
+}
+
+static inline void inode_memcg_lru_del(struct inode *inode)
+{
+}
+
+static inline struct inode *inode_lru_entry(struct list_head *item,
+					    bool memcg)
+{
+	return list_entry(item, struct inode, i_lru);
+}
+
+static inline struct list_head *inode_lru_item(struct inode *inode,
+					       bool memcg)
+{
+	return &inode->i_lru;
+}
+#endif
+
 static void inode_lru_list_add(struct inode *inode)
 {
 	if (list_empty(&inode->i_lru)) {
 		list_add(&inode->i_lru, &inode_lru);
 		inodes_stat.nr_unused++;
+		inode_memcg_lru_add(inode);
 	}
 }
 
@@ -359,6 +421,7 @@ static void inode_lru_list_del(struct inode *inode)
 	if (!list_empty(&inode->i_lru)) {
 		list_del_init(&inode->i_lru);
 		inodes_stat.nr_unused--;
+		inode_memcg_lru_del(inode);
 	}
 }
 
@@ -530,6 +593,7 @@ void evict_inodes(struct super_block *sb)
 		list_del_init(&inode->i_wb_list);
 		if (!(inode->i_state & (I_DIRTY | I_SYNC)))
 			inodes_stat.nr_unused--;
+		inode_memcg_lru_del(inode);
 	}
 	spin_unlock(&inode_lock);
 
@@ -571,6 +635,7 @@ int invalidate_inodes(struct super_block *sb)
 		list_del_init(&inode->i_wb_list);
 		if (!(inode->i_state & (I_DIRTY | I_SYNC)))
 			inodes_stat.nr_unused--;
+		inode_memcg_lru_del(inode);
 	}
 	spin_unlock(&inode_lock);
 
@@ -594,8 +659,9 @@ static int can_unuse(struct inode *inode)
 }
 
 /*
- * Scan `goal' inodes on the unused list for freeable ones. They are moved to a
- * temporary list and then are freed outside inode_lock by dispose_list().
+ * Scan `nr_to_scan' inodes on an unused list for freeable ones. They are moved
+ * to the temporary list `freeable' and then are freed outside inode_lock by
+ * dispose_list().  Called with inode_lock held, returns the number scanned.
  *
  * Any inodes which are pinned purely because of attached pagecache have their
  * pagecache removed.  If the inode has metadata buffers attached to
@@ -609,21 +675,19 @@ static int can_unuse(struct inode *inode)
  * LRU does not have strict ordering. Hence we don't want to reclaim inodes
  * with this flag set because they are the inodes that are out of order.
  */
-static void prune_icache(int nr_to_scan)
+static int prune_icache_lru(struct list_head *lru, bool memcg, int nr_to_scan,
+			    struct list_head *freeable)
 {
-	LIST_HEAD(freeable);
 	int nr_scanned;
 	unsigned long reap = 0;
 
-	down_read(&iprune_sem);
-	spin_lock(&inode_lock);
 	for (nr_scanned = 0; nr_scanned < nr_to_scan; nr_scanned++) {
 		struct inode *inode;
 
-		if (list_empty(&inode_lru))
+		if (list_empty(lru))
 			break;
 
-		inode = list_entry(inode_lru.prev, struct inode, i_lru);
+		inode = inode_lru_entry(lru->prev, memcg);
 
 		/*
 		 * Referenced or dirty inodes are still in use. Give them
@@ -631,14 +695,13 @@ static void prune_icache(int nr_to_scan)
 		 */
 		if (atomic_read(&inode->i_count) ||
 		    (inode->i_state & ~I_REFERENCED)) {
-			list_del_init(&inode->i_lru);
-			inodes_stat.nr_unused--;
+			inode_lru_list_del(inode);
 			continue;
 		}
 
 		/* recently referenced inodes get one more pass */
 		if (inode->i_state & I_REFERENCED) {
-			list_move(&inode->i_lru, &inode_lru);
+			list_move(inode_lru_item(inode, memcg), lru);
 			inode->i_state &= ~I_REFERENCED;
 			continue;
 		}
@@ -651,8 +714,7 @@ static void prune_icache(int nr_to_scan)
 			iput(inode);
 			spin_lock(&inode_lock);
 
-			if (inode != list_entry(inode_lru.next,
-						struct inode, i_lru))
+			if (inode != inode_lru_entry(lru->next, memcg))
 				continue;	/* wrong inode or list_empty */
 			if (!can_unuse(inode))
 				continue;
@@ -664,20 +726,61 @@ static void prune_icache(int nr_to_scan)
 		 * Move the inode off the IO lists and LRU once I_FREEING is
 		 * set so that it won't get moved back on there if it is dirty.
 		 */
-		list_move(&inode->i_lru, &freeable);
+		list_move(&inode->i_lru, freeable);
 		list_del_init(&inode->i_wb_list);
 		inodes_stat.nr_unused--;
+		inode_memcg_lru_del(inode);
 	}
 	if (current_is_kswapd())
 		__count_vm_events(KSWAPD_INODESTEAL, reap);
 	else
 		__count_vm_events(PGINODESTEAL, reap);
+
+	return nr_scanned;
+}
+
+static void prune_icache(int nr_to_scan)
+{
+	LIST_HEAD(freeable);
+
+	down_read(&iprune_sem);
+	spin_lock(&inode_lock);
+	prune_icache_lru(&inode_lru, false, nr_to_scan, &freeable);
 	spin_unlock(&inode_lock);
 
 	dispose_list(&freeable);
 	up_read(&iprune_sem);
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+/*
+ * Like prune_icache(), but only scan the unused inodes charged to @mem
+ * or, with use_hierarchy, to its descendants.
+ */
+static void prune_icache_memcg(struct mem_cgroup *mem, int nr_to_scan)
+{
+	LIST_HEAD(freeable);
+	struct mem_cgroup *iter;
+
+	down_read(&iprune_sem);
+	for (iter = mem_cgroup_iter(mem, NULL); iter;
+	     iter = mem_cgroup_iter(mem, iter)) {
+		spin_lock(&inode_lock);
+		nr_to_scan -= prune_icache_lru(mem_cgroup_kmem_lru(iter,
+						MEM_CGROUP_KMEM_INODE_LRU),
+					       true, nr_to_scan, &freeable);
+		spin_unlock(&inode_lock);
+		if (nr_to_scan <= 0) {
+			mem_cgroup_iter_break(mem, iter);
+			break;
+		}
+	}
+
+	dispose_list(&freeable);
+	up_read(&iprune_sem);
+}
+#endif
+
 /*
  * shrink_icache_memory() will attempt to reclaim some unused inodes.  Here,
  * "unused" means that no dentries are referring to the inodes: the files are
@@ -702,8 +805,29 @@ static int shrink_icache_memory(struct shrinker *shrink, int nr, gfp_t gfp_mask)
 	return (get_nr_inodes_unused() / 100) * sysctl_vfs_cache_pressure;
 }
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+/*
+ * Like shrink_icache_memory(), but for the unused inodes charged to a
+ * memory cgroup.
+ */
+static int shrink_icache_memcg(struct shrinker *shrink, struct mem_cgroup *mem,
+			       int nr, gfp_t gfp_mask)
+{
+	if (nr) {
+		if (!(gfp_mask & __GFP_FS))
+			return -1;
+		prune_icache_memcg(mem, nr);
+	}
+	return (mem_cgroup_kmem_lru_count(mem, MEM_CGROUP_KMEM_INODE_LRU) / 100) *
+		sysctl_vfs_cache_pressure;
+}
+#endif
+
 static struct shrinker icache_shrinker = {
 	.shrink = shrink_icache_memory,
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	.shrink_memcg = shrink_icache_memcg,
+#endif
 	.seeks = DEFAULT_SEEKS,
 };
 
@@ -1661,7 +1785,7 @@ void __init inode_init(void)
 					 sizeof(struct inode),
 					 0,
 					 (SLAB_RECLAIM_ACCOUNT|SLAB_PANIC|
-					 SLAB_MEM_SPREAD),
+					 SLAB_MEM_SPREAD|SLAB_ACCOUNT),
 					 init_once);
 	register_shrinker(&icache_shrinker);
 
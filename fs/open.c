@@ -880,6 +880,18 @@ void fd_install(unsigned int fd, struct file *file)
 
 EXPORT_SYMBOL(fd_install);
 
+/*
+ * Read ahead what the file's readahead history recorded.  Not done in
+ * __dentry_open(): filesystems using open intents finish setting up the
+ * file after that.
+ */
+static void ra_history_replay(struct file *f)
+{
+	if (unlikely(f->f_mapping->ra_history) && (f->f_mode & FMODE_READ) &&
+	    !(f->f_flags & O_DIRECT))
+		page_cache_ra_history_replay(f->f_mapping, f);
+}
+
 long do_sys_open(int dfd, const char __user *filename, int flags, int mode)
 {
 	char *tmp = getname(filename);
@@ -893,6 +905,7 @@ long do_sys_open(int dfd, const char __user *filename, int flags, int mode)
 				put_unused_fd(fd);
 				fd = PTR_ERR(f);
 			} else {
+				ra_history_replay(f);
 				fsnotify_open(f);
 				fd_install(fd, f);
 			}
@@ -394,6 +394,7 @@ __generic_file_splice_read(struct file *in, loff_t *ppos,
 		if (PageReadahead(page))
 			page_cache_async_readahead(mapping, &in->f_ra, in,
 					page, index, req_pages - page_nr);
+		page_cache_ra_hit(page);
 
 		/*
 		 * If the page isn't uptodate, we may need to start io on it
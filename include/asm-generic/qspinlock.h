@@ -0,0 +1,69 @@
+#ifndef __ASM_GENERIC_QSPINLOCK_H
+#define __ASM_GENERIC_QSPINLOCK_H
+
+/*
+ * Queued spinlock
+ *
+ * The uncontended lock is a single cmpxchg on the lock word, as with a
+ * test-and-set lock.  Contending cpus queue up on per-cpu MCS nodes
+ * (see kernel/qspinlock.c) and each one spins on its own node, so only
+ * the waiter at the head of the queue watches the lock word itself.
+ */
+
+#include <asm-generic/qspinlock_types.h>
+#include <asm/atomic.h>
+#include <asm/processor.h>
+
+static __always_inline int queued_spin_is_locked(struct qspinlock *lock)
+{
+	return atomic_read(&lock->val);
+}
+
+static __always_inline int queued_spin_is_contended(struct qspinlock *lock)
+{
+	return atomic_read(&lock->val) & ~_Q_LOCKED_MASK;
+}
+
+static __always_inline int queued_spin_trylock(struct qspinlock *lock)
+{
+	if (!atomic_read(&lock->val) &&
+	    atomic_cmpxchg(&lock->val, 0, _Q_LOCKED_VAL) == 0)
+		return 1;
+	return 0;
+}
+
+extern void queued_spin_lock_slowpath(struct qspinlock *lock);
+
+static __always_inline void queued_spin_lock(struct qspinlock *lock)
+{
+	if (likely(atomic_cmpxchg(&lock->val, 0, _Q_LOCKED_VAL) == 0))
+		return;
+	queued_spin_lock_slowpath(lock);
+}
+
+static __always_inline void queued_spin_unlock(struct qspinlock *lock)
+{
+	/*
+	 * The locked byte is ours alone, so subtracting it leaves the
+	 * tail of the queue untouched.
+	 */
+	smp_mb__before_atomic_dec();
+	atomic_sub(_Q_LOCKED_VAL, &lock->val);
+}
+
+static inline void queued_spin_unlock_wait(struct qspinlock *lock)
+{
+	while (atomic_read(&lock->val) & _Q_LOCKED_MASK)
+		cpu_relax();
+	smp_rmb();
+}
+
+#define arch_spin_is_locked(l)		queued_spin_is_locked(l)
+#define arch_spin_is_contended(l)	queued_spin_is_contended(l)
+#define arch_spin_lock(l)		queued_spin_lock(l)
+#define arch_spin_trylock(l)		queued_spin_trylock(l)
+#define arch_spin_unlock(l)		queued_spin_unlock(l)
+#define arch_spin_lock_flags(l, f)	queued_spin_lock(l)
+#define arch_spin_unlock_wait(l)	queued_spin_unlock_wait(l)
+
+#endif /* __ASM_GENERIC_QSPINLOCK_H */
@@ -0,0 +1,48 @@
+#ifndef __ASM_GENERIC_QSPINLOCK_TYPES_H
+#define __ASM_GENERIC_QSPINLOCK_TYPES_H
+
+/*
+ * Queued spinlock: the lock word and its bit layout.
+ *
+ * Architectures that select ARCH_USE_QUEUED_SPINLOCKS include this from
+ * their asm/spinlock_types.h instead of defining arch_spinlock_t.
+ */
+
+#include <linux/types.h>
+
+typedef struct qspinlock {
+	atomic_t	val;
+} arch_spinlock_t;
+
+/* asm/atomic.h can't be pulled in this early, so no ATOMIC_INIT() */
+#define __ARCH_SPIN_LOCK_UNLOCKED	{ .val = { 0 } }
+
+/*
+ * Bitfields in the lock word:
+ *
+ *  0- 7: locked byte
+ *  8- 9: tail index (nesting level of the queue node)
+ * 10-31: tail cpu (+1)
+ *
+ * The tail, when set, names the per-cpu queue node of the last waiter.
+ */
+#define _Q_SET_MASK(type)	(((1U << _Q_ ## type ## _BITS) - 1)\
+				      << _Q_ ## type ## _OFFSET)
+#define _Q_LOCKED_OFFSET	0
+#define _Q_LOCKED_BITS		8
+#define _Q_LOCKED_MASK		_Q_SET_MASK(LOCKED)
+
+#define _Q_TAIL_IDX_OFFSET	(_Q_LOCKED_OFFSET + _Q_LOCKED_BITS)
+#define _Q_TAIL_IDX_BITS	2
+#define _Q_TAIL_IDX_MASK	_Q_SET_MASK(TAIL_IDX)
+
+#define _Q_TAIL_CPU_OFFSET	(_Q_TAIL_IDX_OFFSET + _Q_TAIL_IDX_BITS)
+#define _Q_TAIL_CPU_BITS	(32 - _Q_TAIL_CPU_OFFSET)
+#define _Q_TAIL_CPU_MASK	_Q_SET_MASK(TAIL_CPU)
+
+#define _Q_TAIL_OFFSET		_Q_TAIL_IDX_OFFSET
+#define _Q_TAIL_MASK		(_Q_TAIL_IDX_MASK | _Q_TAIL_CPU_MASK)
+
+#define _Q_LOCKED_VAL		(1U << _Q_LOCKED_OFFSET)
+
+#endif /* __ASM_GENERIC_QSPINLOCK_TYPES_H */
@@ -13,6 +13,7 @@
 
 #define COMPACT_MODE_DIRECT_RECLAIM	0
 #define COMPACT_MODE_KSWAPD		1
+#define COMPACT_MODE_PROACTIVE		2
 
 #ifdef CONFIG_COMPACTION
 extern int sysctl_compact_memory;
@@ -21,6 +22,13 @@ extern int sysctl_compaction_handler(struct ctl_table *table, int write,
 extern int sysctl_extfrag_threshold;
 extern int sysctl_extfrag_handler(struct ctl_table *table, int write,
 			void __user *buffer, size_t *length, loff_t *ppos);
+extern int sysctl_compaction_proactiveness;
+extern int sysctl_compaction_proactive_cpu;
+extern int sysctl_compaction_proactive_handler(struct ctl_table *table,
+			int write, void __user *buffer, size_t *length,
+			loff_t *ppos);
+extern int kcompactd_run(int nid);
+extern void kcompactd_stop(int nid);
 
 extern int fragmentation_index(struct zone *zone, unsigned int order);
 extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
@@ -89,6 +97,15 @@ static inline bool compaction_deferred(struct zone *zone)
 	return 1;
 }
 
+static inline int kcompactd_run(int nid)
+{
+	return 0;
+}
+
+static inline void kcompactd_stop(int nid)
+{
+}
+
 #endif /* CONFIG_COMPACTION */
 
 #if defined(CONFIG_COMPACTION) && defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
@@ -133,6 +133,9 @@ struct dentry {
 	void *d_fsdata;			/* fs-specific data */
 
 	struct list_head d_lru;		/* LRU list */
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	struct list_head d_memcg_lru;	/* LRU list of the charged memcg */
+#endif
 	/*
 	 * d_child and d_rcu can share memory
 	 */
@@ -18,4 +18,11 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/*
+ * Linux specific: remember the small random reads of a file, and read
+ * them ahead again whenever the file is opened later on.
+ */
+#define FADV_RA_HISTORY		8 /* Record hot offsets for later opens.  */
+#define FADV_RA_NOHISTORY	9 /* Forget them, and stop recording.  */
+
 #endif	/* FADVISE_H_INCLUDED */
@@ -649,6 +649,7 @@ struct address_space {
 	spinlock_t		private_lock;	/* for use by the address_space */
 	struct list_head	private_list;	/* ditto */
 	struct address_space	*assoc_mapping;	/* ditto */
+	struct file_ra_history	*ra_history;	/* hot offsets, see readahead.c */
 } __attribute__((aligned(sizeof(long))));
 	/*
 	 * On most architectures that alignment is already the case; but
@@ -754,6 +755,9 @@ struct inode {
 	struct hlist_node	i_hash;
 	struct list_head	i_wb_list;	/* backing dev IO list */
 	struct list_head	i_lru;		/* inode LRU list */
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	struct list_head	i_memcg_lru;	/* LRU list of the charged memcg */
+#endif
 	struct list_head	i_sb_list;
 	union {
 		struct list_head	i_dentry;
@@ -921,6 +925,10 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	unsigned long stride;		/* Gap between strided reads */
+	unsigned int stride_hits;	/* # of reads seen with that gap */
+	pgoff_t stride_prev;		/* Last strided chunk read ahead */
 };
 
 /*
@@ -305,6 +305,38 @@ __alloc_pages(gfp_t gfp_mask, unsigned int order,
 	return __alloc_pages_nodemask(gfp_mask, order, zonelist, NULL);
 }
 
+unsigned long
+__alloc_pages_bulk_nodemask(gfp_t gfp_mask, struct zonelist *zonelist,
+			    nodemask_t *nodemask, unsigned long nr_pages,
+			    struct list_head *page_list,
+			    struct page **page_array);
+
+/*
+ * Allocate up to @nr_pages order-0 pages from node @nid (or the current
+ * node if @nid is negative), adding them to @page_list or filling the
+ * empty slots of @page_array.  Returns the number of pages on the list
+ * or populated in the array.
+ */
+static inline unsigned long
+alloc_pages_bulk_node(int nid, gfp_t gfp_mask, unsigned long nr_pages,
+		      struct list_head *page_list, struct page **page_array)
+{
+	if (nid < 0)
+		nid = numa_node_id();
+
+	return __alloc_pages_bulk_nodemask(gfp_mask,
+			node_zonelist(nid, gfp_mask), NULL, nr_pages,
+			page_list, page_array);
+}
+
+#define alloc_pages_bulk(gfp_mask, nr_pages, page_list, page_array)	\
+	alloc_pages_bulk_node(numa_node_id(), gfp_mask, nr_pages,	\
+			      page_list, page_array)
+#define alloc_pages_bulk_list(gfp_mask, nr_pages, page_list)		\
+	alloc_pages_bulk(gfp_mask, nr_pages, page_list, NULL)
+#define alloc_pages_bulk_array(gfp_mask, nr_pages, page_array)		\
+	alloc_pages_bulk(gfp_mask, nr_pages, NULL, page_array)
+
 static inline struct page *alloc_pages_node(int nid, gfp_t gfp_mask,
 						unsigned int order)
 {
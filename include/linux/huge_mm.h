@@ -18,7 +18,7 @@ extern struct page *follow_trans_huge_pmd(struct mm_struct *mm,
 					  unsigned int flags);
 extern int zap_huge_pmd(struct mmu_gather *tlb,
 			struct vm_area_struct *vma,
-			pmd_t *pmd);
+			pmd_t *pmd, unsigned long addr);
 extern int mincore_huge_pmd(struct vm_area_struct *vma, pmd_t *pmd,
 			unsigned long addr, unsigned long end,
 			unsigned char *vec);
@@ -107,6 +107,19 @@ extern void __split_huge_page_pmd(struct mm_struct *mm, pmd_t *pmd);
 #endif
 extern int hugepage_madvise(struct vm_area_struct *vma,
 			    unsigned long *vm_flags, int advice);
+extern int do_set_huge_pmd_file(struct vm_area_struct *vma,
+				unsigned long haddr, pmd_t *pmd,
+				struct page *page, unsigned int flags);
+extern pmd_t *page_check_file_huge_pmd(struct page *page,
+				       struct vm_area_struct *vma,
+				       unsigned long address);
+extern int file_huge_pmd_referenced(struct page *page,
+				    struct vm_area_struct *vma,
+				    unsigned long address, pmd_t *pmd);
+extern void split_file_huge_pmd(struct page *page,
+				struct vm_area_struct *vma,
+				unsigned long address);
+extern void split_file_huge_pmds(struct vm_area_struct *vma);
 extern void __vma_adjust_trans_huge(struct vm_area_struct *vma,
 				    unsigned long start,
 				    unsigned long end,
@@ -116,7 +129,8 @@ static inline void vma_adjust_trans_huge(struct vm_area_struct *vma,
 					 unsigned long end,
 					 long adjust_next)
 {
-	if (!vma->anon_vma || vma->vm_ops || vma->vm_file)
+	if ((!vma->anon_vma || vma->vm_ops || vma->vm_file) &&
+	    !(vma->vm_ops && vma->vm_ops->pmd_fault))
 		return;
 	__vma_adjust_trans_huge(vma, start, end, adjust_next);
 }
@@ -174,6 +188,26 @@ static inline void vma_adjust_trans_huge(struct vm_area_struct *vma,
 					 long adjust_next)
 {
 }
+static inline pmd_t *page_check_file_huge_pmd(struct page *page,
+					      struct vm_area_struct *vma,
+					      unsigned long address)
+{
+	return NULL;
+}
+static inline int file_huge_pmd_referenced(struct page *page,
+					   struct vm_area_struct *vma,
+					   unsigned long address, pmd_t *pmd)
+{
+	return 0;
+}
+static inline void split_file_huge_pmd(struct page *page,
+				       struct vm_area_struct *vma,
+				       unsigned long address)
+{
+}
+static inline void split_file_huge_pmds(struct vm_area_struct *vma)
+{
+}
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
 #endif /* _LINUX_HUGE_MM_H */
@@ -38,6 +38,20 @@ static inline void ksm_exit(struct mm_struct *mm)
 		__ksm_exit(mm);
 }
 
+/*
+ * An mm's KSM priority decides how often ksmd scans it, relative to the
+ * other mms registered: see PR_SET_KSM_PRIORITY in Documentation/vm/ksm.txt.
+ */
+#define KSM_PRIO_DEFAULT	0
+#define KSM_PRIO_MAX		((1 << MMF_KSM_PRIO_BITS) - 1)
+
+static inline unsigned int ksm_mm_priority(struct mm_struct *mm)
+{
+	return (mm->flags & MMF_KSM_PRIO_MASK) >> MMF_KSM_PRIO_SHIFT;
+}
+
+int ksm_set_priority(struct mm_struct *mm, unsigned long prio);
+
 /*
  * A KSM page is one of those write-protected "shared pages" or "merged pages"
  * which KSM maps into multiple mms, wherever identical anonymous page content
@@ -101,6 +115,16 @@ static inline void ksm_exit(struct mm_struct *mm)
 {
 }
 
+static inline unsigned int ksm_mm_priority(struct mm_struct *mm)
+{
+	return 0;
+}
+
+static inline int ksm_set_priority(struct mm_struct *mm, unsigned long prio)
+{
+	return -EINVAL;
+}
+
 static inline int PageKsm(struct page *page)
 {
 	return 0;
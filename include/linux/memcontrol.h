@@ -30,13 +30,6 @@ enum mem_cgroup_page_stat_item {
 	MEMCG_NR_FILE_MAPPED, /* # of pages charged as file rss */
 };
 
-extern unsigned long mem_cgroup_isolate_pages(unsigned long nr_to_scan,
-					struct list_head *dst,
-					unsigned long *scanned, int order,
-					int mode, struct zone *z,
-					struct mem_cgroup *mem_cont,
-					int active, int file);
-
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR
 /*
  * All "charge" functions with gfp_mask should use GFP_KERNEL or
@@ -60,12 +53,15 @@ extern void mem_cgroup_cancel_charge_swapin(struct mem_cgroup *ptr);
 
 extern int mem_cgroup_cache_charge(struct page *page, struct mm_struct *mm,
 					gfp_t gfp_mask);
-extern void mem_cgroup_add_lru_list(struct page *page, enum lru_list lru);
-extern void mem_cgroup_del_lru_list(struct page *page, enum lru_list lru);
-extern void mem_cgroup_rotate_lru_list(struct page *page, enum lru_list lru);
-extern void mem_cgroup_del_lru(struct page *page);
-extern void mem_cgroup_move_lists(struct page *page,
-				  enum lru_list from, enum lru_list to);
+
+struct lruvec *mem_cgroup_zone_lruvec(struct zone *zone,
+				      struct mem_cgroup *mem);
+struct lruvec *mem_cgroup_lru_add_list(struct zone *zone, struct page *page,
+				       enum lru_list lru);
+void mem_cgroup_lru_del_list(struct page *page, enum lru_list lru);
+void mem_cgroup_lru_del(struct page *page);
+struct lruvec *mem_cgroup_lru_move_lists(struct zone *zone, struct page *page,
+					 enum lru_list from, enum lru_list to);
 
 /* For coalescing uncharge for reducing memcg' overhead*/
 extern void mem_cgroup_uncharge_start(void);
@@ -103,8 +99,14 @@ extern void mem_cgroup_end_migration(struct mem_cgroup *mem,
 /*
  * For memory reclaim.
  */
-int mem_cgroup_inactive_anon_is_low(struct mem_cgroup *memcg);
-int mem_cgroup_inactive_file_is_low(struct mem_cgroup *memcg);
+struct mem_cgroup *mem_cgroup_iter(struct mem_cgroup *root,
+				   struct mem_cgroup *prev);
+void mem_cgroup_iter_break(struct mem_cgroup *root, struct mem_cgroup *prev);
+bool mem_cgroup_soft_limit_protected(struct mem_cgroup *mem);
+int mem_cgroup_inactive_anon_is_low(struct mem_cgroup *memcg,
+				    struct zone *zone);
+int mem_cgroup_inactive_file_is_low(struct mem_cgroup *memcg,
+				    struct zone *zone);
 unsigned long mem_cgroup_zone_nr_pages(struct mem_cgroup *memcg,
 				       struct zone *zone,
 				       enum lru_list lru);
@@ -202,28 +204,33 @@ static inline int mem_cgroup_shmem_charge_fallback(struct page *page,
 	return 0;
 }
 
-static inline void mem_cgroup_add_lru_list(struct page *page, int lru)
+static inline struct lruvec *mem_cgroup_zone_lruvec(struct zone *zone,
+						    struct mem_cgroup *mem)
 {
+	return &zone->lruvec;
 }
 
-static inline void mem_cgroup_del_lru_list(struct page *page, int lru)
+static inline struct lruvec *mem_cgroup_lru_add_list(struct zone *zone,
+						     struct page *page,
+						     enum lru_list lru)
 {
-	return ;
+	return &zone->lruvec;
 }
 
-static inline void mem_cgroup_rotate_lru_list(struct page *page, int lru)
+static inline void mem_cgroup_lru_del_list(struct page *page, enum lru_list lru)
 {
-	return ;
 }
 
-static inline void mem_cgroup_del_lru(struct page *page)
+static inline void mem_cgroup_lru_del(struct page *page)
 {
-	return ;
 }
 
-static inline void
-mem_cgroup_move_lists(struct page *page, enum lru_list from, enum lru_list to)
+static inline struct lruvec *mem_cgroup_lru_move_lists(struct zone *zone,
+						       struct page *page,
+						       enum lru_list from,
+						       enum lru_list to)
 {
+	return &zone->lruvec;
 }
 
 static inline struct mem_cgroup *try_get_mem_cgroup_from_page(struct page *page)
@@ -279,14 +286,30 @@ static inline bool mem_cgroup_disabled(void)
 	return true;
 }
 
+static inline struct mem_cgroup *
+mem_cgroup_iter(struct mem_cgroup *root, struct mem_cgroup *prev)
+{
+	return NULL;
+}
+
+static inline void mem_cgroup_iter_break(struct mem_cgroup *root,
+					 struct mem_cgroup *prev)
+{
+}
+
+static inline bool mem_cgroup_soft_limit_protected(struct mem_cgroup *mem)
+{
+	return false;
+}
+
 static inline int
-mem_cgroup_inactive_anon_is_low(struct mem_cgroup *memcg)
+mem_cgroup_inactive_anon_is_low(struct mem_cgroup *memcg, struct zone *zone)
 {
 	return 1;
 }
 
 static inline int
-mem_cgroup_inactive_file_is_low(struct mem_cgroup *memcg)
+mem_cgroup_inactive_file_is_low(struct mem_cgroup *memcg, struct zone *zone)
 {
 	return 1;
 }
@@ -346,5 +369,53 @@ static inline void mem_cgroup_split_huge_fixup(struct page *head,
 
 #endif /* CONFIG_CGROUP_MEM_CONT */
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+/*
+ * Unused dcache and icache objects are also kept on a list in the memcg
+ * their slab page is charged to, so that memcg reclaim can find them.
+ * The lists are protected by the lock of the cache's own LRU.
+ */
+enum mem_cgroup_kmem_lru {
+	MEM_CGROUP_KMEM_DENTRY_LRU,
+	MEM_CGROUP_KMEM_INODE_LRU,
+	NR_MEM_CGROUP_KMEM_LRU,
+};
+
+extern int mem_cgroup_charge_slab(struct page *page, int order,
+				  gfp_t gfp_mask);
+extern void mem_cgroup_uncharge_slab(struct page *page, int order);
+extern void mem_cgroup_kmem_lru_add(const void *obj, struct list_head *item,
+				    enum mem_cgroup_kmem_lru lru);
+extern void mem_cgroup_kmem_lru_move_tail(const void *obj,
+					  struct list_head *item,
+					  enum mem_cgroup_kmem_lru lru);
+extern void mem_cgroup_kmem_lru_del(const void *obj, struct list_head *item,
+				    enum mem_cgroup_kmem_lru lru);
+extern struct list_head *mem_cgroup_kmem_lru(struct mem_cgroup *mem,
+					     enum mem_cgroup_kmem_lru lru);
+extern unsigned long mem_cgroup_kmem_lru_count(struct mem_cgroup *mem,
+					       enum mem_cgroup_kmem_lru lru);
+extern unsigned long mem_cgroup_shrink_slab(struct mem_cgroup *mem,
+					    unsigned long scanned,
+					    gfp_t gfp_mask);
+#else
+static inline int mem_cgroup_charge_slab(struct page *page, int order,
+					 gfp_t gfp_mask)
+{
+	return 0;
+}
+
+static inline void mem_cgroup_uncharge_slab(struct page *page, int order)
+{
+}
+
+static inline unsigned long mem_cgroup_shrink_slab(struct mem_cgroup *mem,
+						   unsigned long scanned,
+						   gfp_t gfp_mask)
+{
+	return 0;
+}
+#endif /* CONFIG_CGROUP_MEM_RES_CTLR_KMEM */
+
 #endif /* _LINUX_MEMCONTROL_H */
 
@@ -214,6 +214,13 @@ extern bool mempolicy_nodemask_intersects(struct task_struct *tsk,
 				const nodemask_t *mask);
 extern unsigned slab_node(struct mempolicy *policy);
 
+#ifdef CONFIG_NUMA_BALANCING
+extern unsigned long change_prot_numa(struct vm_area_struct *vma,
+			unsigned long start, unsigned long end);
+extern int mpol_misplaced(struct page *page, struct vm_area_struct *vma,
+			unsigned long addr);
+#endif
+
 extern enum zone_type policy_zone;
 
 static inline void check_highest_zone(enum zone_type k)
@@ -65,4 +65,9 @@ static inline int migrate_huge_page_move_mapping(struct address_space *mapping,
 #define fail_migrate_page NULL
 
 #endif /* CONFIG_MIGRATION */
+
+#ifdef CONFIG_NUMA_BALANCING
+extern bool migrate_misplaced_page(struct page *page, int node);
+#endif
+
 #endif /* _LINUX_MIGRATE_H */
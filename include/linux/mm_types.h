@@ -141,6 +141,14 @@ struct vm_area_struct {
 
 	struct rb_node vm_rb;
 
+	/*
+	 * Largest free memory gap in bytes to the left of this VMA.
+	 * Either between this VMA and vma->vm_prev, or between one of the
+	 * VMAs below us in the VMA rbtree and its ->vm_prev. This helps
+	 * get_unmapped_area find a free area of the right size.
+	 */
+	unsigned long rb_subtree_gap;
+
 	/*
 	 * For areas with an address space and backing store,
 	 * linkage into the address_space->i_mmap prio tree, or
@@ -183,6 +191,13 @@ struct vm_area_struct {
 #ifdef CONFIG_NUMA
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
+#ifdef CONFIG_SWAP
+	atomic_long_t swap_readahead_info; /* see mm/swap_state.c */
+#endif
+#ifdef CONFIG_KSM
+	unsigned short vm_ksm_quiet;	/* ksmd visits without a change */
+	unsigned short vm_ksm_skip;	/* ksmd visits left to skip */
+#endif
 };
 
 struct core_thread {
@@ -312,6 +327,25 @@ struct mm_struct {
 #endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	pgtable_t pmd_huge_pte; /* protected by page_table_lock */
+#endif
+#ifdef CONFIG_ARCH_WANT_BATCHED_UNMAP_TLB_FLUSH
+	/*
+	 * Reclaim cleared a pte of this mm and left the TLB flush to the
+	 * end of its batch.  Anyone who finds that pte clear under the pte
+	 * lock and relies on it being gone from the TLBs must flush first,
+	 * see flush_tlb_batched_pending().
+	 */
+	bool tlb_flush_batched;
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	/*
+	 * Hinting fault scanner state: when the next scan is due (jiffies),
+	 * where in the address space it resumes, and how many full passes
+	 * over the address space have been made.
+	 */
+	unsigned long numa_next_scan;
+	unsigned long numa_scan_offset;
+	int numa_scan_seq;
 #endif
 	/* How many tasks sharing this mm are OOM_DISABLE */
 	atomic_t oom_disable_count;
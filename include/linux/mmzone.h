@@ -280,6 +280,16 @@ struct zone_reclaim_stat {
 	unsigned long		nr_saved_scan[NR_LRU_LISTS];
 };
 
+/*
+ * The LRU lists of pages in one zone.  Without the memory controller
+ * every zone has one set, embedded in struct zone.  With it, each memory
+ * cgroup has its own set per zone and a page is on exactly one of them,
+ * the one of the cgroup it is charged to.
+ */
+struct lruvec {
+	struct list_head lists[NR_LRU_LISTS];
+};
+
 struct zone {
 	/* Fields commonly accessed by the page allocator */
 
@@ -345,9 +355,7 @@ struct zone {
 
 	/* Fields commonly accessed by the page reclaim scanner */
 	spinlock_t		lru_lock;	
-	struct zone_lru {
-		struct list_head list;
-	} lru[NR_LRU_LISTS];
+	struct lruvec		lruvec;
 
 	struct zone_reclaim_stat reclaim_stat;
 
@@ -597,6 +605,17 @@ struct node_active_region {
 extern struct page *mem_map;
 #endif
 
+#define MAX_KSWAPD_THREADS	16
+
+struct kswapd_thread {
+	struct task_struct *task;
+	struct pglist_data *pgdat;
+	int id;			/* 0 is the primary kswapd */
+	unsigned long nr_runs;		/* balance_pgdat() calls */
+	unsigned long nr_scanned;	/* LRU pages scanned */
+	unsigned long nr_reclaimed;	/* pages reclaimed */
+};
+
 /*
  * The pg_data_t structure is used in machines with CONFIG_DISCONTIGMEM
  * (mostly NUMA machines?) to denote a higher-level memory zone than the
@@ -641,6 +660,21 @@ typedef struct pglist_data {
 	struct task_struct *kswapd;
 	int kswapd_max_order;
 	enum zone_type classzone_idx;
+	/*
+	 * Helper kswapd threads split the scanning done by balance_pgdat()
+	 * with the primary thread above, which kicks them through
+	 * kswapd_helper_wait.  kswapd_threads[0] accounts the primary.
+	 */
+	int nr_kswapd_threads;
+	unsigned long kswapd_helper_seq;
+	int kswapd_helper_order;
+	enum zone_type kswapd_helper_classzone_idx;
+	wait_queue_head_t kswapd_helper_wait;
+	struct kswapd_thread kswapd_threads[MAX_KSWAPD_THREADS];
+#ifdef CONFIG_COMPACTION
+	wait_queue_head_t kcompactd_wait;
+	struct task_struct *kcompactd;
+#endif
 } pg_data_t;
 
 #define node_present_pages(nid)	(NODE_DATA(nid)->node_present_pages)
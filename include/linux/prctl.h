@@ -102,4 +102,11 @@
 
 #define PR_MCE_KILL_GET 34
 
+/*
+ * Get/set the priority at which KSM scans this process's mergeable areas
+ * (see Documentation/vm/ksm.txt): 0, the default, is lowest.
+ */
+#define PR_SET_KSM_PRIORITY	35
+#define PR_GET_KSM_PRIORITY	36
+
 #endif /* _LINUX_PRCTL_H */
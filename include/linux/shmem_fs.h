@@ -32,6 +32,7 @@ struct shmem_sb_info {
 	gid_t gid;		    /* Mount gid for root directory */
 	mode_t mode;		    /* Mount mode for root directory */
 	struct mempolicy *mpol;     /* default memory policy for mappings */
+	unsigned char huge;	    /* Whether to try for hugepages */
 };
 
 static inline struct shmem_inode_info *SHMEM_I(struct inode *inode)
@@ -42,4 +43,14 @@ static inline struct shmem_inode_info *SHMEM_I(struct inode *inode)
 extern int init_tmpfs(void);
 extern int shmem_fill_super(struct super_block *sb, void *data, int silent);
 
+#if defined(CONFIG_SHMEM) && defined(CONFIG_TRANSPARENT_HUGEPAGE)
+extern struct kobj_attribute shmem_enabled_attr;
+extern int shmem_huge_enabled(struct vm_area_struct *vma);
+#else
+static inline int shmem_huge_enabled(struct vm_area_struct *vma)
+{
+	return 0;
+}
+#endif
+
 #endif
@@ -76,6 +76,13 @@
 # define SLAB_FAILSLAB		0x00000000UL
 #endif
 
+/* Charge slab pages to the memory cgroup of the allocating task */
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+# define SLAB_ACCOUNT		0x04000000UL
+#else
+# define SLAB_ACCOUNT		0x00000000UL
+#endif
+
 /* The following flags affect the page allocator grouping pages by mobility */
 #define SLAB_RECLAIM_ACCOUNT	0x00020000UL		/* Objects are reclaimable */
 #define SLAB_TEMPORARY		SLAB_RECLAIM_ACCOUNT	/* Objects are short-lived */
@@ -104,6 +111,8 @@ struct kmem_cache *kmem_cache_create(const char *, size_t, size_t,
 void kmem_cache_destroy(struct kmem_cache *);
 int kmem_cache_shrink(struct kmem_cache *);
 void kmem_cache_free(struct kmem_cache *, void *);
+int kmem_cache_alloc_bulk(struct kmem_cache *, gfp_t, size_t, void **);
+void kmem_cache_free_bulk(struct kmem_cache *, size_t, void **);
 unsigned int kmem_cache_size(struct kmem_cache *);
 const char *kmem_cache_name(struct kmem_cache *);
 
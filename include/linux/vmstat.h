@@ -42,13 +42,31 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		PGINODESTEAL, SLABS_SCANNED, KSWAPD_STEAL, KSWAPD_INODESTEAL,
 		KSWAPD_LOW_WMARK_HIT_QUICKLY, KSWAPD_HIGH_WMARK_HIT_QUICKLY,
 		KSWAPD_SKIP_CONGESTION_WAIT,
-		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+		KSWAPD_HELPER_WAKE, KSWAPD_HELPER_STEAL,
+		PAGEOUTRUN, ALLOCSTALL, PGROTATED, PGLAZYFREED,
+		LRU_LOCK_CONTENDED, LRU_LOCK_BREAK,
+		FILE_RA_HIT, FILE_RA_WASTE, FILE_RA_STRIDE, FILE_RA_REPLAY,
+#ifdef CONFIG_SWAP
+		SWAP_RA, SWAP_RA_HIT,
+#endif
 #ifdef CONFIG_COMPACTION
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
+		KCOMPACTD_WAKE, KCOMPACTD_THROTTLE,
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+		NUMA_PTE_UPDATES,
+		NUMA_HINT_FAULTS,
+		NUMA_HINT_FAULTS_LOCAL,
+		NUMA_PAGE_MIGRATE,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
+#endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+		THP_SHMEM_ALLOC, THP_SHMEM_FALLBACK,
+		THP_SHMEM_PMD_MAPPED, THP_SHMEM_PMD_SPLIT,
+		THP_SHMEM_COLLAPSE,
 #endif
 		UNEVICTABLE_PGCULLED,	/* culled to noreclaim list */
 		UNEVICTABLE_PGSCANNED,	/* scanned for reclaimability */
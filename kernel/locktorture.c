@@ -0,0 +1,374 @@
+/*
+ * Module-based torture test facility for locking primitives
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * Modelled on kernel/rcutorture.c.  A set of writer threads hammer a
+ * single lock; each acquisition checks that nobody else is inside the
+ * critical section.  The statistics give the acquisition rate, which
+ * measures lock throughput under contention, and the spread between
+ * the busiest and the least busy writer, which measures fairness.
+ */
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/err.h>
+#include <linux/spinlock.h>
+#include <linux/sched.h>
+#include <linux/moduleparam.h>
+#include <linux/delay.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+
+MODULE_LICENSE("GPL");
+
+static int nwriters_stress = -1; /* # writer threads, defaults to 2*ncpus */
+static int stat_interval = 60;	/* Interval between stats, in seconds. */
+static int hold_ns;		/* Critical section length, in nanoseconds. */
+static int long_hold = 1;	/* Occasionally hold the lock for longer. */
+static int verbose;		/* Print more debug info. */
+static char *torture_type = "spin_lock"; /* Which lock to torture. */
+
+module_param(nwriters_stress, int, 0444);
+MODULE_PARM_DESC(nwriters_stress, "Number of write-locking stress-test threads");
+module_param(stat_interval, int, 0444);
+MODULE_PARM_DESC(stat_interval, "Number of seconds between stats printk()s");
+module_param(hold_ns, int, 0444);
+MODULE_PARM_DESC(hold_ns, "Time spent holding the lock (ns)");
+module_param(long_hold, bool, 0444);
+MODULE_PARM_DESC(long_hold, "Occasionally hold the lock for a few ms");
+module_param(verbose, bool, 0444);
+MODULE_PARM_DESC(verbose, "Enable verbose debugging printk()s");
+module_param(torture_type, charp, 0444);
+MODULE_PARM_DESC(torture_type, "Type of lock to torture (spin_lock, spin_lock_irq)");
+
+#define TORTURE_FLAG "-torture:"
+#define VERBOSE_PRINTK_STRING(s) \
+	do { if (verbose) printk(KERN_ALERT "%s" TORTURE_FLAG s "\n", torture_type); } while (0)
+#define VERBOSE_PRINTK_ERRSTRING(s) \
+	do { if (verbose) printk(KERN_ALERT "%s" TORTURE_FLAG "!!! " s "\n", torture_type); } while (0)
+
+static int nrealwriters_stress;
+static struct task_struct **writer_tasks;
+static struct task_struct *stats_task;
+
+static bool lock_is_write_held;
+static atomic_t n_lock_torture_errors;
+static unsigned long lock_torture_start;
+
+struct lock_writer_stress_stats {
+	long n_write_lock_fail;
+	long n_write_lock_acquired;
+};
+static struct lock_writer_stress_stats *lwsa;
+
+struct lock_torture_ops {
+	void (*init)(void);
+	int (*writelock)(void);
+	void (*write_delay)(void);
+	void (*writeunlock)(void);
+	const char *name;
+};
+
+static struct lock_torture_ops *cur_ops;
+
+/*
+ * Definitions for spinlock torture testing.
+ */
+static DEFINE_SPINLOCK(torture_spinlock);
+
+static int torture_spin_lock_write_lock(void) __acquires(torture_spinlock)
+{
+	spin_lock(&torture_spinlock);
+	return 0;
+}
+
+static void torture_spin_lock_write_delay(void)
+{
+	/*
+	 * Once in a while hold the lock long enough for every other
+	 * writer to queue up behind us; otherwise just for hold_ns.
+	 */
+	if (long_hold && !(random32() % (nrealwriters_stress * 2000)))
+		mdelay(2);
+	else if (hold_ns)
+		ndelay(hold_ns);
+}
+
+static void torture_spin_lock_write_unlock(void) __releases(torture_spinlock)
+{
+	spin_unlock(&torture_spinlock);
+}
+
+static struct lock_torture_ops spin_lock_ops = {
+	.writelock	= torture_spin_lock_write_lock,
+	.write_delay	= torture_spin_lock_write_delay,
+	.writeunlock	= torture_spin_lock_write_unlock,
+	.name		= "spin_lock"
+};
+
+static int torture_spin_lock_write_lock_irq(void) __acquires(torture_spinlock)
+{
+	spin_lock_irq(&torture_spinlock);
+	return 0;
+}
+
+static void torture_spin_lock_write_unlock_irq(void) __releases(torture_spinlock)
+{
+	spin_unlock_irq(&torture_spinlock);
+}
+
+static struct lock_torture_ops spin_lock_irq_ops = {
+	.writelock	= torture_spin_lock_write_lock_irq,
+	.write_delay	= torture_spin_lock_write_delay,
+	.writeunlock	= torture_spin_lock_write_unlock_irq,
+	.name		= "spin_lock_irq"
+};
+
+/*
+ * Lock torture writer kthread.  Repeatedly acquires and releases
+ * the lock, checking for duplicate acquisitions.
+ */
+static int lock_torture_writer(void *arg)
+{
+	struct lock_writer_stress_stats *lwsp = arg;
+
+	VERBOSE_PRINTK_STRING("lock_torture_writer task started");
+	set_user_nice(current, 19);
+
+	do {
+		cur_ops->writelock();
+		if (lock_is_write_held)
+			lwsp->n_write_lock_fail++;
+		lock_is_write_held = true;
+		lwsp->n_write_lock_acquired++;
+		cur_ops->write_delay();
+		lock_is_write_held = false;
+		cur_ops->writeunlock();
+		cond_resched();
+	} while (!kthread_should_stop());
+	VERBOSE_PRINTK_STRING("lock_torture_writer task stopping");
+	return 0;
+}
+
+/*
+ * Create a lock-torture-statistics message in the specified buffer.
+ */
+static void lock_torture_printk(char *page)
+{
+	long fail = 0;
+	int i, n_stress;
+	long max = 0;
+	long min = lwsa[0].n_write_lock_acquired;
+	long long sum = 0;
+	unsigned long secs;
+
+	n_stress = nrealwriters_stress;
+	for (i = 0; i < n_stress; i++) {
+		fail += lwsa[i].n_write_lock_fail;
+		sum += lwsa[i].n_write_lock_acquired;
+		if (max < lwsa[i].n_write_lock_acquired)
+			max = lwsa[i].n_write_lock_acquired;
+		if (min > lwsa[i].n_write_lock_acquired)
+			min = lwsa[i].n_write_lock_acquired;
+	}
+	secs = (jiffies - lock_torture_start) / HZ;
+	page += sprintf(page, "%s%s ", torture_type, TORTURE_FLAG);
+	page += sprintf(page,
+			"Writes:  Total: %lld  Max/Min: %ld/%ld %s  Fail: %ld %s",
+			sum, max, min, max / 2 > min ? "???" : "",
+			fail, fail ? "!!!" : "");
+	page += sprintf(page, "  Rate: %llu/s\n",
+			secs ? div_u64(sum, secs) : 0ULL);
+	if (fail)
+		atomic_inc(&n_lock_torture_errors);
+}
+
+/*
+ * Print torture statistics.  Caller must ensure that there is only
+ * one call to this function at a given time!!!  This is normally
+ * accomplished by relying on the module system to only have one copy
+ * of the module loaded, and then by giving the lock_torture_stats
+ * kthread full control (or the init/cleanup functions when lock_torture_stats
+ * thread is not running).
+ */
+static void lock_torture_stats_print(void)
+{
+	int size = nrealwriters_stress * 200 + 8192;
+	char *buf;
+
+	buf = kmalloc(size, GFP_KERNEL);
+	if (!buf) {
+		printk(KERN_ERR "lock_torture_stats_print: Out of memory, need: %d",
+		       size);
+		return;
+	}
+	lock_torture_printk(buf);
+	printk(KERN_ALERT "%s", buf);
+	kfree(buf);
+}
+
+/*
+ * Periodically prints torture statistics, if periodic statistics printing
+ * was specified via the stat_interval module parameter.
+ */
+static int lock_torture_stats(void *arg)
+{
+	VERBOSE_PRINTK_STRING("lock_torture_stats task started");
+	do {
+		schedule_timeout_interruptible(stat_interval * HZ);
+		lock_torture_stats_print();
+	} while (!kthread_should_stop());
+	VERBOSE_PRINTK_STRING("lock_torture_stats task stopping");
+	return 0;
+}
+
+static inline void
+lock_torture_print_module_parms(struct lock_torture_ops *cur_ops,
+				const char *tag)
+{
+	printk(KERN_ALERT "%s" TORTURE_FLAG
+	       "--- %s: nwriters_stress=%d stat_interval=%d hold_ns=%d "
+	       "long_hold=%d verbose=%d\n",
+	       torture_type, tag, nrealwriters_stress, stat_interval, hold_ns,
+	       long_hold, verbose);
+}
+
+static void lock_torture_cleanup(void)
+{
+	int i;
+
+	if (writer_tasks) {
+		for (i = 0; i < nrealwriters_stress; i++) {
+			if (writer_tasks[i]) {
+				VERBOSE_PRINTK_STRING(
+					"Stopping lock_torture_writer task");
+				kthread_stop(writer_tasks[i]);
+			}
+			writer_tasks[i] = NULL;
+		}
+		kfree(writer_tasks);
+		writer_tasks = NULL;
+	}
+
+	if (stats_task) {
+		VERBOSE_PRINTK_STRING("Stopping lock_torture_stats task");
+		kthread_stop(stats_task);
+	}
+	stats_task = NULL;
+
+	if (lwsa) {
+		lock_torture_stats_print();  /* -After- the stats thread is stopped! */
+		kfree(lwsa);
+		lwsa = NULL;
+	}
+
+	if (atomic_read(&n_lock_torture_errors))
+		lock_torture_print_module_parms(cur_ops,
+						"End of test: FAILURE");
+	else
+		lock_torture_print_module_parms(cur_ops,
+						"End of test: SUCCESS");
+}
+
+static int __init lock_torture_init(void)
+{
+	int i;
+	int firsterr = 0;
+	static struct lock_torture_ops *torture_ops[] =
+		{ &spin_lock_ops, &spin_lock_irq_ops, };
+
+	/* Process args and tell the world that the torturer is on the job. */
+	for (i = 0; i < ARRAY_SIZE(torture_ops); i++) {
+		cur_ops = torture_ops[i];
+		if (strcmp(torture_type, cur_ops->name) == 0)
+			break;
+	}
+	if (i == ARRAY_SIZE(torture_ops)) {
+		printk(KERN_ALERT "lock-torture: invalid torture type: \"%s\"\n",
+		       torture_type);
+		printk(KERN_ALERT "lock-torture types:");
+		for (i = 0; i < ARRAY_SIZE(torture_ops); i++)
+			printk(KERN_ALERT " %s", torture_ops[i]->name);
+		printk(KERN_ALERT "\n");
+		return -EINVAL;
+	}
+	if (cur_ops->init)
+		cur_ops->init(); /* no "goto unwind" prior to this point!!! */
+
+	if (nwriters_stress >= 0)
+		nrealwriters_stress = nwriters_stress;
+	else
+		nrealwriters_stress = 2 * num_online_cpus();
+	if (!nrealwriters_stress)
+		return -EINVAL;
+	lock_torture_print_module_parms(cur_ops, "Start of test");
+
+	/* Initialize the statistics so that each run gets its own numbers. */
+
+	lock_is_write_held = false;
+	atomic_set(&n_lock_torture_errors, 0);
+	lwsa = kcalloc(nrealwriters_stress, sizeof(*lwsa), GFP_KERNEL);
+	if (lwsa == NULL) {
+		VERBOSE_PRINTK_STRING("lwsa: Out of memory");
+		firsterr = -ENOMEM;
+		goto unwind;
+	}
+	lock_torture_start = jiffies;
+
+	/* Start up the kthreads. */
+
+	writer_tasks = kcalloc(nrealwriters_stress, sizeof(writer_tasks[0]),
+			       GFP_KERNEL);
+	if (writer_tasks == NULL) {
+		VERBOSE_PRINTK_ERRSTRING("writer_tasks: Out of memory");
+		firsterr = -ENOMEM;
+		goto unwind;
+	}
+	for (i = 0; i < nrealwriters_stress; i++) {
+		VERBOSE_PRINTK_STRING("Creating lock_torture_writer task");
+		writer_tasks[i] = kthread_run(lock_torture_writer, &lwsa[i],
+					      "lock_torture_writer");
+		if (IS_ERR(writer_tasks[i])) {
+			firsterr = PTR_ERR(writer_tasks[i]);
+			VERBOSE_PRINTK_ERRSTRING("Failed to create writer");
+			writer_tasks[i] = NULL;
+			goto unwind;
+		}
+	}
+	if (stat_interval > 0) {
+		VERBOSE_PRINTK_STRING("Creating lock_torture_stats task");
+		stats_task = kthread_run(lock_torture_stats, NULL,
+					 "lock_torture_stats");
+		if (IS_ERR(stats_task)) {
+			firsterr = PTR_ERR(stats_task);
+			VERBOSE_PRINTK_ERRSTRING("Failed to create stats");
+			stats_task = NULL;
+			goto unwind;
+		}
+	}
+	return 0;
+
+unwind:
+	lock_torture_cleanup();
+	return firsterr;
+}
+
+module_init(lock_torture_init);
+module_exit(lock_torture_cleanup);
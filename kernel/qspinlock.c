@@ -0,0 +1,145 @@
+/*
+ * kernel/qspinlock.c
+ *
+ * Queued spinlock slowpath.
+ *
+ * A contended lock keeps an MCS style queue of waiters.  Each waiter
+ * brings a queue node from its cpu and spins on that node only; the
+ * lock word just records the locked byte and the tail of the queue.
+ * Lock handoff therefore touches one remote cacheline per waiter, no
+ * matter how many cpus are queued.
+ *
+ * Since the tail has to fit in the lock word along with the locked
+ * byte, it is encoded as (cpu + 1, nesting index) rather than as a
+ * pointer.  A cpu may be queued on up to four locks at once: one in
+ * each of task, softirq, hardirq and nmi context.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/smp.h>
+#include <linux/bug.h>
+#include <linux/percpu.h>
+#include <linux/module.h>
+#include <linux/spinlock.h>
+
+struct mcs_spinlock {
+	struct mcs_spinlock *next;
+	int locked;		/* 1 once we are at the head of the queue */
+	int count;		/* nesting level, kept in the first node */
+};
+
+#define MAX_NODES	4
+
+static DEFINE_PER_CPU_ALIGNED(struct mcs_spinlock, mcs_nodes[MAX_NODES]);
+
+static inline u32 encode_tail(int cpu, int idx)
+{
+	u32 tail;
+
+	tail  = (cpu + 1) << _Q_TAIL_CPU_OFFSET;
+	tail |= idx << _Q_TAIL_IDX_OFFSET;
+
+	return tail;
+}
+
+static inline struct mcs_spinlock *decode_tail(u32 tail)
+{
+	int cpu = (tail >> _Q_TAIL_CPU_OFFSET) - 1;
+	int idx = (tail & _Q_TAIL_IDX_MASK) >> _Q_TAIL_IDX_OFFSET;
+
+	return per_cpu_ptr(&mcs_nodes[idx], cpu);
+}
+
+/**
+ * queued_spin_lock_slowpath - acquire a contended queued spinlock
+ * @lock: the lock
+ *
+ * Called with preemption disabled, after the fastpath cmpxchg failed.
+ */
+void queued_spin_lock_slowpath(struct qspinlock *lock)
+{
+	struct mcs_spinlock *prev, *next, *node;
+	u32 val, new, old, tail;
+	int idx;
+
+	BUILD_BUG_ON(CONFIG_NR_CPUS >= (1U << _Q_TAIL_CPU_BITS));
+
+	node = this_cpu_ptr(&mcs_nodes[0]);
+	idx = node->count++;
+	BUG_ON(idx >= MAX_NODES);
+	tail = encode_tail(smp_processor_id(), idx);
+
+	node += idx;
+	node->locked = 0;
+	node->next = NULL;
+
+	/*
+	 * The lock may well have been released while we set up the node;
+	 * try once more before queueing.
+	 */
+	if (queued_spin_trylock(lock))
+		goto release;
+
+	/*
+	 * Publish ourselves as the new tail.  The locked byte belongs to
+	 * the owner and is carried over unchanged.
+	 */
+	val = atomic_read(&lock->val);
+	for (;;) {
+		new = (val & _Q_LOCKED_MASK) | tail;
+		old = atomic_cmpxchg(&lock->val, val, new);
+		if (old == val)
+			break;
+		val = old;
+	}
+
+	/*
+	 * If there was a previous tail, link in behind it and wait for it
+	 * to pass us the head of the queue.
+	 */
+	if (old & _Q_TAIL_MASK) {
+		prev = decode_tail(old);
+		ACCESS_ONCE(prev->next) = node;
+
+		while (!ACCESS_ONCE(node->locked))
+			cpu_relax();
+	}
+
+	/*
+	 * We are at the head of the queue.  Wait for the owner to let go
+	 * and take the lock; nobody but the head of the queue can set the
+	 * locked byte while there is a tail.  If we are the tail as well,
+	 * clear it so the lock reads as uncontended again.
+	 */
+	for (;;) {
+		val = atomic_read(&lock->val);
+		if (val & _Q_LOCKED_MASK) {
+			cpu_relax();
+			continue;
+		}
+
+		new = _Q_LOCKED_VAL;
+		if ((val & _Q_TAIL_MASK) != tail)
+			new |= val;
+
+		if (atomic_cmpxchg(&lock->val, val, new) == val)
+			break;
+	}
+
+	/*
+	 * Somebody queued behind us: wait for them to link in and hand
+	 * over the head of the queue.
+	 */
+	if (new != _Q_LOCKED_VAL) {
+		while (!(next = ACCESS_ONCE(node->next)))
+			cpu_relax();
+		ACCESS_ONCE(next->locked) = 1;
+	}
+
+release:
+	__this_cpu_dec(mcs_nodes[0].count);
+}
+EXPORT_SYMBOL(queued_spin_lock_slowpath);
@@ -291,11 +291,16 @@ static void print_cpu(struct seq_file *m, int cpu)
 	P(sched_goidle);
 #ifdef CONFIG_SMP
 	P64(avg_idle);
+	P64(max_idle_balance_cost);
 #endif
 
 	P(ttwu_count);
 	P(ttwu_local);
 
+	P(idle_balance_count);
+	P(idle_balance_skip);
+	P(idle_balance_pulled);
+
 	SEQ_printf(m, "  .%-30s: %d\n", "bkl_count",
 				rq->rq_sched_info.bkl_count);
 
@@ -37,6 +37,7 @@
 #include <linux/ptrace.h>
 #include <linux/fs_struct.h>
 #include <linux/gfp.h>
+#include <linux/ksm.h>
 
 #include <linux/compat.h>
 #include <linux/syscalls.h>
@@ -1736,6 +1737,18 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			else
 				error = PR_MCE_KILL_DEFAULT;
 			break;
+		case PR_SET_KSM_PRIORITY:
+			if (arg3 | arg4 | arg5)
+				return -EINVAL;
+			error = ksm_set_priority(me->mm, arg2);
+			break;
+		case PR_GET_KSM_PRIORITY:
+			if (arg2 | arg3 | arg4 | arg5)
+				return -EINVAL;
+			if (!me->mm)
+				return -EINVAL;
+			error = ksm_mm_priority(me->mm);
+			break;
 		default:
 			error = -EINVAL;
 			break;
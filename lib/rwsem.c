@@ -24,6 +24,9 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 	sem->count = RWSEM_UNLOCKED_VALUE;
 	spin_lock_init(&sem->wait_lock);
 	INIT_LIST_HEAD(&sem->wait_list);
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	sem->owner = NULL;
+#endif
 }
 
 EXPORT_SYMBOL(__init_rwsem);
@@ -194,14 +197,13 @@ rwsem_down_failed_common(struct rw_semaphore *sem,
 
 	/* If there are no active locks, wake the front queued process(es) up.
 	 *
-	 * Alternatively, if we're called from a failed down_write(), there
-	 * were already threads queued before us and there are no active
-	 * writers, the lock must be read owned; so we try to wake any read
-	 * locks that were queued ahead of us. */
+	 * Alternatively, if we're called from a failed down_write() and
+	 * there are no active writers, the lock must be read owned; so we
+	 * try to wake any read locks that were queued ahead of us. */
 	if (count == RWSEM_WAITING_BIAS)
 		sem = __rwsem_do_wake(sem, RWSEM_WAKE_NO_ACTIVE);
 	else if (count > RWSEM_WAITING_BIAS &&
-		 adjustment == -RWSEM_ACTIVE_WRITE_BIAS)
+		 (flags & RWSEM_WAITING_FOR_WRITE))
 		sem = __rwsem_do_wake(sem, RWSEM_WAKE_READ_OWNED);
 
 	spin_unlock_irq(&sem->wait_lock);
@@ -219,6 +221,113 @@ rwsem_down_failed_common(struct rw_semaphore *sem,
 	return sem;
 }
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+/*
+ * Optimistic spinning for writers, modelled on the mutex slowpath.
+ *
+ * Spinning is only worth it while the rwsem is write owned by a task
+ * that is running on another cpu, or is momentarily free.  Once
+ * there are waiters the lock is handed to them from the wakeup path,
+ * so a new writer cannot take it and has to queue behind them.
+ */
+static inline int rwsem_can_spin(struct rw_semaphore *sem)
+{
+	/*
+	 * If we own the BKL, then don't spin.  The owner of the rwsem
+	 * might be waiting on us to release the BKL.
+	 */
+	if (unlikely(current->lock_depth >= 0))
+		return 0;
+
+	if (need_resched())
+		return 0;
+
+	return list_empty(&sem->wait_list);
+}
+
+/*
+ * The failed down_write() left its active write bias in the count.
+ * Take it back out, and if that leaves the rwsem with no active
+ * lockers but with waiters, someone who released it meanwhile may
+ * have skipped the wakeup because of our bias: issue it ourselves.
+ */
+static inline void rwsem_undo_write_bias(struct rw_semaphore *sem)
+{
+	unsigned long flags;
+	signed long count;
+
+	count = rwsem_atomic_update(-RWSEM_ACTIVE_WRITE_BIAS, sem);
+	if (count != RWSEM_WAITING_BIAS)
+		return;
+
+	spin_lock_irqsave(&sem->wait_lock, flags);
+	if (!list_empty(&sem->wait_list))
+		sem = __rwsem_do_wake(sem, RWSEM_WAKE_ANY);
+	spin_unlock_irqrestore(&sem->wait_lock, flags);
+}
+
+static int rwsem_optimistic_spin(struct rw_semaphore *sem)
+{
+	struct thread_info *owner;
+	int taken = 0;
+
+	preempt_disable();
+	for (;;) {
+		/*
+		 * If there's an owner, wait for it to either release the
+		 * rwsem or go to sleep.
+		 */
+		owner = ACCESS_ONCE(sem->owner);
+		if (owner && !rwsem_spin_on_owner(sem, owner))
+			break;
+
+		if (__down_write_trylock(sem)) {
+			taken = 1;
+			break;
+		}
+
+		/* Waiters queued up behind the owner, get in line too. */
+		if (!list_empty(&sem->wait_list))
+			break;
+
+		/*
+		 * A positive count means readers hold it: there is no
+		 * owner to watch and no telling when they will be done.
+		 */
+		if (!owner && ACCESS_ONCE(sem->count) > 0)
+			break;
+
+		/*
+		 * When there's no owner, we might have preempted between
+		 * the owner acquiring the rwsem and setting the owner
+		 * field.  If we're an RT task that will live-lock because
+		 * we won't let the owner complete.
+		 */
+		if (!owner && (need_resched() || rt_task(current)))
+			break;
+
+		arch_mutex_cpu_relax();
+	}
+	preempt_enable();
+
+	return taken;
+}
+#else
+static inline int rwsem_can_spin(struct rw_semaphore *sem)
+{
+	return 0;
+}
+
+static inline void rwsem_undo_write_bias(struct rw_semaphore *sem)
+{
+}
+
+static inline int rwsem_optimistic_spin(struct rw_semaphore *sem)
+{
+	return 0;
+}
+#endif
+
 /*
  * wait for the read lock to be granted
  */
@@ -235,8 +344,17 @@ rwsem_down_read_failed(struct rw_semaphore *sem)
 asmregparm struct rw_semaphore __sched *
 rwsem_down_write_failed(struct rw_semaphore *sem)
 {
+	signed long adjustment = -RWSEM_ACTIVE_WRITE_BIAS;
+
+	if (rwsem_can_spin(sem)) {
+		rwsem_undo_write_bias(sem);
+		if (rwsem_optimistic_spin(sem))
+			return sem;
+		adjustment = 0;
+	}
+
 	return rwsem_down_failed_common(sem, RWSEM_WAITING_FOR_WRITE,
-					-RWSEM_ACTIVE_WRITE_BIAS);
+					adjustment);
 }
 
 /*
@@ -14,6 +14,10 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/cpu.h>
+#include <linux/huge_mm.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -44,6 +48,7 @@ struct compact_control {
 	struct zone *zone;
 
 	int compact_mode;
+	unsigned long deadline;		/* jiffies to stop by, 0 for none */
 };
 
 static unsigned long release_freepages(struct list_head *freelist)
@@ -396,8 +401,12 @@ static int compact_finished(struct zone *zone,
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
 
+	/* kcompactd has used up its CPU budget for now */
+	if (cc->deadline && time_after(jiffies, cc->deadline))
+		return COMPACT_PARTIAL;
+
 	/* Compaction run is not finished if the watermark is not met */
-	if (cc->compact_mode != COMPACT_MODE_KSWAPD)
+	if (cc->compact_mode == COMPACT_MODE_DIRECT_RECLAIM)
 		watermark = low_wmark_pages(zone);
 	else
 		watermark = high_wmark_pages(zone);
@@ -406,6 +415,10 @@ static int compact_finished(struct zone *zone,
 	if (!zone_watermark_ok(zone, cc->order, watermark, 0, 0))
 		return COMPACT_CONTINUE;
 
+	/* kcompactd stops as soon as the high watermark is met at its order */
+	if (cc->compact_mode == COMPACT_MODE_PROACTIVE)
+		return COMPACT_PARTIAL;
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -665,6 +678,237 @@ static int compact_nodes(void)
 /* The written value is actually unused, all memory is compacted */
 int sysctl_compact_memory;
 
+/*
+ * Proactive compaction: kcompactd, one thread per node, looks at its zones
+ * every COMPACTION_PROACTIVE_INTERVAL milliseconds.  A zone which is short
+ * of free memory at COMPACTION_PROACTIVE_ORDER, while its fragmentation
+ * index says that is due to fragmentation rather than lack of memory, is
+ * compacted until its high watermark is met at that order.  The higher
+ * compaction_proactiveness, the lower the fragmentation index at which
+ * kcompactd steps in; 0 disables it.  compaction_proactive_cpu bounds the
+ * share of one CPU, in percent, which kcompactd may spend compacting.
+ */
+int sysctl_compaction_proactiveness;
+int sysctl_compaction_proactive_cpu = 5;
+
+#define COMPACTION_PROACTIVE_INTERVAL	500	/* milliseconds */
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define COMPACTION_PROACTIVE_ORDER	HPAGE_PMD_ORDER
+#else
+#define COMPACTION_PROACTIVE_ORDER	PAGE_ALLOC_COSTLY_ORDER
+#endif
+
+/* Bumped to have kcompactd look at its tunables again */
+static unsigned long kcompactd_seq;
+
+/*
+ * Does kcompactd have work in this zone?  The fragmentation index tends
+ * towards 1000 when the free memory is there but scattered: it is -1000
+ * when some free blocks of the order exist, just not enough of them.
+ */
+static bool kcompactd_zone_fragmented(struct zone *zone, int order)
+{
+	int fragindex;
+
+	if (zone_watermark_ok(zone, order,
+			      high_wmark_pages(zone) + (1 << order), 0, 0))
+		return false;
+
+	fragindex = fragmentation_index(zone, order);
+	if (fragindex >= 0 &&
+	    fragindex <= 1000 - 5 * sysctl_compaction_proactiveness)
+		return false;
+
+	return compaction_suitable(zone, order) == COMPACT_CONTINUE;
+}
+
+/*
+ * Compact the fragmented zones of a node, spending at most the budget that
+ * compaction_proactive_cpu gives one interval.  A zone which a complete
+ * pass could not bring up to its watermark is left alone for 1, 2, 4 ... up
+ * to 1 << COMPACT_MAX_DEFER_SHIFT intervals, so as not to churn in vain.
+ * Returns the jiffies spent.
+ */
+static unsigned long kcompactd_do_work(pg_data_t *pgdat,
+				       unsigned int *defer_shift,
+				       unsigned int *deferred)
+{
+	int order = COMPACTION_PROACTIVE_ORDER;
+	unsigned long start = jiffies;
+	unsigned long budget;
+	bool drained = false;
+	int zoneid;
+	int ret;
+
+	budget = msecs_to_jiffies(COMPACTION_PROACTIVE_INTERVAL) *
+			sysctl_compaction_proactive_cpu / 100;
+	budget = max(budget, 1UL);
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+			.sync = false,
+			.compact_mode = COMPACT_MODE_PROACTIVE,
+			.deadline = start + budget,
+		};
+
+		if (!populated_zone(zone))
+			continue;
+		if (deferred[zoneid]) {
+			deferred[zoneid]--;
+			continue;
+		}
+		if (!kcompactd_zone_fragmented(zone, order))
+			continue;
+		if (time_after_eq(jiffies, cc.deadline)) {
+			count_vm_event(KCOMPACTD_THROTTLE);
+			break;
+		}
+
+		/* Flush this CPU's pending updates to the LRU lists */
+		if (!drained) {
+			lru_add_drain();
+			drained = true;
+		}
+		count_vm_event(KCOMPACTD_WAKE);
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		ret = compact_zone(zone, &cc);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+
+		if (ret == COMPACT_COMPLETE &&
+		    kcompactd_zone_fragmented(zone, order)) {
+			deferred[zoneid] = (1U << defer_shift[zoneid]) - 1;
+			if (defer_shift[zoneid] < COMPACT_MAX_DEFER_SHIFT)
+				defer_shift[zoneid]++;
+		} else if (ret == COMPACT_PARTIAL &&
+			   !time_after(jiffies, cc.deadline)) {
+			defer_shift[zoneid] = 0;
+		}
+	}
+
+	return jiffies - start;
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	unsigned int defer_shift[MAX_NR_ZONES] = { 0, };
+	unsigned int deferred[MAX_NR_ZONES] = { 0, };
+	unsigned long seq = kcompactd_seq;
+	unsigned long busy = 0;
+	long timeout;
+	int cpu;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		timeout = MAX_SCHEDULE_TIMEOUT;
+		if (sysctl_compaction_proactiveness) {
+			timeout = msecs_to_jiffies(COMPACTION_PROACTIVE_INTERVAL);
+			/* Sleep off whatever went over the CPU budget */
+			cpu = max(sysctl_compaction_proactive_cpu, 1);
+			timeout = max_t(long, timeout,
+					busy * (100 - cpu) / cpu);
+		}
+
+		wait_event_freezable_timeout(pgdat->kcompactd_wait,
+			kthread_should_stop() ||
+			ACCESS_ONCE(kcompactd_seq) != seq, timeout);
+		seq = ACCESS_ONCE(kcompactd_seq);
+
+		busy = 0;
+		if (sysctl_compaction_proactiveness && !kthread_should_stop())
+			busy = kcompactd_do_work(pgdat, defer_shift, deferred);
+	}
+
+	return 0;
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ * On node-hot-add, kcompactd will moved to proper cpus if cpus are hot-added.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		ret = PTR_ERR(pgdat->kcompactd);
+		pgdat->kcompactd = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+/*
+ * It's optimal to keep kcompactd on the same CPUs as their memory, but
+ * not required for correctness.  So if the last cpu in a node goes away,
+ * we get changed to run anywhere: as the first one comes back, restore
+ * their cpu bindings.
+ */
+static int __devinit kcompactd_cpu_callback(struct notifier_block *nfb,
+					    unsigned long action, void *hcpu)
+{
+	int nid;
+
+	if (action == CPU_ONLINE || action == CPU_ONLINE_FROZEN) {
+		for_each_node_state(nid, N_HIGH_MEMORY) {
+			pg_data_t *pgdat = NODE_DATA(nid);
+			const struct cpumask *mask;
+
+			mask = cpumask_of_node(pgdat->node_id);
+
+			if (pgdat->kcompactd &&
+			    cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids)
+				/* One of our CPUs online: restore mask */
+				set_cpus_allowed_ptr(pgdat->kcompactd, mask);
+		}
+	}
+	return NOTIFY_OK;
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	hotcpu_notifier(kcompactd_cpu_callback, 0);
+	return 0;
+}
+module_init(kcompactd_init)
+
 /* This is the entry point for compacting all nodes via /proc/sys/vm */
 int sysctl_compaction_handler(struct ctl_table *table, int write,
 			void __user *buffer, size_t *length, loff_t *ppos)
@@ -683,6 +927,23 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+int sysctl_compaction_proactive_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int nid;
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	kcompactd_seq++;
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		wake_up_interruptible(&NODE_DATA(nid)->kcompactd_wait);
+
+	return 0;
+}
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
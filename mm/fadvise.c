@@ -57,6 +57,8 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 		case POSIX_FADV_WILLNEED:
 		case POSIX_FADV_NOREUSE:
 		case POSIX_FADV_DONTNEED:
+		case FADV_RA_HISTORY:
+		case FADV_RA_NOHISTORY:
 			/* no bad return value, but ignore advice */
 			break;
 		default:
@@ -77,6 +79,7 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 	switch (advice) {
 	case POSIX_FADV_NORMAL:
 		file->f_ra.ra_pages = bdi->ra_pages;
+		file->f_ra.stride_hits = 0;
 		spin_lock(&file->f_lock);
 		file->f_mode &= ~FMODE_RANDOM;
 		spin_unlock(&file->f_lock);
@@ -127,6 +130,16 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 			invalidate_mapping_pages(mapping, start_index,
 						end_index);
 		break;
+	case FADV_RA_HISTORY:
+		if (!mapping->a_ops->readpage) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = page_cache_ra_history_start(mapping);
+		break;
+	case FADV_RA_NOHISTORY:
+		page_cache_ra_history_stop(mapping);
+		break;
 	default:
 		ret = -EINVAL;
 	}
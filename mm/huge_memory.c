@@ -17,6 +17,11 @@
 #include <linux/khugepaged.h>
 #include <linux/freezer.h>
 #include <linux/mman.h>
+#include <linux/file.h>
+#include <linux/pagemap.h>
+#include <linux/pagevec.h>
+#include <linux/migrate.h>
+#include <linux/shmem_fs.h>
 #include <asm/tlb.h>
 #include <asm/pgalloc.h>
 #include "internal.h"
@@ -312,6 +317,9 @@ static struct attribute *hugepage_attr[] = {
 	&defrag_attr.attr,
 #ifdef CONFIG_DEBUG_VM
 	&debug_cow_attr.attr,
+#endif
+#ifdef CONFIG_SHMEM
+	&shmem_enabled_attr.attr,
 #endif
 	NULL,
 };
@@ -709,6 +717,50 @@ out:
 	return handle_pte_fault(mm, vma, address, pte, pmd, flags);
 }
 
+/*
+ * Map HPAGE_PMD_NR naturally aligned and physically contiguous shmem
+ * pages with a single huge pmd.  Unlike anonymous hugepages these are
+ * not compound: every page keeps its own reference and mapcount,
+ * exactly as if it was mapped by its own pte, so the pagecache,
+ * reclaim and truncate never have to know about the huge pmd.
+ *
+ * The caller holds a reference on every page and the references are
+ * transferred to the mapping on success.
+ */
+int do_set_huge_pmd_file(struct vm_area_struct *vma, unsigned long haddr,
+			 pmd_t *pmd, struct page *page, unsigned int flags)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pgtable_t pgtable;
+	pmd_t entry;
+	int i;
+
+	VM_BUG_ON(PageCompound(page));
+	VM_BUG_ON(page_to_pfn(page) & (HPAGE_PMD_NR - 1));
+	pgtable = pte_alloc_one(mm, haddr);
+	if (unlikely(!pgtable))
+		return VM_FAULT_OOM;
+
+	spin_lock(&mm->page_table_lock);
+	if (unlikely(!pmd_none(*pmd))) {
+		spin_unlock(&mm->page_table_lock);
+		pte_free(mm, pgtable);
+		return VM_FAULT_FALLBACK;
+	}
+	entry = pmd_mkhuge(pmd_mkyoung(mk_pmd(page, vma->vm_page_prot)));
+	if (flags & FAULT_FLAG_WRITE)
+		entry = pmd_mkdirty(entry);
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		page_add_file_rmap(page + i);
+	add_mm_counter(mm, MM_FILEPAGES, HPAGE_PMD_NR);
+	set_pmd_at(mm, haddr, pmd, entry);
+	prepare_pmd_huge_pte(pgtable, mm);
+	spin_unlock(&mm->page_table_lock);
+
+	count_vm_event(THP_SHMEM_PMD_MAPPED);
+	return 0;
+}
+
 int copy_huge_pmd(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		  pmd_t *dst_pmd, pmd_t *src_pmd, unsigned long addr,
 		  struct vm_area_struct *vma)
@@ -742,7 +794,23 @@ int copy_huge_pmd(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		goto out;
 	}
 	src_page = pmd_page(pmd);
-	VM_BUG_ON(!PageHead(src_page));
+	if (!PageHead(src_page)) {
+		/*
+		 * Shmem pages, only ever mapped by huge pmds in shared
+		 * mappings: no COW, just share them as copy_one_pte().
+		 */
+		int i;
+
+		for (i = 0; i < HPAGE_PMD_NR; i++) {
+			get_page(src_page + i);
+			page_dup_rmap(src_page + i);
+		}
+		add_mm_counter(dst_mm, MM_FILEPAGES, HPAGE_PMD_NR);
+		set_pmd_at(dst_mm, addr, dst_pmd, pmd_mkold(pmd));
+		prepare_pmd_huge_pte(pgtable, dst_mm);
+		ret = 0;
+		goto out_unlock;
+	}
 	get_page(src_page);
 	page_dup_rmap(src_page);
 	add_mm_counter(dst_mm, MM_ANONPAGES, HPAGE_PMD_NR);
@@ -779,6 +847,26 @@ pgtable_t get_pmd_huge_pte(struct mm_struct *mm)
 	return pgtable;
 }
 
+static pmd_t *mm_find_pmd(struct mm_struct *mm, unsigned long address)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	pgd = pgd_offset(mm, address);
+	if (!pgd_present(*pgd))
+		return NULL;
+
+	pud = pud_offset(pgd, address);
+	if (!pud_present(*pud))
+		return NULL;
+
+	pmd = pmd_offset(pud, address);
+	if (!pmd_present(*pmd))
+		return NULL;
+	return pmd;
+}
+
 static int do_huge_pmd_wp_page_fallback(struct mm_struct *mm,
 					struct vm_area_struct *vma,
 					unsigned long address,
@@ -961,7 +1049,18 @@ struct page *follow_trans_huge_pmd(struct mm_struct *mm,
 		goto out;
 
 	page = pmd_page(*pmd);
-	VM_BUG_ON(!PageHead(page));
+	if (!PageHead(page)) {
+		/* shmem pages: behave as follow_page() does on a pte */
+		page += (addr & ~HPAGE_PMD_MASK) >> PAGE_SHIFT;
+		if (flags & FOLL_GET)
+			get_page(page);
+		if (flags & FOLL_TOUCH) {
+			if ((flags & FOLL_WRITE) && !PageDirty(page))
+				set_page_dirty(page);
+			mark_page_accessed(page);
+		}
+		goto out;
+	}
 	if (flags & FOLL_TOUCH) {
 		pmd_t _pmd;
 		/*
@@ -984,8 +1083,38 @@ out:
 	return page;
 }
 
+/*
+ * Shmem pages mapped by a huge pmd are unmapped one by one, as
+ * zap_pte_range() would have done had they been mapped by ptes.
+ */
+static void zap_file_huge_pmd(struct mmu_gather *tlb, pmd_t *pmd,
+			      unsigned long addr)
+{
+	struct mm_struct *mm = tlb->mm;
+	struct page *page;
+	pgtable_t pgtable;
+	pmd_t orig_pmd;
+	int i;
+
+	pgtable = get_pmd_huge_pte(mm);
+	orig_pmd = pmdp_get_and_clear(mm, addr, pmd);
+	page = pmd_page(orig_pmd);
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		if (pmd_dirty(orig_pmd))
+			set_page_dirty(page + i);
+		if (pmd_young(orig_pmd))
+			mark_page_accessed(page + i);
+		page_remove_rmap(page + i);
+	}
+	add_mm_counter(mm, MM_FILEPAGES, -HPAGE_PMD_NR);
+	spin_unlock(&mm->page_table_lock);
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		tlb_remove_page(tlb, page + i);
+	pte_free(mm, pgtable);
+}
+
 int zap_huge_pmd(struct mmu_gather *tlb, struct vm_area_struct *vma,
-		 pmd_t *pmd)
+		 pmd_t *pmd, unsigned long addr)
 {
 	int ret = 0;
 
@@ -995,6 +1124,9 @@ int zap_huge_pmd(struct mmu_gather *tlb, struct vm_area_struct *vma,
 			spin_unlock(&tlb->mm->page_table_lock);
 			wait_split_huge_page(vma->anon_vma,
 					     pmd);
+		} else if (!PageHead(pmd_page(*pmd))) {
+			zap_file_huge_pmd(tlb, pmd, addr);
+			ret = 1;
 		} else {
 			struct page *page;
 			pgtable_t pgtable;
@@ -1112,6 +1244,47 @@ out:
 	return ret;
 }
 
+/*
+ * Returns the huge pmd mapping the shmem @page at @address, with the
+ * page_table_lock held, or NULL.
+ */
+pmd_t *page_check_file_huge_pmd(struct page *page,
+				struct vm_area_struct *vma,
+				unsigned long address)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pmd_t *pmd;
+
+	if (!vma->vm_ops || !vma->vm_ops->pmd_fault ||
+	    is_vm_hugetlb_page(vma))
+		return NULL;
+	pmd = mm_find_pmd(mm, address);
+	if (!pmd || !pmd_trans_huge(*pmd))
+		return NULL;
+
+	spin_lock(&mm->page_table_lock);
+	if (pmd_trans_huge(*pmd) &&
+	    page_to_pfn(page) - pmd_pfn(*pmd) < HPAGE_PMD_NR)
+		return pmd;
+	spin_unlock(&mm->page_table_lock);
+	return NULL;
+}
+
+/*
+ * Whether the shmem @page, mapped by the huge @pmd that
+ * page_check_file_huge_pmd() returned, was referenced through it.  The
+ * subpages are on the lru one by one but share the pmd's young bit: only
+ * clear it for the first subpage, or the others would all look cold.
+ */
+int file_huge_pmd_referenced(struct page *page, struct vm_area_struct *vma,
+			     unsigned long address, pmd_t *pmd)
+{
+	if (page_to_pfn(page) == pmd_pfn(*pmd))
+		return pmdp_clear_flush_young_notify(vma,
+				address & HPAGE_PMD_MASK, pmd) ? 1 : 0;
+	return pmd_young(*pmd) ? 1 : 0;
+}
+
 static int __split_huge_page_splitting(struct page *page,
 				       struct vm_area_struct *vma,
 				       unsigned long address)
@@ -1399,13 +1572,18 @@ out:
 int hugepage_madvise(struct vm_area_struct *vma,
 		     unsigned long *vm_flags, int advice)
 {
+	unsigned long shared = VM_SHARED | VM_MAYSHARE;
+
+	/* shared mappings of shmem can be mapped by huge pmds too */
+	if (vma->vm_ops && vma->vm_ops->pmd_fault)
+		shared = 0;
+
 	switch (advice) {
 	case MADV_HUGEPAGE:
 		/*
 		 * Be somewhat over-protective like KSM for now!
 		 */
-		if (*vm_flags & (VM_HUGEPAGE |
-				 VM_SHARED   | VM_MAYSHARE   |
+		if (*vm_flags & (VM_HUGEPAGE | shared |
 				 VM_PFNMAP   | VM_IO      | VM_DONTEXPAND |
 				 VM_RESERVED | VM_HUGETLB | VM_INSERTPAGE |
 				 VM_MIXEDMAP | VM_SAO))
@@ -1424,8 +1602,7 @@ int hugepage_madvise(struct vm_area_struct *vma,
 		/*
 		 * Be somewhat over-protective like KSM for now!
 		 */
-		if (*vm_flags & (VM_NOHUGEPAGE |
-				 VM_SHARED   | VM_MAYSHARE   |
+		if (*vm_flags & (VM_NOHUGEPAGE | shared |
 				 VM_PFNMAP   | VM_IO      | VM_DONTEXPAND |
 				 VM_RESERVED | VM_HUGETLB | VM_INSERTPAGE |
 				 VM_MIXEDMAP | VM_SAO))
@@ -1556,21 +1733,29 @@ int __khugepaged_enter(struct mm_struct *mm)
 int khugepaged_enter_vma_merge(struct vm_area_struct *vma)
 {
 	unsigned long hstart, hend;
-	if (!vma->anon_vma)
+	int shmem = shmem_huge_enabled(vma);
+
+	if (!vma->anon_vma && !shmem)
 		/*
 		 * Not yet faulted in so we will register later in the
 		 * page fault if needed.
 		 */
 		return 0;
-	if (vma->vm_file || vma->vm_ops)
-		/* khugepaged not yet working on file or special mappings */
+	if ((vma->vm_file || vma->vm_ops) && !shmem)
+		/* khugepaged only works on shmem among file mappings */
 		return 0;
 	VM_BUG_ON(is_linear_pfn_mapping(vma) || is_pfn_mapping(vma));
 	hstart = (vma->vm_start + ~HPAGE_PMD_MASK) & HPAGE_PMD_MASK;
 	hend = vma->vm_end & HPAGE_PMD_MASK;
-	if (hstart < hend)
-		return khugepaged_enter(vma);
-	return 0;
+	if (hstart >= hend)
+		return 0;
+	if (shmem) {
+		/* the anon enabled/madvise policy does not apply to shmem */
+		if (!test_bit(MMF_VM_HUGEPAGE, &vma->vm_mm->flags))
+			return __khugepaged_enter(vma->vm_mm);
+		return 0;
+	}
+	return khugepaged_enter(vma);
 }
 
 void __khugepaged_exit(struct mm_struct *mm)
@@ -1991,6 +2176,234 @@ static void collect_mm_slot(struct mm_slot *mm_slot)
 	}
 }
 
+/*
+ * khugepaged can't replace shmem pagecache pages with a compound page,
+ * but it can migrate the pages of an aligned block of HPAGE_PMD_NR
+ * indexes into a naturally aligned and physically contiguous extent,
+ * and then throw away the page tables mapping the block, so that the
+ * next fault maps the whole extent with a huge pmd.
+ */
+struct shmem_collapse_control {
+	pgoff_t start;
+	struct page *target;
+	DECLARE_BITMAP(used, HPAGE_PMD_NR);
+};
+
+static struct page *shmem_collapse_new_page(struct page *page,
+					    unsigned long private,
+					    int **result)
+{
+	struct shmem_collapse_control *cc;
+	unsigned long i;
+
+	cc = (struct shmem_collapse_control *)private;
+	i = page->index - cc->start;
+	/*
+	 * A target page is freed if migration to it fails, so it can't be
+	 * handed out twice: returning NULL makes migrate_pages() give up.
+	 */
+	if (i >= HPAGE_PMD_NR || test_and_set_bit(i, cc->used))
+		return NULL;
+	return cc->target + i;
+}
+
+enum shmem_block_state {
+	SHMEM_BLOCK_HOLES,	/* some pages are missing or swapped out */
+	SHMEM_BLOCK_PRESENT,	/* all pages are in the pagecache */
+	SHMEM_BLOCK_EXTENT,	/* ... and form an aligned extent */
+};
+
+static int shmem_block_state(struct address_space *mapping, pgoff_t start)
+{
+	struct page *pages[PAGEVEC_SIZE];
+	struct page *base = NULL;
+	int state = SHMEM_BLOCK_EXTENT;
+	int i, j, nr;
+
+	for (i = 0; i < HPAGE_PMD_NR; i += nr) {
+		nr = find_get_pages_contig(mapping, start + i,
+				min_t(int, PAGEVEC_SIZE, HPAGE_PMD_NR - i),
+				pages);
+		if (!nr)
+			return SHMEM_BLOCK_HOLES;
+		if (!i) {
+			base = pages[0];
+			if (page_to_pfn(base) & (HPAGE_PMD_NR - 1))
+				state = SHMEM_BLOCK_PRESENT;
+		}
+		for (j = 0; j < nr; j++) {
+			if (pages[j] != base + i + j)
+				state = SHMEM_BLOCK_PRESENT;
+			page_cache_release(pages[j]);
+		}
+	}
+	return state;
+}
+
+static void shmem_collapse_migrate(struct address_space *mapping,
+				   pgoff_t start)
+{
+	struct shmem_collapse_control cc;
+	struct page *pages[PAGEVEC_SIZE];
+	LIST_HEAD(pagelist);
+	int i, j, nr, isolated = 0;
+	gfp_t gfp;
+
+	lru_add_drain();
+	for (i = 0; i < HPAGE_PMD_NR; i += nr) {
+		nr = find_get_pages_contig(mapping, start + i,
+				min_t(int, PAGEVEC_SIZE, HPAGE_PMD_NR - i),
+				pages);
+		if (!nr)
+			goto putback;
+		for (j = 0; j < nr; j++) {
+			struct page *page = pages[j];
+
+			if (!isolate_lru_page(page)) {
+				list_add_tail(&page->lru, &pagelist);
+				inc_zone_page_state(page, NR_ISOLATED_ANON +
+						    page_is_file_cache(page));
+				isolated++;
+			}
+			page_cache_release(page);
+		}
+	}
+	if (isolated < HPAGE_PMD_NR)
+		goto putback;
+
+	gfp = alloc_hugepage_gfpmask(khugepaged_defrag()) & ~__GFP_COMP;
+	pages[0] = list_entry(pagelist.next, struct page, lru);
+	cc.target = alloc_pages_exact_node(page_to_nid(pages[0]), gfp,
+					   HPAGE_PMD_ORDER);
+	if (!cc.target)
+		goto putback;
+	split_page(cc.target, HPAGE_PMD_ORDER);
+	cc.start = start;
+	bitmap_zero(cc.used, HPAGE_PMD_NR);
+
+	migrate_pages(&pagelist, shmem_collapse_new_page,
+		      (unsigned long)&cc, false, true);
+
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		if (!test_bit(i, cc.used))
+			__free_page(cc.target + i);
+putback:
+	putback_lru_pages(&pagelist);
+}
+
+/*
+ * Called with mmap_sem held for writing: no page fault can populate
+ * the page table, and the i_mmap_lock held by our caller keeps the
+ * rmap walkers and truncation away from it.
+ */
+static void retract_pte_table(struct vm_area_struct *vma,
+			      unsigned long addr, pmd_t *pmd)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	spinlock_t *ptl;
+	pte_t *pte;
+	pmd_t _pmd;
+	int i;
+
+	pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		if (!pte_none(pte[i]))
+			break;
+	pte_unmap_unlock(pte, ptl);
+	if (i < HPAGE_PMD_NR)
+		return;
+
+	spin_lock(&mm->page_table_lock);
+	_pmd = *pmd;
+	pmd_clear(pmd);
+	mm->nr_ptes--;
+	spin_unlock(&mm->page_table_lock);
+	flush_tlb_range(vma, addr, addr + HPAGE_PMD_SIZE);
+	pte_free(mm, pmd_pgtable(_pmd));
+}
+
+static void retract_page_tables(struct address_space *mapping, pgoff_t pgoff)
+{
+	struct vm_area_struct *vma;
+	struct prio_tree_iter iter;
+
+	spin_lock(&mapping->i_mmap_lock);
+	vma_prio_tree_foreach(vma, &iter, &mapping->i_mmap, pgoff, pgoff) {
+		struct mm_struct *mm = vma->vm_mm;
+		unsigned long addr;
+		pmd_t *pmd;
+
+		/* private COW copies may be mapped in the page table */
+		if (vma->anon_vma)
+			continue;
+		addr = vma->vm_start + ((pgoff - vma->vm_pgoff) << PAGE_SHIFT);
+		if ((addr & ~HPAGE_PMD_MASK) ||
+		    addr + HPAGE_PMD_SIZE > vma->vm_end)
+			continue;
+		pmd = mm_find_pmd(mm, addr);
+		if (!pmd || pmd_trans_huge(*pmd))
+			continue;
+		if (!down_write_trylock(&mm->mmap_sem))
+			continue;
+		if (!khugepaged_test_exit(mm))
+			retract_pte_table(vma, addr, pmd);
+		up_write(&mm->mmap_sem);
+	}
+	spin_unlock(&mapping->i_mmap_lock);
+}
+
+static void collapse_shmem(struct address_space *mapping, pgoff_t start)
+{
+	int state;
+
+	if ((loff_t)(start + HPAGE_PMD_NR) << PAGE_SHIFT >
+	    i_size_read(mapping->host))
+		return;
+
+	state = shmem_block_state(mapping, start);
+	if (state == SHMEM_BLOCK_HOLES)
+		return;
+	if (state == SHMEM_BLOCK_PRESENT) {
+		shmem_collapse_migrate(mapping, start);
+		if (shmem_block_state(mapping, start) != SHMEM_BLOCK_EXTENT)
+			return;
+		khugepaged_pages_collapsed++;
+		count_vm_event(THP_SHMEM_COLLAPSE);
+	}
+
+	/* the ptes go away now and the next fault maps the huge pmd */
+	unmap_mapping_range(mapping, (loff_t)start << PAGE_SHIFT,
+			    HPAGE_PMD_SIZE, 0);
+	retract_page_tables(mapping, start);
+}
+
+/*
+ * Returns 1 if mmap_sem was released, like khugepaged_scan_pmd().
+ */
+static int khugepaged_scan_shmem(struct mm_struct *mm,
+				 struct vm_area_struct *vma,
+				 unsigned long address)
+{
+	struct file *file;
+	pgoff_t pgoff;
+	pmd_t *pmd;
+
+	pgoff = linear_page_index(vma, address);
+	if (pgoff & (HPAGE_PMD_NR - 1))
+		return 0;
+	/* only bother with blocks this mm maps through a page table */
+	pmd = mm_find_pmd(mm, address);
+	if (!pmd || pmd_trans_huge(*pmd))
+		return 0;
+
+	file = vma->vm_file;
+	get_file(file);
+	up_read(&mm->mmap_sem);
+	collapse_shmem(file->f_mapping, pgoff);
+	fput(file);
+	return 1;
+}
+
 static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 					    struct page **hpage)
 {
@@ -2022,6 +2435,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 	progress++;
 	for (; vma; vma = vma->vm_next) {
 		unsigned long hstart, hend;
+		int shmem;
 
 		cond_resched();
 		if (unlikely(khugepaged_test_exit(mm))) {
@@ -2029,15 +2443,19 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 			break;
 		}
 
-		if ((!(vma->vm_flags & VM_HUGEPAGE) &&
-		     !khugepaged_always()) ||
-		    (vma->vm_flags & VM_NOHUGEPAGE)) {
+		/* shmem has its own policy, see shmem_huge_enabled() */
+		shmem = shmem_huge_enabled(vma);
+		if (!shmem &&
+		    ((!(vma->vm_flags & VM_HUGEPAGE) &&
+		      !khugepaged_always()) ||
+		     (vma->vm_flags & VM_NOHUGEPAGE))) {
 			progress++;
 			continue;
 		}
 
 		/* VM_PFNMAP vmas may have vm_ops null but vm_file set */
-		if (!vma->anon_vma || vma->vm_ops || vma->vm_file) {
+		if (!shmem &&
+		    (!vma->anon_vma || vma->vm_ops || vma->vm_file)) {
 			khugepaged_scan.address = vma->vm_end;
 			progress++;
 			continue;
@@ -2068,9 +2486,13 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages,
 			VM_BUG_ON(khugepaged_scan.address < hstart ||
 				  khugepaged_scan.address + HPAGE_PMD_SIZE >
 				  hend);
-			ret = khugepaged_scan_pmd(mm, vma,
-						  khugepaged_scan.address,
-						  hpage);
+			if (shmem)
+				ret = khugepaged_scan_shmem(mm, vma,
+						khugepaged_scan.address);
+			else
+				ret = khugepaged_scan_pmd(mm, vma,
+						khugepaged_scan.address,
+						hpage);
 			/* move to next address */
 			khugepaged_scan.address += HPAGE_PMD_SIZE;
 			progress += HPAGE_PMD_NR;
@@ -2265,6 +2687,78 @@ static int khugepaged(void *none)
 	return 0;
 }
 
+/*
+ * A huge pmd mapping shmem pages is split by replacing it with the
+ * page table deposited when it was established: the pages themselves,
+ * their references and mapcounts stay as they are.
+ */
+static void __split_file_huge_pmd(struct mm_struct *mm, pmd_t *pmd)
+{
+	pgtable_t pgtable;
+	pmd_t _pmd, entry;
+	unsigned long pfn;
+	pgprot_t prot;
+	int i;
+
+	assert_spin_locked(&mm->page_table_lock);
+
+	entry = *pmd;
+	pfn = pmd_pfn(entry);
+	prot = pmd_pgprot(entry);
+	pgtable = get_pmd_huge_pte(mm);
+	pmd_populate(mm, &_pmd, pgtable);
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		pte_t *pte;
+
+		pte = pte_offset_map(&_pmd, i << PAGE_SHIFT);
+		BUG_ON(!pte_none(*pte));
+		set_pte(pte, pfn_pte(pfn + i, prot));
+		pte_unmap(pte);
+	}
+
+	smp_wmb(); /* make ptes visible before pmd */
+	mm->nr_ptes++;
+	/*
+	 * As in __split_huge_page_map(), the huge and the small tlb
+	 * entries must never coexist: invalidate the pmd and flush
+	 * before establishing the page table.
+	 */
+	set_pmd(pmd, pmd_mknotpresent(entry));
+	flush_tlb_mm(mm);
+	pmd_populate(mm, pmd, pgtable);
+
+	count_vm_event(THP_SHMEM_PMD_SPLIT);
+}
+
+void split_file_huge_pmd(struct page *page, struct vm_area_struct *vma,
+			 unsigned long address)
+{
+	pmd_t *pmd;
+
+	pmd = page_check_file_huge_pmd(page, vma, address);
+	if (pmd) {
+		__split_file_huge_pmd(vma->vm_mm, pmd);
+		spin_unlock(&vma->vm_mm->page_table_lock);
+	}
+}
+
+/* For callers about to handle the whole vma with ptes only */
+void split_file_huge_pmds(struct vm_area_struct *vma)
+{
+	unsigned long addr;
+	pmd_t *pmd;
+
+	if (!vma->vm_ops || !vma->vm_ops->pmd_fault)
+		return;
+	addr = (vma->vm_start + ~HPAGE_PMD_MASK) & HPAGE_PMD_MASK;
+	for (; addr + HPAGE_PMD_SIZE <= vma->vm_end; addr += HPAGE_PMD_SIZE) {
+		pmd = mm_find_pmd(vma->vm_mm, addr);
+		if (pmd)
+			split_huge_page_pmd(vma->vm_mm, pmd);
+	}
+}
+
 void __split_huge_page_pmd(struct mm_struct *mm, pmd_t *pmd)
 {
 	struct page *page;
@@ -2275,6 +2769,11 @@ void __split_huge_page_pmd(struct mm_struct *mm, pmd_t *pmd)
 		return;
 	}
 	page = pmd_page(*pmd);
+	if (!PageHead(page)) {
+		__split_file_huge_pmd(mm, pmd);
+		spin_unlock(&mm->page_table_lock);
+		return;
+	}
 	VM_BUG_ON(!page_count(page));
 	get_page(page);
 	spin_unlock(&mm->page_table_lock);
@@ -99,6 +99,10 @@ struct mm_slot {
  * @address: the next address inside that to be scanned
  * @rmap_list: link to the next rmap to be scanned in the rmap_list
  * @seqnr: count of completed full scans (needed when removing unstable node)
+ * @vma_start: vm_start of the vma being scanned, or KSM_NO_VMA
+ * @vma_changed: a page of that vma changed or was merged on this visit
+ * @top_prio: highest mm priority seen on the previous full scan
+ * @next_top_prio: highest mm priority seen so far on this full scan
  *
  * There is only the one ksm_scan instance of this cursor structure.
  */
@@ -107,6 +111,43 @@ struct ksm_scan {
 	unsigned long address;
 	struct rmap_item **rmap_list;
 	unsigned long seqnr;
+	unsigned long vma_start;
+	int vma_changed;
+	unsigned int top_prio;
+	unsigned int next_top_prio;
+};
+
+#define KSM_NO_VMA	(~0UL)
+
+/*
+ * ksmd gathers the pages it scans into batches, so that the checksums
+ * of a batch can be calculated by several threads at once; only the
+ * merging itself, which works on the stable and unstable trees, stays
+ * single-threaded under ksm_thread_mutex.  A batch never spans vmas.
+ */
+#define KSM_BATCH_MAX	64
+
+#define KSM_ENTRY_DONE	0	/* checksum valid, or entry not in use */
+#define KSM_ENTRY_TODO	1	/* waiting for a thread to checksum it */
+#define KSM_ENTRY_BUSY	2	/* being checksummed */
+
+struct ksm_batch_entry {
+	struct rmap_item *rmap_item;
+	struct page *page;
+	u32 checksum;
+	atomic_t state;
+};
+
+/**
+ * struct ksm_batch - pages ksmd has taken but not yet tried to merge
+ * @nr: number of entries in use
+ * @seq: bumped each time the helper threads are kicked
+ * @entry: the pages, in scan order
+ */
+struct ksm_batch {
+	unsigned int nr;
+	unsigned long seq;
+	struct ksm_batch_entry entry[KSM_BATCH_MAX];
 };
 
 /**
@@ -164,7 +205,9 @@ static struct mm_slot ksm_mm_head = {
 };
 static struct ksm_scan ksm_scan = {
 	.mm_slot = &ksm_mm_head,
+	.vma_start = KSM_NO_VMA,
 };
+static struct ksm_batch ksm_batch;
 
 static struct kmem_cache *rmap_item_cache;
 static struct kmem_cache *stable_node_cache;
@@ -188,12 +231,43 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Most pages ksmd may scan in one batch while merging well: 0 is no boost */
+static unsigned int ksm_thread_max_pages_to_scan;
+
+/* Number of pages ksmd will scan in its next batch */
+static unsigned int ksm_cur_pages_to_scan = 100;
+
+/*
+ * Speed up while at least one page in KSM_MERGE_RATIO scanned is merged,
+ * slow down again once a batch merges nothing.
+ */
+#define KSM_MERGE_RATIO	16
+
+/* Threads, ksmd included, which checksum each batch of pages */
+#define KSM_MAX_SCAN_THREADS	16
+static unsigned int ksm_scan_threads = 1;
+static struct task_struct *ksm_helper_threads[KSM_MAX_SCAN_THREADS];
+
+/* Whether to skip vmas whose pages did not change on recent visits */
+static unsigned int ksm_skip_quiet_vmas;
+
+/*
+ * A quiet vma is skipped for up to 2^KSM_VMA_QUIET_MAX - 1 visits.
+ * Together with the mm priorities below, this bounds how many full scans
+ * an rmap_item can go untouched: keep that well under SEQNR_MASK.
+ */
+#define KSM_VMA_QUIET_MAX	3
+
+/* The number of vma visits skipped because nothing changed there */
+static unsigned long ksm_vmas_skipped;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
 static unsigned int ksm_run = KSM_RUN_STOP;
 
 static DECLARE_WAIT_QUEUE_HEAD(ksm_thread_wait);
+static DECLARE_WAIT_QUEUE_HEAD(ksm_helper_wait);
 static DEFINE_MUTEX(ksm_thread_mutex);
 static DEFINE_SPINLOCK(ksm_mmlist_lock);
 
@@ -564,10 +638,12 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 		 * root_unstable_tree was already reset to RB_ROOT.
 		 * But be careful when an mm is exiting: do the rb_erase
 		 * if this rmap_item was inserted by this scan, rather
-		 * than left over from before.
+		 * than left over from before.  An rmap_item in a quiet
+		 * vma, or in an mm of low priority, may be left over
+		 * from several scans back: KSM_VMA_QUIET_MAX and
+		 * KSM_PRIO_MAX keep that well short of wrapping the age.
 		 */
 		age = (unsigned char)(ksm_scan.seqnr - rmap_item->address);
-		BUG_ON(age > 1);
 		if (!age)
 			rb_erase(&rmap_item->node, &root_unstable_tree);
 
@@ -1179,14 +1255,17 @@ static void stable_tree_append(struct rmap_item *rmap_item,
  *
  * @page: the page that we are searching identical page to.
  * @rmap_item: the reverse mapping into the virtual address of this page
+ * @checksum: the checksum of the page, as calculated for its batch
+ *
+ * Returns 1 if the page changed or found a match, 0 if it was left as it was.
  */
-static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
+static int cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item,
+			      unsigned int checksum)
 {
 	struct rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
 	struct page *kpage;
-	unsigned int checksum;
 	int err;
 
 	remove_rmap_item_from_tree(rmap_item);
@@ -1205,7 +1284,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			unlock_page(kpage);
 		}
 		put_page(kpage);
-		return;
+		return 1;
 	}
 
 	/*
@@ -1214,10 +1293,9 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
-		return;
+		return 1;
 	}
 
 	tree_rmap_item =
@@ -1252,8 +1330,10 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 				break_cow(tree_rmap_item);
 				break_cow(rmap_item);
 			}
+			return 1;
 		}
 	}
+	return 0;
 }
 
 static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
@@ -1284,6 +1364,91 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * Step the scan cursor on from @slot, past any mm whose priority has it
+ * sit out this full scan: an mm at priority prio is scanned on one full
+ * scan in 2^(top_prio - prio), top_prio being the highest priority of
+ * any mm on the previous full scan.  Called with ksm_mmlist_lock held.
+ */
+static struct mm_slot *ksm_next_mm_slot(struct mm_slot *slot)
+{
+	unsigned int prio, interval;
+
+	for (;;) {
+		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
+		if (slot == &ksm_mm_head)
+			return slot;
+
+		prio = ksm_mm_priority(slot->mm);
+		if (prio > ksm_scan.next_top_prio)
+			ksm_scan.next_top_prio = prio;
+		/* An exiting mm is never skipped: it must be cleaned up */
+		if (prio >= ksm_scan.top_prio || ksm_test_exit(slot->mm))
+			return slot;
+		interval = 1 << (ksm_scan.top_prio - prio);
+		if (!(ksm_scan.seqnr & (interval - 1)))
+			return slot;
+	}
+}
+
+/*
+ * Record the outcome of a visit to the vma which ksm_scan.vma_start names:
+ * each visit on which none of its pages changed or merged doubles the
+ * number of visits that vma will be skipped for, up to a limit.
+ */
+static void ksm_finish_vma(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+
+	if (ksm_scan.vma_start == KSM_NO_VMA)
+		return;
+
+	vma = find_vma(mm, ksm_scan.vma_start);
+	if (vma && vma->vm_start == ksm_scan.vma_start) {
+		if (ksm_scan.vma_changed) {
+			vma->vm_ksm_quiet = 0;
+		} else {
+			if (vma->vm_ksm_quiet < KSM_VMA_QUIET_MAX)
+				vma->vm_ksm_quiet++;
+			vma->vm_ksm_skip = (1 << vma->vm_ksm_quiet) - 1;
+		}
+	}
+	ksm_scan.vma_start = KSM_NO_VMA;
+}
+
+/*
+ * Skip over a quiet vma, stepping the rmap_list cursor past the rmap_items
+ * which track it without freeing them, but freeing any stale rmap_items
+ * below it as get_next_rmap_item() would have done.
+ */
+static int ksm_skip_vma(struct vm_area_struct *vma)
+{
+	struct rmap_item *rmap_item;
+
+	if (!ksm_skip_quiet_vmas || !vma->vm_ksm_skip)
+		return 0;
+	vma->vm_ksm_skip--;
+	ksm_vmas_skipped++;
+
+	while ((rmap_item = *ksm_scan.rmap_list) &&
+	       rmap_item->address < vma->vm_end) {
+		if (rmap_item->address < vma->vm_start) {
+			*ksm_scan.rmap_list = rmap_item->rmap_list;
+			remove_rmap_item_from_tree(rmap_item);
+			free_rmap_item(rmap_item);
+		} else
+			ksm_scan.rmap_list = &rmap_item->rmap_list;
+	}
+	ksm_scan.address = vma->vm_end;
+	return 1;
+}
+
+/*
+ * Returns the next rmap_item to scan, with a reference held on its page;
+ * or NULL when a full scan has been completed.  While ksm_batch holds any
+ * pages, it also returns NULL rather than moving on to another vma, so
+ * that the batch can be merged first.
+ */
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1309,14 +1474,21 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 		lru_add_drain_all();
 
 		root_unstable_tree = RB_ROOT;
+		ksm_scan.top_prio = ksm_scan.next_top_prio;
+		ksm_scan.next_top_prio = 0;
 
 		spin_lock(&ksm_mmlist_lock);
-		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
+		slot = ksm_next_mm_slot(slot);
 		ksm_scan.mm_slot = slot;
 		spin_unlock(&ksm_mmlist_lock);
+
+		/* Every mm may be sitting out this full scan */
+		if (slot == &ksm_mm_head)
+			goto scan_done;
 next_mm:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
+		ksm_scan.vma_start = KSM_NO_VMA;
 	}
 
 	mm = slot->mm;
@@ -1329,6 +1501,16 @@ next_mm:
 	for (; vma; vma = vma->vm_next) {
 		if (!(vma->vm_flags & VM_MERGEABLE))
 			continue;
+		if (vma->vm_start != ksm_scan.vma_start) {
+			if (ksm_batch.nr)
+				goto batch_full;
+			ksm_finish_vma(mm);
+			if (ksm_scan.address <= vma->vm_start &&
+			    ksm_skip_vma(vma))
+				continue;
+			ksm_scan.vma_start = vma->vm_start;
+			ksm_scan.vma_changed = 0;
+		}
 		if (ksm_scan.address < vma->vm_start)
 			ksm_scan.address = vma->vm_start;
 		if (!vma->anon_vma)
@@ -1364,6 +1546,10 @@ next_mm:
 		}
 	}
 
+	if (ksm_batch.nr)
+		goto batch_full;
+	ksm_finish_vma(mm);
+
 	if (ksm_test_exit(mm)) {
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
@@ -1375,8 +1561,7 @@ next_mm:
 	remove_trailing_rmap_items(slot, ksm_scan.rmap_list);
 
 	spin_lock(&ksm_mmlist_lock);
-	ksm_scan.mm_slot = list_entry(slot->mm_list.next,
-						struct mm_slot, mm_list);
+	ksm_scan.mm_slot = ksm_next_mm_slot(slot);
 	if (ksm_scan.address == 0) {
 		/*
 		 * We've completed a full scan of all vmas, holding mmap_sem
@@ -1405,8 +1590,86 @@ next_mm:
 	if (slot != &ksm_mm_head)
 		goto next_mm;
 
+scan_done:
 	ksm_scan.seqnr++;
 	return NULL;
+
+batch_full:
+	up_read(&mm->mmap_sem);
+	return NULL;
+}
+
+/*
+ * Claim one entry of the batch and calculate its checksum, unless another
+ * thread has already claimed it: returns 0 in that case.
+ */
+static int ksm_checksum_entry(struct ksm_batch_entry *entry)
+{
+	if (atomic_cmpxchg(&entry->state, KSM_ENTRY_TODO,
+			   KSM_ENTRY_BUSY) != KSM_ENTRY_TODO)
+		return 0;
+	entry->checksum = calc_checksum(entry->page);
+	smp_wmb();
+	atomic_set(&entry->state, KSM_ENTRY_DONE);
+	return 1;
+}
+
+/*
+ * Calculate checksums for whichever entries of the batch no other thread
+ * has claimed yet: run by ksmd and by its helper threads alike.
+ */
+static void ksm_checksum_batch(struct ksm_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < ACCESS_ONCE(batch->nr); i++)
+		ksm_checksum_entry(&batch->entry[i]);
+}
+
+static void ksm_batch_add(struct rmap_item *rmap_item, struct page *page)
+{
+	struct ksm_batch_entry *entry = &ksm_batch.entry[ksm_batch.nr];
+
+	entry->rmap_item = rmap_item;
+	entry->page = page;
+	smp_wmb();
+	atomic_set(&entry->state, KSM_ENTRY_TODO);
+	ksm_batch.nr++;
+}
+
+/*
+ * Checksum the batch, sharing that out with the helper threads if there
+ * are any, then try to merge its pages one by one in scan order.
+ */
+static void ksm_merge_batch(void)
+{
+	struct ksm_batch *batch = &ksm_batch;
+	struct ksm_batch_entry *entry;
+	unsigned int i;
+
+	if (ksm_scan_threads > 1 && batch->nr > 1) {
+		batch->seq++;
+		wake_up_all(&ksm_helper_wait);
+	}
+	ksm_checksum_batch(batch);
+
+	for (i = 0; i < batch->nr; i++) {
+		entry = &batch->entry[i];
+		/*
+		 * Anything still to do is done here; for an entry a helper
+		 * is busy with, let the helper run if it was preempted.
+		 */
+		while (atomic_read(&entry->state) != KSM_ENTRY_DONE) {
+			if (!ksm_checksum_entry(entry))
+				cond_resched();
+		}
+		smp_rmb();
+		if (cmp_and_merge_page(entry->page, entry->rmap_item,
+				       entry->checksum))
+			ksm_scan.vma_changed = 1;
+		put_page(entry->page);
+	}
+	batch->nr = 0;
 }
 
 /**
@@ -1418,15 +1681,48 @@ static void ksm_do_scan(unsigned int scan_npages)
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
 
-	while (scan_npages-- && likely(!freezing(current))) {
+	while (scan_npages && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
-		if (!rmap_item)
-			return;
+		if (!rmap_item) {
+			if (!ksm_batch.nr)
+				break;
+			ksm_merge_batch();
+			continue;
+		}
+		scan_npages--;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
-			cmp_and_merge_page(page, rmap_item);
-		put_page(page);
+			ksm_batch_add(rmap_item, page);
+		else
+			put_page(page);
+		if (ksm_batch.nr == KSM_BATCH_MAX)
+			ksm_merge_batch();
 	}
+	if (ksm_batch.nr)
+		ksm_merge_batch();
+}
+
+/*
+ * Adaptive scanning: while ksmd keeps merging pages, double the number it
+ * scans per batch, up to max_pages_to_scan; once a batch merges nothing,
+ * halve it again, back down to pages_to_scan.
+ */
+static void ksm_adapt_scan_rate(unsigned int scanned, long merged)
+{
+	unsigned int min = ksm_thread_pages_to_scan;
+	unsigned int max = ksm_thread_max_pages_to_scan;
+	unsigned int cur = ksm_cur_pages_to_scan;
+
+	if (max <= min) {
+		ksm_cur_pages_to_scan = min;
+		return;
+	}
+
+	if (merged > 0 && merged * KSM_MERGE_RATIO >= scanned)
+		cur = cur > max / 2 ? max : cur * 2;
+	else if (merged <= 0)
+		cur /= 2;
+	ksm_cur_pages_to_scan = clamp(cur, min, max);
 }
 
 static int ksmd_should_run(void)
@@ -1436,13 +1732,22 @@ static int ksmd_should_run(void)
 
 static int ksm_scan_thread(void *nothing)
 {
+	unsigned int nr_pages;
+	unsigned long merged;
+
 	set_freezable();
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run()) {
+			merged = ksm_pages_shared + ksm_pages_sharing;
+			nr_pages = ksm_thread_max_pages_to_scan ?
+				ksm_cur_pages_to_scan : ksm_thread_pages_to_scan;
+			ksm_do_scan(nr_pages);
+			ksm_adapt_scan_rate(nr_pages, ksm_pages_shared +
+					    ksm_pages_sharing - merged);
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -1458,6 +1763,64 @@ static int ksm_scan_thread(void *nothing)
 	return 0;
 }
 
+#ifdef CONFIG_SYSFS
+/*
+ * A helper thread only ever calculates checksums for ksmd's batches: it
+ * takes no locks, and the pages are held by ksmd until it has merged them.
+ */
+static int ksm_helper_thread(void *nothing)
+{
+	unsigned long seq = 0;
+
+	set_freezable();
+	set_user_nice(current, 5);
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(ksm_helper_wait,
+			ACCESS_ONCE(ksm_batch.seq) != seq ||
+			kthread_should_stop());
+		seq = ACCESS_ONCE(ksm_batch.seq);
+		ksm_checksum_batch(&ksm_batch);
+	}
+	return 0;
+}
+
+/*
+ * Start or stop helper threads so that nr threads, ksmd included, share
+ * the checksumming.  Called with ksm_thread_mutex held, so that no batch
+ * is in flight.
+ */
+static int ksm_set_scan_threads(unsigned int nr)
+{
+	struct task_struct *thread;
+	unsigned int i;
+	int err = 0;
+
+	for (i = 1; i < nr; i++) {
+		if (ksm_helper_threads[i])
+			continue;
+		thread = kthread_run(ksm_helper_thread, NULL, "ksmd/%u", i);
+		if (IS_ERR(thread)) {
+			printk(KERN_ERR "ksm: creating helper thread failed\n");
+			err = PTR_ERR(thread);
+			nr = i;
+			break;
+		}
+		ksm_helper_threads[i] = thread;
+	}
+
+	for (i = nr; i < KSM_MAX_SCAN_THREADS; i++) {
+		if (!ksm_helper_threads[i])
+			continue;
+		kthread_stop(ksm_helper_threads[i]);
+		ksm_helper_threads[i] = NULL;
+	}
+
+	ksm_scan_threads = nr;
+	return err;
+}
+#endif /* CONFIG_SYSFS */
+
 int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		unsigned long end, int advice, unsigned long *vm_flags)
 {
@@ -1570,6 +1933,21 @@ void __ksm_exit(struct mm_struct *mm)
 	}
 }
 
+int ksm_set_priority(struct mm_struct *mm, unsigned long prio)
+{
+	unsigned long old, new;
+
+	if (!mm || prio > KSM_PRIO_MAX)
+		return -EINVAL;
+
+	do {
+		old = ACCESS_ONCE(mm->flags);
+		new = (old & ~MMF_KSM_PRIO_MASK) | (prio << MMF_KSM_PRIO_SHIFT);
+	} while (cmpxchg(&mm->flags, old, new) != old);
+
+	return 0;
+}
+
 struct page *ksm_does_need_to_copy(struct page *page,
 			struct vm_area_struct *vma, unsigned long address)
 {
@@ -1878,6 +2256,85 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t max_pages_to_scan_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_max_pages_to_scan);
+}
+
+static ssize_t max_pages_to_scan_store(struct kobject *kobj,
+				       struct kobj_attribute *attr,
+				       const char *buf, size_t count)
+{
+	int err;
+	unsigned long nr_pages;
+
+	err = strict_strtoul(buf, 10, &nr_pages);
+	if (err || nr_pages > UINT_MAX)
+		return -EINVAL;
+
+	ksm_thread_max_pages_to_scan = nr_pages;
+
+	return count;
+}
+KSM_ATTR(max_pages_to_scan);
+
+static ssize_t cur_pages_to_scan_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_max_pages_to_scan ?
+		       ksm_cur_pages_to_scan : ksm_thread_pages_to_scan);
+}
+KSM_ATTR_RO(cur_pages_to_scan);
+
+static ssize_t scan_threads_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_scan_threads);
+}
+
+static ssize_t scan_threads_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	int err;
+	unsigned long nr_threads;
+
+	err = strict_strtoul(buf, 10, &nr_threads);
+	if (err || !nr_threads || nr_threads > KSM_MAX_SCAN_THREADS)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	err = ksm_set_scan_threads(nr_threads);
+	mutex_unlock(&ksm_thread_mutex);
+
+	return err ? err : count;
+}
+KSM_ATTR(scan_threads);
+
+static ssize_t skip_quiet_vmas_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_skip_quiet_vmas);
+}
+
+static ssize_t skip_quiet_vmas_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	int err;
+	unsigned long flags;
+
+	err = strict_strtoul(buf, 10, &flags);
+	if (err || flags > 1)
+		return -EINVAL;
+
+	ksm_skip_quiet_vmas = flags;
+
+	return count;
+}
+KSM_ATTR(skip_quiet_vmas);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1970,6 +2427,13 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t vmas_skipped_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_vmas_skipped);
+}
+KSM_ATTR_RO(vmas_skipped);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -1979,6 +2443,11 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&max_pages_to_scan_attr.attr,
+	&cur_pages_to_scan_attr.attr,
+	&scan_threads_attr.attr,
+	&skip_quiet_vmas_attr.attr,
+	&vmas_skipped_attr.attr,
 	NULL,
 };
 
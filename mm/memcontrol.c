@@ -23,6 +23,7 @@
 
 #include <linux/res_counter.h>
 #include <linux/memcontrol.h>
+#include <linux/vmpressure.h>
 #include <linux/cgroup.h>
 #include <linux/mm.h>
 #include <linux/hugetlb.h>
@@ -113,9 +114,10 @@ struct mem_cgroup_stat_cpu {
  */
 struct mem_cgroup_per_zone {
 	/*
-	 * spin_lock to protect the per cgroup LRU
+	 * The pages of this cgroup in this zone, protected by the
+	 * zone's lru_lock.
 	 */
-	struct list_head	lists[NR_LRU_LISTS];
+	struct lruvec		lruvec;
 	unsigned long		count[NR_LRU_LISTS];
 
 	struct zone_reclaim_stat reclaim_stat;
@@ -213,6 +215,18 @@ struct mem_cgroup {
 	 * the counter to account for mem+swap usage.
 	 */
 	struct res_counter memsw;
+	/*
+	 * the counter to account for kernel memory (slab pages) usage.
+	 * kernel memory is charged to res (and memsw) as well.
+	 */
+	struct res_counter kmem;
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	/*
+	 * unused dentries and inodes charged to this cgroup, and how many
+	 */
+	struct list_head kmem_lru[NR_MEM_CGROUP_KMEM_LRU];
+	unsigned long kmem_lru_nr[NR_MEM_CGROUP_KMEM_LRU];
+#endif
 	/*
 	 * Per cgroup active and inactive list, similar to the
 	 * per zone LRU lists.
@@ -254,6 +268,8 @@ struct mem_cgroup {
 
 	/* For oom notifier event fd */
 	struct list_head oom_notify;
+	/* For vmpressure notifier event fds */
+	struct vmpressure vmpressure;
 
 	/*
 	 * Should we move charges of a task when a task is moved into this
@@ -270,6 +286,11 @@ struct mem_cgroup {
 	 */
 	struct mem_cgroup_stat_cpu nocpu_base;
 	spinlock_t pcp_counter_lock;
+	/*
+	 * The last reference may be dropped when a slab page is freed, from
+	 * a context where the memcg cannot be torn down.
+	 */
+	struct work_struct free_work;
 };
 
 /* Stuffs for move charges at task migration. */
@@ -338,6 +359,7 @@ enum charge_type {
 #define _MEM			(0)
 #define _MEMSWAP		(1)
 #define _OOM_TYPE		(2)
+#define _KMEM			(3)
 #define MEMFILE_PRIVATE(x, val)	(((x) << 16) | (val))
 #define MEMFILE_TYPE(val)	(((val) >> 16) & 0xffff)
 #define MEMFILE_ATTR(val)	((val) & 0xffff)
@@ -371,14 +393,10 @@ struct cgroup_subsys_state *mem_cgroup_css(struct mem_cgroup *mem)
 }
 
 static struct mem_cgroup_per_zone *
-page_cgroup_zoneinfo(struct page_cgroup *pc)
+page_cgroup_zoneinfo(struct mem_cgroup *mem, struct page *page)
 {
-	struct mem_cgroup *mem = pc->mem_cgroup;
-	int nid = page_cgroup_nid(pc);
-	int zid = page_cgroup_zid(pc);
-
-	if (!mem)
-		return NULL;
+	int nid = page_to_nid(page);
+	int zid = page_zonenum(page);
 
 	return mem_cgroup_zoneinfo(mem, nid, zid);
 }
@@ -785,136 +803,135 @@ static inline bool mem_cgroup_is_root(struct mem_cgroup *mem)
 	return (mem == root_mem_cgroup);
 }
 
-/*
- * Following LRU functions are allowed to be used without PCG_LOCK.
- * Operations are called by routine of global LRU independently from memcg.
- * What we have to take care of here is validness of pc->mem_cgroup.
+/**
+ * mem_cgroup_iter - iterate over a memory cgroup hierarchy
+ * @root: hierarchy root, %NULL to visit all memory cgroups
+ * @prev: cgroup returned by the previous call, %NULL to start the walk
  *
- * Changes to pc->mem_cgroup happens when
- * 1. charge
- * 2. moving account
- * In typical case, "charge" is done before add-to-lru. Exception is SwapCache.
- * It is added to LRU before charge.
- * If PCG_USED bit is not set, page_cgroup is not added to this private LRU.
- * When moving account, the page is not on LRU. It's isolated.
+ * Returns a reference to the next cgroup, which the next call drops,
+ * or %NULL at the end of the walk.  The reference to @prev is dropped.
+ * Callers that leave the loop early must call mem_cgroup_iter_break().
+ * Always returns %NULL when the controller is disabled.
  */
-
-void mem_cgroup_del_lru_list(struct page *page, enum lru_list lru)
+struct mem_cgroup *mem_cgroup_iter(struct mem_cgroup *root,
+				   struct mem_cgroup *prev)
 {
-	struct page_cgroup *pc;
-	struct mem_cgroup_per_zone *mz;
-
 	if (mem_cgroup_disabled())
-		return;
-	pc = lookup_page_cgroup(page);
-	/* can happen while we handle swapcache. */
-	if (!TestClearPageCgroupAcctLRU(pc))
-		return;
-	VM_BUG_ON(!pc->mem_cgroup);
-	/*
-	 * We don't check PCG_USED bit. It's cleared when the "page" is finally
-	 * removed from global LRU.
-	 */
-	mz = page_cgroup_zoneinfo(pc);
-	/* huge page split is done under lru_lock. so, we have no races. */
-	MEM_CGROUP_ZSTAT(mz, lru) -= 1 << compound_order(page);
-	if (mem_cgroup_is_root(pc->mem_cgroup))
-		return;
-	VM_BUG_ON(list_empty(&pc->lru));
-	list_del_init(&pc->lru);
+		return NULL;
+	if (!prev)
+		return mem_cgroup_start_loop(root);
+	return mem_cgroup_get_next(prev, root, true);
+}
+
+/**
+ * mem_cgroup_iter_break - abort a hierarchy walk prematurely
+ * @root: hierarchy root
+ * @prev: last visited cgroup
+ */
+void mem_cgroup_iter_break(struct mem_cgroup *root, struct mem_cgroup *prev)
+{
+	if (prev)
+		css_put(&prev->css);
 }
 
-void mem_cgroup_del_lru(struct page *page)
+/*
+ * Global reclaim spares a cgroup that stays within its soft limit as long
+ * as there are other cgroups to reclaim from, see shrink_zone().  Cgroups
+ * without a soft limit, and the root cgroup, are never spared.
+ */
+bool mem_cgroup_soft_limit_protected(struct mem_cgroup *mem)
 {
-	mem_cgroup_del_lru_list(page, page_lru(page));
+	if (mem_cgroup_is_root(mem))
+		return false;
+	if (res_counter_read_u64(&mem->res, RES_SOFT_LIMIT) == RESOURCE_MAX)
+		return false;
+	return !res_counter_soft_limit_excess(&mem->res);
 }
 
-void mem_cgroup_rotate_lru_list(struct page *page, enum lru_list lru)
+/*
+ * Every page on the LRU is on exactly one lruvec: the one of the cgroup
+ * pc->mem_cgroup points to, in the page's zone.  The functions below keep
+ * the per-zone counters of those lruvecs in sync with the lists.  They are
+ * called under zone->lru_lock and without lock_page_cgroup().
+ *
+ * pc->mem_cgroup of a page on the LRU changes only
+ * 1. when an uncharged page is put on the LRU, it then belongs to root.
+ * 2. when a page on the LRU is charged (SwapCache, pages that FUSE moves
+ *    into the page cache).  The page is moved from one lruvec to the other
+ *    under zone->lru_lock, see __mem_cgroup_commit_charge_lrucare().
+ * Usually a page is charged before it is put on the LRU, and moving
+ * account happens only while the page is isolated from the LRU.
+ */
+
+struct lruvec *mem_cgroup_zone_lruvec(struct zone *zone,
+				      struct mem_cgroup *mem)
 {
 	struct mem_cgroup_per_zone *mz;
-	struct page_cgroup *pc;
 
 	if (mem_cgroup_disabled())
-		return;
+		return &zone->lruvec;
 
-	pc = lookup_page_cgroup(page);
-	/* unused or root page is not rotated. */
-	if (!PageCgroupUsed(pc))
-		return;
-	/* Ensure pc->mem_cgroup is visible after reading PCG_USED. */
-	smp_rmb();
-	if (mem_cgroup_is_root(pc->mem_cgroup))
-		return;
-	mz = page_cgroup_zoneinfo(pc);
-	list_move(&pc->lru, &mz->lists[lru]);
+	mz = mem_cgroup_zoneinfo(mem, zone_to_nid(zone), zone_idx(zone));
+	return &mz->lruvec;
 }
 
-void mem_cgroup_add_lru_list(struct page *page, enum lru_list lru)
+struct lruvec *mem_cgroup_lru_add_list(struct zone *zone, struct page *page,
+				       enum lru_list lru)
 {
-	struct page_cgroup *pc;
 	struct mem_cgroup_per_zone *mz;
+	struct page_cgroup *pc;
+	struct mem_cgroup *mem;
 
 	if (mem_cgroup_disabled())
-		return;
+		return &zone->lruvec;
+
 	pc = lookup_page_cgroup(page);
-	VM_BUG_ON(PageCgroupAcctLRU(pc));
-	if (!PageCgroupUsed(pc))
-		return;
-	/* Ensure pc->mem_cgroup is visible after reading PCG_USED. */
-	smp_rmb();
-	mz = page_cgroup_zoneinfo(pc);
+	if (PageCgroupUsed(pc)) {
+		/* Ensure pc->mem_cgroup is visible after reading PCG_USED. */
+		smp_rmb();
+		mem = pc->mem_cgroup;
+	} else {
+		/*
+		 * An uncharged page may still point to the cgroup it was
+		 * last charged to, which may be gone by now.
+		 */
+		mem = root_mem_cgroup;
+		pc->mem_cgroup = mem;
+	}
+	mz = page_cgroup_zoneinfo(mem, page);
 	/* huge page split is done under lru_lock. so, we have no races. */
 	MEM_CGROUP_ZSTAT(mz, lru) += 1 << compound_order(page);
-	SetPageCgroupAcctLRU(pc);
-	if (mem_cgroup_is_root(pc->mem_cgroup))
-		return;
-	list_add(&pc->lru, &mz->lists[lru]);
+	return &mz->lruvec;
 }
 
-/*
- * At handling SwapCache, pc->mem_cgroup may be changed while it's linked to
- * lru because the page may.be reused after it's fully uncharged (because of
- * SwapCache behavior).To handle that, unlink page_cgroup from LRU when charge
- * it again. This function is only used to charge SwapCache. It's done under
- * lock_page and expected that zone->lru_lock is never held.
- */
-static void mem_cgroup_lru_del_before_commit_swapcache(struct page *page)
+void mem_cgroup_lru_del_list(struct page *page, enum lru_list lru)
 {
-	unsigned long flags;
-	struct zone *zone = page_zone(page);
-	struct page_cgroup *pc = lookup_page_cgroup(page);
+	struct mem_cgroup_per_zone *mz;
+	struct page_cgroup *pc;
 
-	spin_lock_irqsave(&zone->lru_lock, flags);
+	if (mem_cgroup_disabled())
+		return;
+
+	pc = lookup_page_cgroup(page);
 	/*
-	 * Forget old LRU when this page_cgroup is *not* used. This Used bit
-	 * is guarded by lock_page() because the page is SwapCache.
+	 * We don't check PCG_USED bit.  The page stays on the lruvec it
+	 * was added to when it is uncharged.
 	 */
-	if (!PageCgroupUsed(pc))
-		mem_cgroup_del_lru_list(page, page_lru(page));
-	spin_unlock_irqrestore(&zone->lru_lock, flags);
+	VM_BUG_ON(!pc->mem_cgroup);
+	mz = page_cgroup_zoneinfo(pc->mem_cgroup, page);
+	MEM_CGROUP_ZSTAT(mz, lru) -= 1 << compound_order(page);
 }
 
-static void mem_cgroup_lru_add_after_commit_swapcache(struct page *page)
+void mem_cgroup_lru_del(struct page *page)
 {
-	unsigned long flags;
-	struct zone *zone = page_zone(page);
-	struct page_cgroup *pc = lookup_page_cgroup(page);
-
-	spin_lock_irqsave(&zone->lru_lock, flags);
-	/* link when the page is linked to LRU but page_cgroup isn't */
-	if (PageLRU(page) && !PageCgroupAcctLRU(pc))
-		mem_cgroup_add_lru_list(page, page_lru(page));
-	spin_unlock_irqrestore(&zone->lru_lock, flags);
+	mem_cgroup_lru_del_list(page, page_lru(page));
 }
 
-
-void mem_cgroup_move_lists(struct page *page,
-			   enum lru_list from, enum lru_list to)
+struct lruvec *mem_cgroup_lru_move_lists(struct zone *zone, struct page *page,
+					 enum lru_list from, enum lru_list to)
 {
-	if (mem_cgroup_disabled())
-		return;
-	mem_cgroup_del_lru_list(page, from);
-	mem_cgroup_add_lru_list(page, to);
+	mem_cgroup_lru_del_list(page, from);
+	return mem_cgroup_lru_add_list(zone, page, to);
 }
 
 int task_in_mem_cgroup(struct task_struct *task, const struct mem_cgroup *mem)
@@ -944,55 +961,40 @@ int task_in_mem_cgroup(struct task_struct *task, const struct mem_cgroup *mem)
 	return ret;
 }
 
-static int calc_inactive_ratio(struct mem_cgroup *memcg, unsigned long *present_pages)
+static unsigned long calc_inactive_ratio(unsigned long inactive,
+					 unsigned long active)
 {
-	unsigned long active;
-	unsigned long inactive;
 	unsigned long gb;
-	unsigned long inactive_ratio;
-
-	inactive = mem_cgroup_get_local_zonestat(memcg, LRU_INACTIVE_ANON);
-	active = mem_cgroup_get_local_zonestat(memcg, LRU_ACTIVE_ANON);
 
 	gb = (inactive + active) >> (30 - PAGE_SHIFT);
 	if (gb)
-		inactive_ratio = int_sqrt(10 * gb);
-	else
-		inactive_ratio = 1;
-
-	if (present_pages) {
-		present_pages[0] = inactive;
-		present_pages[1] = active;
-	}
-
-	return inactive_ratio;
+		return int_sqrt(10 * gb);
+	return 1;
 }
 
-int mem_cgroup_inactive_anon_is_low(struct mem_cgroup *memcg)
+int mem_cgroup_inactive_anon_is_low(struct mem_cgroup *memcg,
+				    struct zone *zone)
 {
 	unsigned long active;
 	unsigned long inactive;
-	unsigned long present_pages[2];
-	unsigned long inactive_ratio;
-
-	inactive_ratio = calc_inactive_ratio(memcg, present_pages);
 
-	inactive = present_pages[0];
-	active = present_pages[1];
+	inactive = mem_cgroup_zone_nr_pages(memcg, zone, LRU_INACTIVE_ANON);
+	active = mem_cgroup_zone_nr_pages(memcg, zone, LRU_ACTIVE_ANON);
 
-	if (inactive * inactive_ratio < active)
+	if (inactive * calc_inactive_ratio(inactive, active) < active)
 		return 1;
 
 	return 0;
 }
 
-int mem_cgroup_inactive_file_is_low(struct mem_cgroup *memcg)
+int mem_cgroup_inactive_file_is_low(struct mem_cgroup *memcg,
+				    struct zone *zone)
 {
 	unsigned long active;
 	unsigned long inactive;
 
-	inactive = mem_cgroup_get_local_zonestat(memcg, LRU_INACTIVE_FILE);
-	active = mem_cgroup_get_local_zonestat(memcg, LRU_ACTIVE_FILE);
+	inactive = mem_cgroup_zone_nr_pages(memcg, zone, LRU_INACTIVE_FILE);
+	active = mem_cgroup_zone_nr_pages(memcg, zone, LRU_ACTIVE_FILE);
 
 	return (active > inactive);
 }
@@ -1032,72 +1034,10 @@ mem_cgroup_get_reclaim_stat_from_page(struct page *page)
 		return NULL;
 	/* Ensure pc->mem_cgroup is visible after reading PCG_USED. */
 	smp_rmb();
-	mz = page_cgroup_zoneinfo(pc);
-	if (!mz)
-		return NULL;
-
+	mz = page_cgroup_zoneinfo(pc->mem_cgroup, page);
 	return &mz->reclaim_stat;
 }
 
-unsigned long mem_cgroup_isolate_pages(unsigned long nr_to_scan,
-					struct list_head *dst,
-					unsigned long *scanned, int order,
-					int mode, struct zone *z,
-					struct mem_cgroup *mem_cont,
-					int active, int file)
-{
-	unsigned long nr_taken = 0;
-	struct page *page;
-	unsigned long scan;
-	LIST_HEAD(pc_list);
-	struct list_head *src;
-	struct page_cgroup *pc, *tmp;
-	int nid = zone_to_nid(z);
-	int zid = zone_idx(z);
-	struct mem_cgroup_per_zone *mz;
-	int lru = LRU_FILE * file + active;
-	int ret;
-
-	BUG_ON(!mem_cont);
-	mz = mem_cgroup_zoneinfo(mem_cont, nid, zid);
-	src = &mz->lists[lru];
-
-	scan = 0;
-	list_for_each_entry_safe_reverse(pc, tmp, src, lru) {
-		if (scan >= nr_to_scan)
-			break;
-
-		page = pc->page;
-		if (unlikely(!PageCgroupUsed(pc)))
-			continue;
-		if (unlikely(!PageLRU(page)))
-			continue;
-
-		scan++;
-		ret = __isolate_lru_page(page, mode, file);
-		switch (ret) {
-		case 0:
-			list_move(&page->lru, dst);
-			mem_cgroup_del_lru(page);
-			nr_taken += hpage_nr_pages(page);
-			break;
-		case -EBUSY:
-			/* we don't affect global LRU but rotate in our LRU */
-			mem_cgroup_rotate_lru_list(page, page_lru(page));
-			break;
-		default:
-			break;
-		}
-	}
-
-	*scanned = scan;
-
-	trace_mm_vmscan_memcg_isolate(0, nr_to_scan, scan, nr_taken,
-				      0, 0, 0, mode);
-
-	return nr_taken;
-}
-
 #define mem_cgroup_from_res_counter(counter, member)	\
 	container_of(counter, struct mem_cgroup, member)
 
@@ -2134,7 +2074,7 @@ static void __mem_cgroup_commit_charge(struct mem_cgroup *mem,
 	 * Especially when a page_cgroup is taken from a page, pc->mem_cgroup
 	 * is accessed after testing USED bit. To make pc->mem_cgroup visible
 	 * before USED bit, we need memory barrier here.
-	 * See mem_cgroup_add_lru_list(), etc.
+	 * See mem_cgroup_lru_add_list(), etc.
  	 */
 	smp_wmb();
 	switch (ctype) {
@@ -2161,10 +2101,40 @@ static void __mem_cgroup_commit_charge(struct mem_cgroup *mem,
 	memcg_check_events(mem, pc->page);
 }
 
+/*
+ * Commit the charge of a page that may already be on the LRU, on the
+ * lruvec of some other cgroup: SwapCache, which is put on the LRU before
+ * it is charged, or a page that FUSE moves into the page cache.  The page
+ * is taken off the LRU around the commit so that it ends up on the lruvec
+ * of its new cgroup.
+ */
+static void __mem_cgroup_commit_charge_lrucare(struct page *page,
+					struct mem_cgroup *mem,
+					enum charge_type ctype)
+{
+	struct page_cgroup *pc = lookup_page_cgroup(page);
+	struct zone *zone = page_zone(page);
+	unsigned long flags;
+	bool removed = false;
+
+	spin_lock_irqsave(&zone->lru_lock, flags);
+	if (PageLRU(page)) {
+		del_page_from_lru_list(zone, page, page_lru(page));
+		ClearPageLRU(page);
+		removed = true;
+	}
+	__mem_cgroup_commit_charge(mem, pc, ctype, PAGE_SIZE);
+	if (removed) {
+		add_page_to_lru_list(zone, page, page_lru(page));
+		SetPageLRU(page);
+	}
+	spin_unlock_irqrestore(&zone->lru_lock, flags);
+}
+
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 
 #define PCGF_NOCOPY_AT_SPLIT ((1 << PCG_LOCK) | (1 << PCG_MOVE_LOCK) |\
-			(1 << PCG_ACCT_LRU) | (1 << PCG_MIGRATION))
+			(1 << PCG_MIGRATION))
 /*
  * Because tail pages are not marked as "used", set it. We're under
  * zone->lru_lock, 'splitting on pmd' and compund_lock.
@@ -2185,17 +2155,17 @@ void mem_cgroup_split_huge_fixup(struct page *head, struct page *tail)
 
 	tail_pc->mem_cgroup = head_pc->mem_cgroup;
 	smp_wmb(); /* see __commit_charge() */
-	if (PageCgroupAcctLRU(head_pc)) {
+	if (PageLRU(head)) {
 		enum lru_list lru;
 		struct mem_cgroup_per_zone *mz;
 
 		/*
-		 * LRU flags cannot be copied because we need to add tail
-		 *.page to LRU by generic call and our hook will be called.
-		 * We hold lru_lock, then, reduce counter directly.
+		 * The tail page is added to the head's lruvec by the
+		 * generic LRU code, which accounts it there.  We hold
+		 * lru_lock, then, reduce the head's counter directly.
 		 */
 		lru = page_lru(head);
-		mz = page_cgroup_zoneinfo(head_pc);
+		mz = page_cgroup_zoneinfo(head_pc->mem_cgroup, head);
 		MEM_CGROUP_ZSTAT(mz, lru) -= 1;
 	}
 	tail_pc->flags = head_pc->flags & ~PCGF_NOCOPY_AT_SPLIT;
@@ -2203,6 +2173,228 @@ void mem_cgroup_split_huge_fixup(struct page *head, struct page *tail)
 }
 #endif
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+/*
+ * Kernel memory is charged per slab page: the page is charged to the
+ * memcg of the task that made the allocator grow the cache, and every
+ * page_cgroup of the slab records it with PCG_KMEM.  Slab pages are never
+ * on the LRU and never "used", so they do not interfere with user pages.
+ */
+static unsigned long mem_cgroup_kmem_reclaim(struct mem_cgroup *mem,
+					     gfp_t gfp_mask)
+{
+	u64 kmem = res_counter_read_u64(&mem->kmem, RES_USAGE);
+
+	/* Put the pressure of a whole cgroup of slab on its caches */
+	return shrink_slab_memcg(mem, SWAP_CLUSTER_MAX, gfp_mask,
+				 kmem >> PAGE_SHIFT);
+}
+
+int mem_cgroup_charge_slab(struct page *page, int order, gfp_t gfp_mask)
+{
+	int nr_retries = MEM_CGROUP_RECLAIM_RETRIES;
+	int size = PAGE_SIZE << order;
+	struct res_counter *fail_res;
+	struct page_cgroup *pc;
+	struct mem_cgroup *mem, *charged;
+	int i, ret;
+
+	/*
+	 * Only charge allocations made on behalf of a task.  Reclaim and
+	 * __GFP_NOFAIL allocations must not fail because of a limit.
+	 */
+	if (mem_cgroup_disabled() || in_interrupt() ||
+	    (current->flags & PF_MEMALLOC) || (gfp_mask & __GFP_NOFAIL))
+		return 0;
+
+	pc = lookup_page_cgroup(page);
+	if (unlikely(!pc))
+		return 0;
+
+	rcu_read_lock();
+	mem = mem_cgroup_from_task(current);
+	if (!mem || mem_cgroup_is_root(mem) || !css_tryget(&mem->css)) {
+		rcu_read_unlock();
+		return 0;
+	}
+	rcu_read_unlock();
+
+	while (res_counter_charge(&mem->kmem, size, &fail_res)) {
+		if (!(gfp_mask & __GFP_WAIT) || !nr_retries--) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		mem_cgroup_kmem_reclaim(mem_cgroup_from_res_counter(fail_res,
+								    kmem),
+					gfp_mask);
+	}
+
+	/* kernel memory counts against the overall limit, too */
+	charged = mem;
+	ret = __mem_cgroup_try_charge(NULL, gfp_mask, &charged, false, size);
+	if (ret || !charged) {
+		res_counter_uncharge(&mem->kmem, size);
+		goto out;
+	}
+
+	for (i = 0; i < (1 << order); i++, pc++) {
+		pc->mem_cgroup = mem;
+		smp_wmb();
+		SetPageCgroupKmem(pc);
+	}
+	/* the slab page keeps the memcg around until it is freed */
+	mem_cgroup_get(mem);
+out:
+	css_put(&mem->css);
+	return ret;
+}
+
+void mem_cgroup_uncharge_slab(struct page *page, int order)
+{
+	struct page_cgroup *pc = lookup_page_cgroup(page);
+	struct mem_cgroup *mem;
+	int i;
+
+	if (mem_cgroup_disabled() || !pc || !PageCgroupKmem(pc))
+		return;
+
+	mem = pc->mem_cgroup;
+	for (i = 0; i < (1 << order); i++)
+		ClearPageCgroupKmem(pc + i);
+
+	res_counter_uncharge(&mem->kmem, PAGE_SIZE << order);
+	mem_cgroup_cancel_charge(mem, PAGE_SIZE << order);
+	mem_cgroup_put(mem);
+}
+
+/*
+ * The memcg the slab page of @obj is charged to, or NULL.  This does not
+ * change for as long as @obj is allocated, and the slab page holds a
+ * reference on the memcg.
+ */
+static struct mem_cgroup *mem_cgroup_kmem_owner(const void *obj)
+{
+	struct page_cgroup *pc = lookup_page_cgroup(virt_to_page(obj));
+
+	if (!pc || !PageCgroupKmem(pc))
+		return NULL;
+	return pc->mem_cgroup;
+}
+
+/**
+ * mem_cgroup_kmem_lru_add - put an unused object on its memcg's list
+ * @obj: the slab object
+ * @item: list_head in @obj for the memcg list, initialized empty
+ * @lru: which list
+ *
+ * Puts @obj at the head of the list of the memcg it is charged to, if it
+ * is charged and not on the list yet.  The caller holds the lock of the
+ * cache's LRU, which also protects the memcg lists.
+ */
+void mem_cgroup_kmem_lru_add(const void *obj, struct list_head *item,
+			     enum mem_cgroup_kmem_lru lru)
+{
+	struct mem_cgroup *mem;
+
+	if (!list_empty(item))
+		return;
+	mem = mem_cgroup_kmem_owner(obj);
+	if (!mem)
+		return;
+	list_add(item, &mem->kmem_lru[lru]);
+	mem->kmem_lru_nr[lru]++;
+}
+
+/**
+ * mem_cgroup_kmem_lru_move_tail - move an object to the tail of its list
+ * @obj: the slab object
+ * @item: list_head in @obj for the memcg list
+ * @lru: which list
+ *
+ * Like mem_cgroup_kmem_lru_add(), but to the tail, where memcg reclaim
+ * looks first; an object already on the list is moved there.
+ */
+void mem_cgroup_kmem_lru_move_tail(const void *obj, struct list_head *item,
+				   enum mem_cgroup_kmem_lru lru)
+{
+	struct mem_cgroup *mem = mem_cgroup_kmem_owner(obj);
+
+	if (!mem)
+		return;
+	if (list_empty(item))
+		mem->kmem_lru_nr[lru]++;
+	list_move_tail(item, &mem->kmem_lru[lru]);
+}
+
+/**
+ * mem_cgroup_kmem_lru_del - take an object off its memcg's list
+ * @obj: the slab object
+ * @item: list_head in @obj for the memcg list
+ * @lru: which list
+ */
+void mem_cgroup_kmem_lru_del(const void *obj, struct list_head *item,
+			     enum mem_cgroup_kmem_lru lru)
+{
+	struct mem_cgroup *mem;
+
+	if (list_empty(item))
+		return;
+	mem = mem_cgroup_kmem_owner(obj);
+	list_del_init(item);
+	mem->kmem_lru_nr[lru]--;
+}
+
+/*
+ * The list of unused objects charged to @mem itself, to be walked from
+ * the tail under the lock of the cache's LRU.
+ */
+struct list_head *mem_cgroup_kmem_lru(struct mem_cgroup *mem,
+				      enum mem_cgroup_kmem_lru lru)
+{
+	return &mem->kmem_lru[lru];
+}
+
+/*
+ * The number of unused objects charged to @mem and, with use_hierarchy,
+ * to its descendants.  Read without locks, so only a hint.
+ */
+unsigned long mem_cgroup_kmem_lru_count(struct mem_cgroup *mem,
+					enum mem_cgroup_kmem_lru lru)
+{
+	struct mem_cgroup *iter;
+	unsigned long nr = 0;
+
+	for_each_mem_cgroup_tree(iter, mem)
+		nr += ACCESS_ONCE(iter->kmem_lru_nr[lru]);
+	return nr;
+}
+
+/*
+ * Shrink the slab objects charged to @mem on behalf of limit reclaim,
+ * balanced against the part of its usage that is on the LRU lists.
+ */
+unsigned long mem_cgroup_shrink_slab(struct mem_cgroup *mem,
+				     unsigned long scanned, gfp_t gfp_mask)
+{
+	u64 kmem, usage;
+	unsigned long lru_pages;
+
+	kmem = res_counter_read_u64(&mem->kmem, RES_USAGE);
+	if (!kmem)
+		return 0;
+
+	usage = res_counter_read_u64(&mem->res, RES_USAGE);
+	lru_pages = usage > kmem ? (usage - kmem) >> PAGE_SHIFT : 0;
+	return shrink_slab_memcg(mem, scanned, gfp_mask, lru_pages);
+}
+#else
+static unsigned long mem_cgroup_kmem_reclaim(struct mem_cgroup *mem,
+					     gfp_t gfp_mask)
+{
+	return 0;
+}
+#endif
+
 /**
  * __mem_cgroup_move_account - move account of the page
  * @pc:	page_cgroup of the page.
@@ -2443,9 +2635,20 @@ int mem_cgroup_cache_charge(struct page *page, struct mm_struct *mm,
 	if (unlikely(!mm))
 		mm = &init_mm;
 
-	if (page_is_file_cache(page))
-		return mem_cgroup_charge_common(page, mm, gfp_mask,
-				MEM_CGROUP_CHARGE_TYPE_CACHE);
+	if (page_is_file_cache(page)) {
+		struct mem_cgroup *mem = NULL;
+
+		if (likely(!PageLRU(page)))
+			return mem_cgroup_charge_common(page, mm, gfp_mask,
+					MEM_CGROUP_CHARGE_TYPE_CACHE);
+		/* FUSE moves pages that are on the LRU into the page cache */
+		ret = __mem_cgroup_try_charge(mm, gfp_mask, &mem, true,
+					      PAGE_SIZE);
+		if (!ret && mem)
+			__mem_cgroup_commit_charge_lrucare(page, mem,
+					MEM_CGROUP_CHARGE_TYPE_CACHE);
+		return ret;
+	}
 
 	/* shmem */
 	if (PageSwapCache(page)) {
@@ -2505,17 +2708,12 @@ static void
 __mem_cgroup_commit_charge_swapin(struct page *page, struct mem_cgroup *ptr,
 					enum charge_type ctype)
 {
-	struct page_cgroup *pc;
-
 	if (mem_cgroup_disabled())
 		return;
 	if (!ptr)
 		return;
 	cgroup_exclude_rmdir(&ptr->css);
-	pc = lookup_page_cgroup(page);
-	mem_cgroup_lru_del_before_commit_swapcache(page);
-	__mem_cgroup_commit_charge(ptr, pc, ctype, PAGE_SIZE);
-	mem_cgroup_lru_add_after_commit_swapcache(page);
+	__mem_cgroup_commit_charge_lrucare(page, ptr, ctype);
 	/*
 	 * Now swap is on-memory. This means this page may be
 	 * counted both as mem and swap....double count.
@@ -3175,6 +3373,32 @@ static int mem_cgroup_resize_memsw_limit(struct mem_cgroup *memcg,
 	return ret;
 }
 
+static int mem_cgroup_resize_kmem_limit(struct mem_cgroup *memcg,
+					unsigned long long val)
+{
+	int retry_count = MEM_CGROUP_RECLAIM_RETRIES;
+	u64 oldusage, curusage;
+	int ret;
+
+	oldusage = res_counter_read_u64(&memcg->kmem, RES_USAGE);
+	while (1) {
+		if (signal_pending(current))
+			return -EINTR;
+		ret = res_counter_set_limit(&memcg->kmem, val);
+		if (!ret || !retry_count)
+			break;
+
+		mem_cgroup_kmem_reclaim(memcg, GFP_KERNEL);
+		curusage = res_counter_read_u64(&memcg->kmem, RES_USAGE);
+		/* Usage is reduced ? */
+		if (curusage >= oldusage)
+			retry_count--;
+		else
+			oldusage = curusage;
+	}
+	return ret;
+}
+
 unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 					    gfp_t gfp_mask)
 {
@@ -3266,41 +3490,53 @@ unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 }
 
 /*
- * This routine traverse page_cgroup in given list and drop them all.
- * *And* this routine doesn't reclaim page itself, just removes page_cgroup.
+ * This routine traverse pages in given list and drop them all.
+ * *And* this routine doesn't reclaim page itself, just moves the charges
+ * to the parent.  Uncharged pages on the list are handed over to root.
  */
 static int mem_cgroup_force_empty_list(struct mem_cgroup *mem,
 				int node, int zid, enum lru_list lru)
 {
 	struct zone *zone;
 	struct mem_cgroup_per_zone *mz;
-	struct page_cgroup *pc, *busy;
+	struct page *page, *busy;
 	unsigned long flags, loop;
 	struct list_head *list;
 	int ret = 0;
 
 	zone = &NODE_DATA(node)->node_zones[zid];
 	mz = mem_cgroup_zoneinfo(mem, node, zid);
-	list = &mz->lists[lru];
+	list = &mz->lruvec.lists[lru];
 
 	loop = MEM_CGROUP_ZSTAT(mz, lru);
 	/* give some margin against EBUSY etc...*/
 	loop += 256;
 	busy = NULL;
 	while (loop--) {
+		struct page_cgroup *pc;
+
 		ret = 0;
 		spin_lock_irqsave(&zone->lru_lock, flags);
 		if (list_empty(list)) {
 			spin_unlock_irqrestore(&zone->lru_lock, flags);
 			break;
 		}
-		pc = list_entry(list->prev, struct page_cgroup, lru);
-		if (busy == pc) {
-			list_move(&pc->lru, list);
+		page = list_entry(list->prev, struct page, lru);
+		if (busy == page) {
+			list_move(&page->lru, list);
 			busy = NULL;
 			spin_unlock_irqrestore(&zone->lru_lock, flags);
 			continue;
 		}
+		pc = lookup_page_cgroup(page);
+		if (!PageCgroupUsed(pc) && !mem_cgroup_is_root(mem)) {
+			struct lruvec *lruvec;
+
+			lruvec = mem_cgroup_lru_move_lists(zone, page, lru, lru);
+			list_move(&page->lru, &lruvec->lists[lru]);
+			spin_unlock_irqrestore(&zone->lru_lock, flags);
+			continue;
+		}
 		spin_unlock_irqrestore(&zone->lru_lock, flags);
 
 		ret = mem_cgroup_move_parent(pc, mem, GFP_KERNEL);
@@ -3309,7 +3545,7 @@ static int mem_cgroup_force_empty_list(struct mem_cgroup *mem,
 
 		if (ret == -EBUSY || ret == -EINVAL) {
 			/* found lock contention or "pc" is obsolete. */
-			busy = pc;
+			busy = page;
 			cond_resched();
 		} else
 			busy = NULL;
@@ -3320,6 +3556,18 @@ static int mem_cgroup_force_empty_list(struct mem_cgroup *mem,
 	return ret;
 }
 
+/*
+ * Charges that force_empty can get rid of.  Slab pages cannot be moved to
+ * the parent; they stay charged to this mem_cgroup until they are freed.
+ */
+static u64 mem_cgroup_user_usage(struct mem_cgroup *mem)
+{
+	u64 usage = res_counter_read_u64(&mem->res, RES_USAGE);
+	u64 kmem = res_counter_read_u64(&mem->kmem, RES_USAGE);
+
+	return usage > kmem ? usage - kmem : 0;
+}
+
 /*
  * make mem_cgroup's charge to be 0 if there is no task.
  * This enables deleting this mem_cgroup.
@@ -3370,7 +3618,7 @@ move_account:
 			goto try_to_free;
 		cond_resched();
 	/* "ret" should also be checked to ensure all lists are empty. */
-	} while (mem->res.usage > 0 || ret);
+	} while (mem_cgroup_user_usage(mem) > 0 || ret);
 out:
 	css_put(&mem->css);
 	return ret;
@@ -3385,7 +3633,7 @@ try_to_free:
 	lru_add_drain_all();
 	/* try to free all pages in this cgroup */
 	shrink = 1;
-	while (nr_retries && mem->res.usage > 0) {
+	while (nr_retries && mem_cgroup_user_usage(mem) > 0) {
 		int progress;
 
 		if (signal_pending(current)) {
@@ -3508,6 +3756,9 @@ static u64 mem_cgroup_read(struct cgroup *cont, struct cftype *cft)
 		else
 			val = res_counter_read_u64(&mem->memsw, name);
 		break;
+	case _KMEM:
+		val = res_counter_read_u64(&mem->kmem, name);
+		break;
 	default:
 		BUG();
 		break;
@@ -3540,6 +3791,8 @@ static int mem_cgroup_write(struct cgroup *cont, struct cftype *cft,
 			break;
 		if (type == _MEM)
 			ret = mem_cgroup_resize_limit(memcg, val);
+		else if (type == _KMEM)
+			ret = mem_cgroup_resize_kmem_limit(memcg, val);
 		else
 			ret = mem_cgroup_resize_memsw_limit(memcg, val);
 		break;
@@ -3604,12 +3857,16 @@ static int mem_cgroup_reset(struct cgroup *cont, unsigned int event)
 	case RES_MAX_USAGE:
 		if (type == _MEM)
 			res_counter_reset_max(&mem->res);
+		else if (type == _KMEM)
+			res_counter_reset_max(&mem->kmem);
 		else
 			res_counter_reset_max(&mem->memsw);
 		break;
 	case RES_FAILCNT:
 		if (type == _MEM)
 			res_counter_reset_failcnt(&mem->res);
+		else if (type == _KMEM)
+			res_counter_reset_failcnt(&mem->kmem);
 		else
 			res_counter_reset_failcnt(&mem->memsw);
 		break;
@@ -3767,7 +4024,9 @@ static int mem_control_stat_show(struct cgroup *cont, struct cftype *cft,
 	}
 
 #ifdef CONFIG_DEBUG_VM
-	cb->fill(cb, "inactive_ratio", calc_inactive_ratio(mem_cont, NULL));
+	cb->fill(cb, "inactive_ratio", calc_inactive_ratio(
+		mem_cgroup_get_local_zonestat(mem_cont, LRU_INACTIVE_ANON),
+		mem_cgroup_get_local_zonestat(mem_cont, LRU_ACTIVE_ANON)));
 
 	{
 		int nid, zid;
@@ -4128,6 +4387,34 @@ static void mem_cgroup_oom_unregister_event(struct cgroup *cgrp,
 	mutex_unlock(&memcg_oom_mutex);
 }
 
+/* Some nice accessors for the vmpressure. */
+struct vmpressure *memcg_to_vmpressure(struct mem_cgroup *memcg)
+{
+	if (mem_cgroup_disabled())
+		return NULL;
+	if (!memcg)
+		memcg = root_mem_cgroup;
+	if (!memcg)
+		return NULL;
+	return &memcg->vmpressure;
+}
+
+struct vmpressure *cg_to_vmpressure(struct cgroup *cg)
+{
+	return &mem_cgroup_from_cont(cg)->vmpressure;
+}
+
+struct vmpressure *vmpressure_parent(struct vmpressure *vmpr)
+{
+	struct mem_cgroup *memcg;
+
+	memcg = container_of(vmpr, struct mem_cgroup, vmpressure);
+	memcg = parent_mem_cgroup(memcg);
+	if (!memcg)
+		return NULL;
+	return &memcg->vmpressure;
+}
+
 static int mem_cgroup_oom_control_read(struct cgroup *cgrp,
 	struct cftype *cft,  struct cgroup_map_cb *cb)
 {
@@ -4231,6 +4518,11 @@ static struct cftype mem_cgroup_files[] = {
 		.unregister_event = mem_cgroup_oom_unregister_event,
 		.private = MEMFILE_PRIVATE(_OOM_TYPE, OOM_CONTROL),
 	},
+	{
+		.name = "pressure_level",
+		.register_event = vmpressure_register_event,
+		.unregister_event = vmpressure_unregister_event,
+	},
 };
 
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR_SWAP
@@ -4276,6 +4568,45 @@ static int register_memsw_files(struct cgroup *cont, struct cgroup_subsys *ss)
 }
 #endif
 
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+static struct cftype kmem_cgroup_files[] = {
+	{
+		.name = "kmem.usage_in_bytes",
+		.private = MEMFILE_PRIVATE(_KMEM, RES_USAGE),
+		.read_u64 = mem_cgroup_read,
+	},
+	{
+		.name = "kmem.max_usage_in_bytes",
+		.private = MEMFILE_PRIVATE(_KMEM, RES_MAX_USAGE),
+		.trigger = mem_cgroup_reset,
+		.read_u64 = mem_cgroup_read,
+	},
+	{
+		.name = "kmem.limit_in_bytes",
+		.private = MEMFILE_PRIVATE(_KMEM, RES_LIMIT),
+		.write_string = mem_cgroup_write,
+		.read_u64 = mem_cgroup_read,
+	},
+	{
+		.name = "kmem.failcnt",
+		.private = MEMFILE_PRIVATE(_KMEM, RES_FAILCNT),
+		.trigger = mem_cgroup_reset,
+		.read_u64 = mem_cgroup_read,
+	},
+};
+
+static int register_kmem_files(struct cgroup *cont, struct cgroup_subsys *ss)
+{
+	return cgroup_add_files(cont, ss, kmem_cgroup_files,
+				ARRAY_SIZE(kmem_cgroup_files));
+}
+#else
+static int register_kmem_files(struct cgroup *cont, struct cgroup_subsys *ss)
+{
+	return 0;
+}
+#endif
+
 static int alloc_mem_cgroup_per_zone_info(struct mem_cgroup *mem, int node)
 {
 	struct mem_cgroup_per_node *pn;
@@ -4300,7 +4631,7 @@ static int alloc_mem_cgroup_per_zone_info(struct mem_cgroup *mem, int node)
 	for (zone = 0; zone < MAX_NR_ZONES; zone++) {
 		mz = &pn->zoneinfo[zone];
 		for_each_lru(l)
-			INIT_LIST_HEAD(&mz->lists[l]);
+			INIT_LIST_HEAD(&mz->lruvec.lists[l]);
 		mz->usage_in_excess = 0;
 		mz->on_tree = false;
 		mz->mem = mem;
@@ -4331,6 +4662,14 @@ static struct mem_cgroup *mem_cgroup_alloc(void)
 	if (!mem->stat)
 		goto out_free;
 	spin_lock_init(&mem->pcp_counter_lock);
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR_KMEM
+	{
+		int lru;
+
+		for (lru = 0; lru < NR_MEM_CGROUP_KMEM_LRU; lru++)
+			INIT_LIST_HEAD(&mem->kmem_lru[lru]);
+	}
+#endif
 	return mem;
 
 out_free:
@@ -4374,13 +4713,31 @@ static void mem_cgroup_get(struct mem_cgroup *mem)
 	atomic_inc(&mem->refcnt);
 }
 
+static void mem_cgroup_free_work(struct work_struct *work)
+{
+	struct mem_cgroup *mem, *parent;
+
+	mem = container_of(work, struct mem_cgroup, free_work);
+	parent = parent_mem_cgroup(mem);
+	__mem_cgroup_free(mem);
+	if (parent)
+		mem_cgroup_put(parent);
+}
+
 static void __mem_cgroup_put(struct mem_cgroup *mem, int count)
 {
 	if (atomic_sub_and_test(count, &mem->refcnt)) {
-		struct mem_cgroup *parent = parent_mem_cgroup(mem);
-		__mem_cgroup_free(mem);
-		if (parent)
-			mem_cgroup_put(parent);
+		/*
+		 * Freeing takes non irq-safe locks and may vfree(), so
+		 * punt it to a worker if a slab page release dropped the
+		 * last reference from atomic context.
+		 */
+		if (in_interrupt() || irqs_disabled()) {
+			INIT_WORK(&mem->free_work, mem_cgroup_free_work);
+			schedule_work(&mem->free_work);
+			return;
+		}
+		mem_cgroup_free_work(&mem->free_work);
 	}
 }
 
@@ -4474,6 +4831,7 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	if (parent && parent->use_hierarchy) {
 		res_counter_init(&mem->res, &parent->res);
 		res_counter_init(&mem->memsw, &parent->memsw);
+		res_counter_init(&mem->kmem, &parent->kmem);
 		/*
 		 * We increment refcnt of the parent to ensure that we can
 		 * safely access it on res_counter_charge/uncharge.
@@ -4484,6 +4842,7 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	} else {
 		res_counter_init(&mem->res, NULL);
 		res_counter_init(&mem->memsw, NULL);
+		res_counter_init(&mem->kmem, NULL);
 	}
 	mem->last_scanned_child = 0;
 	spin_lock_init(&mem->reclaim_param_lock);
@@ -4494,6 +4853,7 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	atomic_set(&mem->refcnt, 1);
 	mem->move_charge_at_immigrate = 0;
 	mutex_init(&mem->thresholds_lock);
+	vmpressure_init(&mem->vmpressure);
 	return &mem->css;
 free_out:
 	__mem_cgroup_free(mem);
@@ -4514,6 +4874,7 @@ static void mem_cgroup_destroy(struct cgroup_subsys *ss,
 {
 	struct mem_cgroup *mem = mem_cgroup_from_cont(cont);
 
+	vmpressure_cleanup(&mem->vmpressure);
 	mem_cgroup_put(mem);
 }
 
@@ -4527,6 +4888,8 @@ static int mem_cgroup_populate(struct cgroup_subsys *ss,
 
 	if (!ret)
 		ret = register_memsw_files(cont, ss);
+	if (!ret)
+		ret = register_kmem_files(cont, ss);
 	return ret;
 }
 
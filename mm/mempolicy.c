@@ -1508,6 +1508,144 @@ static struct mempolicy *get_vma_policy(struct task_struct *task,
 	return pol;
 }
 
+#ifdef CONFIG_NUMA_BALANCING
+static unsigned long change_prot_numa_pte_range(struct vm_area_struct *vma,
+		pmd_t *pmd, unsigned long addr, unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long updated = 0;
+	pte_t *pte, *orig_pte;
+	spinlock_t *ptl;
+
+	orig_pte = pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	flush_tlb_batched_pending(mm);
+	arch_enter_lazy_mmu_mode();
+	do {
+		pte_t ptent = *pte;
+		struct page *page;
+
+		if (!pte_present(ptent) || pte_numa(ptent))
+			continue;
+		/* shared pages aren't migrated, so don't fault on them */
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page || page_mapcount(page) != 1)
+			continue;
+
+		ptent = ptep_modify_prot_start(mm, addr, pte);
+		ptent = pte_mknuma(ptent);
+		ptep_modify_prot_commit(mm, addr, pte, ptent);
+		updated++;
+	} while (pte++, addr += PAGE_SIZE, addr != end);
+	arch_leave_lazy_mmu_mode();
+	pte_unmap_unlock(orig_pte, ptl);
+
+	return updated;
+}
+
+static unsigned long change_prot_numa_pmd_range(struct vm_area_struct *vma,
+		pud_t *pud, unsigned long addr, unsigned long end)
+{
+	unsigned long next, updated = 0;
+	pmd_t *pmd;
+
+	pmd = pmd_offset(pud, addr);
+	do {
+		next = pmd_addr_end(addr, end);
+		/* transparent huge pages are not sampled */
+		if (pmd_trans_huge(*pmd))
+			continue;
+		if (pmd_none_or_clear_bad(pmd))
+			continue;
+		updated += change_prot_numa_pte_range(vma, pmd, addr, next);
+	} while (pmd++, addr = next, addr != end);
+
+	return updated;
+}
+
+static unsigned long change_prot_numa_pud_range(struct vm_area_struct *vma,
+		pgd_t *pgd, unsigned long addr, unsigned long end)
+{
+	unsigned long next, updated = 0;
+	pud_t *pud;
+
+	pud = pud_offset(pgd, addr);
+	do {
+		next = pud_addr_end(addr, end);
+		if (pud_none_or_clear_bad(pud))
+			continue;
+		updated += change_prot_numa_pmd_range(vma, pud, addr, next);
+	} while (pud++, addr = next, addr != end);
+
+	return updated;
+}
+
+/*
+ * change_prot_numa - arm NUMA hinting faults on part of a vma
+ *
+ * Turns the ptes of the pages in [@addr, @end) that are mapped only by
+ * this mm into NUMA hinting ptes (see pte_mknuma()), so that the next
+ * access to each page faults into do_numa_page().  The caller holds
+ * mmap_sem for read.  Returns the number of ptes changed.
+ */
+unsigned long change_prot_numa(struct vm_area_struct *vma,
+			unsigned long addr, unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long next, start = addr, updated = 0;
+	pgd_t *pgd;
+
+	VM_BUG_ON(addr >= end);
+	pgd = pgd_offset(mm, addr);
+	flush_cache_range(vma, addr, end);
+	do {
+		next = pgd_addr_end(addr, end);
+		if (pgd_none_or_clear_bad(pgd))
+			continue;
+		updated += change_prot_numa_pud_range(vma, pgd, addr, next);
+	} while (pgd++, addr = next, addr != end);
+
+	if (updated) {
+		flush_tlb_range(vma, start, end);
+		count_vm_events(NUMA_PTE_UPDATES, updated);
+	}
+
+	return updated;
+}
+
+/*
+ * mpol_misplaced - check whether a page that took a hinting fault
+ * should move to the faulting task's node
+ * @page: page to be checked
+ * @vma: vm area where page mapped
+ * @addr: virtual address where page mapped
+ *
+ * Only the default, allocate-locally policy (inherited or explicit) opts
+ * pages into lazy migration; any other policy was placed there by the
+ * user and is respected.  Called with mmap_sem held for read.
+ *
+ * Returns the node the page should move to, or -1 if it should stay.
+ */
+int mpol_misplaced(struct page *page, struct vm_area_struct *vma,
+		   unsigned long addr)
+{
+	int thisnid = numa_node_id();
+	struct mempolicy *pol;
+	int ret = -1;
+
+	if (page_to_nid(page) == thisnid)
+		return -1;
+	if (!node_isset(thisnid, cpuset_current_mems_allowed))
+		return -1;
+
+	pol = get_vma_policy(current, vma, addr);
+	if (pol->mode == MPOL_PREFERRED && (pol->flags & MPOL_F_LOCAL))
+		ret = thisnid;
+	mpol_cond_put(pol);
+
+	return ret;
+}
+#endif /* CONFIG_NUMA_BALANCING */
+
 /*
  * Return a nodemask representing a mempolicy for filtering nodes for
  * page allocation
@@ -367,6 +367,8 @@ void migrate_page_copy(struct page *newpage, struct page *page)
 		SetPageChecked(newpage);
 	if (PageMappedToDisk(page))
 		SetPageMappedToDisk(newpage);
+	if (TestClearPagePrefetched(page))
+		SetPagePrefetched(newpage);
 
 	if (PageDirty(page)) {
 		clear_page_dirty_for_io(page);
@@ -1353,3 +1355,76 @@ int migrate_vmas(struct mm_struct *mm, const nodemask_t *to,
  	return err;
 }
 #endif
+
+#ifdef CONFIG_NUMA_BALANCING
+static struct page *alloc_misplaced_dst_page(struct page *page,
+					     unsigned long data,
+					     int **result)
+{
+	int nid = (int) data;
+
+	return alloc_pages_exact_node(nid, GFP_HIGHUSER_MOVABLE |
+				      __GFP_THISNODE | __GFP_NOMEMALLOC |
+				      __GFP_NORETRY | __GFP_NOWARN, 0);
+}
+
+/*
+ * Only migrate onto a node that has memory to spare: the fault path is
+ * no place to start reclaim, and reclaim would likely just push the
+ * page out again.
+ */
+static bool migrate_balanced_pgdat(struct pglist_data *pgdat,
+				   int nr_pages)
+{
+	int z;
+
+	for (z = pgdat->nr_zones - 1; z >= 0; z--) {
+		struct zone *zone = pgdat->node_zones + z;
+
+		if (!populated_zone(zone) || zone->all_unreclaimable)
+			continue;
+		if (zone_watermark_ok(zone, 0,
+				      high_wmark_pages(zone) + nr_pages, 0, 0))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Move a page that took a NUMA hinting fault to @node, the node of the
+ * task that touched it.  Called with mmap_sem held for read and with a
+ * reference on @page, which is consumed.  Pages mapped by more than one
+ * process are left alone, they would only bounce between the nodes of
+ * their users.
+ *
+ * Returns true if the page was moved.
+ */
+bool migrate_misplaced_page(struct page *page, int node)
+{
+	LIST_HEAD(migratepages);
+
+	if (page_mapcount(page) != 1 || PageTransHuge(page))
+		goto out;
+	if (!migrate_balanced_pgdat(NODE_DATA(node), 1))
+		goto out;
+	if (isolate_lru_page(page))
+		goto out;
+
+	/* isolate_lru_page() took its own reference */
+	put_page(page);
+	inc_zone_page_state(page, NR_ISOLATED_ANON + page_is_file_cache(page));
+	list_add(&page->lru, &migratepages);
+
+	if (migrate_pages(&migratepages, alloc_misplaced_dst_page, node,
+			  false, false)) {
+		putback_lru_pages(&migratepages);
+		return false;
+	}
+	count_vm_event(NUMA_PAGE_MIGRATE);
+	return true;
+
+out:
+	put_page(page);
+	return false;
+}
+#endif /* CONFIG_NUMA_BALANCING */
@@ -2225,6 +2225,160 @@ __alloc_pages_nodemask(gfp_t gfp_mask, unsigned int order,
 }
 EXPORT_SYMBOL(__alloc_pages_nodemask);
 
+/**
+ * __alloc_pages_bulk_nodemask - allocate a batch of order-0 pages
+ * @gfp_mask: GFP flags for the allocation
+ * @zonelist: zonelist to allocate from
+ * @nodemask: mask of allowed nodes, or NULL
+ * @nr_pages: number of pages to allocate, including populated @page_array slots
+ * @page_list: list to add the pages to, or NULL
+ * @page_array: array to store the pages in, or NULL
+ *
+ * Takes order-0 pages straight from the per-cpu lists of the first zone
+ * which stays above its low watermark with @nr_pages pages taken, refilling
+ * the per-cpu list from the buddy lists with rmqueue_bulk() as needed.  The
+ * zonelist is walked once and interrupts are disabled once for the whole
+ * batch, rather than once per page as for a loop of alloc_page() calls.
+ *
+ * Slots of @page_array which are already populated are skipped, so an array
+ * that was only partially filled can be passed in again.  When no zone can
+ * take the batch, a single page is allocated through the normal allocator
+ * path, which may reclaim if @gfp_mask allows it, so callers that loop until
+ * they have all their pages still make progress.
+ *
+ * Returns the number of pages on @page_list, or the number of populated
+ * slots at the start of @page_array.
+ */
+unsigned long
+__alloc_pages_bulk_nodemask(gfp_t gfp_mask, struct zonelist *zonelist,
+			    nodemask_t *nodemask, unsigned long nr_pages,
+			    struct list_head *page_list,
+			    struct page **page_array)
+{
+	enum zone_type high_zoneidx = gfp_zone(gfp_mask);
+	int migratetype = allocflags_to_migratetype(gfp_mask);
+	int cold = !!(gfp_mask & __GFP_COLD);
+	struct zone *preferred_zone, *zone;
+	struct per_cpu_pages *pcp;
+	struct list_head *list;
+	unsigned long nr_populated = 0;
+	unsigned long nr_account = 0;
+	unsigned long flags;
+	struct zoneref *z;
+	struct page *page;
+
+	/* Skip the slots of @page_array that are already populated */
+	while (page_array && nr_populated < nr_pages &&
+	       page_array[nr_populated])
+		nr_populated++;
+
+	if (nr_populated == nr_pages)
+		return nr_populated;
+
+	/* A single page is not worth the batch setup */
+	if (nr_pages - nr_populated == 1)
+		goto failed;
+
+	gfp_mask &= gfp_allowed_mask;
+
+	lockdep_trace_alloc(gfp_mask);
+
+	might_sleep_if(gfp_mask & __GFP_WAIT);
+
+	if (should_fail_alloc_page(gfp_mask, 0))
+		return nr_populated;
+
+	if (unlikely(!zonelist->_zonerefs->zone))
+		return nr_populated;
+
+	get_mems_allowed();
+	first_zones_zonelist(zonelist, high_zoneidx,
+				nodemask ? : &cpuset_current_mems_allowed,
+				&preferred_zone);
+	if (!preferred_zone)
+		goto failed_mems;
+
+	/* Find a zone with room for the whole batch above its low watermark */
+	for_each_zone_zonelist_nodemask(zone, z, zonelist,
+						high_zoneidx, nodemask) {
+		unsigned long mark;
+
+		if (!cpuset_zone_allowed_softwall(zone,
+						  gfp_mask | __GFP_HARDWALL))
+			continue;
+
+		mark = low_wmark_pages(zone) + nr_pages - nr_populated;
+		if (zone_watermark_ok(zone, 0, mark, zone_idx(preferred_zone),
+				      ALLOC_WMARK_LOW | ALLOC_CPUSET))
+			break;
+	}
+	if (!zone)
+		goto failed_mems;
+
+	local_irq_save(flags);
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list = &pcp->lists[migratetype];
+	while (nr_populated < nr_pages) {
+		/* Skip populated array slots */
+		if (page_array && page_array[nr_populated]) {
+			nr_populated++;
+			continue;
+		}
+
+		if (list_empty(list)) {
+			pcp->count += rmqueue_bulk(zone, 0,
+					pcp->batch, list,
+					migratetype, cold);
+			if (unlikely(list_empty(list)))
+				break;
+		}
+
+		if (cold)
+			page = list_entry(list->prev, struct page, lru);
+		else
+			page = list_entry(list->next, struct page, lru);
+
+		list_del(&page->lru);
+		pcp->count--;
+		nr_account++;
+
+		zone_statistics(preferred_zone, zone);
+		VM_BUG_ON(bad_range(zone, page));
+		if (prep_new_page(page, 0, gfp_mask))
+			continue;
+
+		trace_mm_page_alloc(page, 0, gfp_mask, migratetype);
+		if (page_list)
+			list_add(&page->lru, page_list);
+		else
+			page_array[nr_populated] = page;
+		nr_populated++;
+	}
+	__count_zone_vm_events(PGALLOC, zone, nr_account);
+	local_irq_restore(flags);
+	put_mems_allowed();
+
+	if (!nr_account)
+		goto failed;
+
+	return nr_populated;
+
+failed_mems:
+	put_mems_allowed();
+failed:
+	page = __alloc_pages_nodemask(gfp_mask, 0, zonelist, nodemask);
+	if (page) {
+		if (page_list)
+			list_add(&page->lru, page_list);
+		else
+			page_array[nr_populated] = page;
+		nr_populated++;
+	}
+
+	return nr_populated;
+}
+EXPORT_SYMBOL(__alloc_pages_bulk_nodemask);
+
 /*
  * Common helper functions.
  */
@@ -4135,6 +4289,10 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 	pgdat_resize_init(pgdat);
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
+	init_waitqueue_head(&pgdat->kswapd_helper_wait);
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat->kswapd_max_order = 0;
 	pgdat_page_cgroup_init(pgdat);
 	
@@ -4192,7 +4350,7 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 
 		zone_pcp_init(zone);
 		for_each_lru(l) {
-			INIT_LIST_HEAD(&zone->lru[l].list);
+			INIT_LIST_HEAD(&zone->lruvec.lists[l]);
 			zone->reclaim_stat.nr_saved_scan[l] = 0;
 		}
 		zone->reclaim_stat.recent_rotated[0] = 0;
@@ -5579,6 +5737,7 @@ static struct trace_print_flags pageflag_names[] = {
 	{1UL << PG_reclaim,		"reclaim"	},
 	{1UL << PG_swapbacked,		"swapbacked"	},
 	{1UL << PG_unevictable,		"unevictable"	},
+	{1UL << PG_prefetched,		"prefetched"	},
 #ifdef CONFIG_MMU
 	{1UL << PG_mlocked,		"mlocked"	},
 #endif
@@ -17,6 +17,8 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/cpuset.h>
+#include <linux/slab.h>
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -133,6 +135,33 @@ out:
 	return ret;
 }
 
+/*
+ * Bulk allocate pages for the not yet cached pages in the readahead range.
+ * A page that shows up in the page cache meanwhile leaves a spare page,
+ * which the caller frees.
+ */
+static void readahead_alloc_pages(struct address_space *mapping,
+			pgoff_t offset, unsigned long nr_to_read,
+			unsigned long end_index, struct list_head *pages)
+{
+	unsigned long nr = 0;
+	unsigned long i;
+
+	/* Pages must be spread over the cpuset's nodes one at a time */
+	if (cpuset_do_page_mem_spread())
+		return;
+
+	rcu_read_lock();
+	for (i = 0; i < nr_to_read && offset + i <= end_index; i++)
+		if (!radix_tree_lookup(&mapping->page_tree, offset + i))
+			nr++;
+	rcu_read_unlock();
+
+	if (nr > 1)
+		alloc_pages_bulk_list(mapping_gfp_mask(mapping) | __GFP_COLD,
+				      nr, pages);
+}
+
 /*
  * __do_page_cache_readahead() actually reads a chunk of disk.  It allocates all
  * the pages first, then submits them all for I/O. This avoids the very bad
@@ -150,6 +179,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	struct page *page;
 	unsigned long end_index;	/* The last page we want to read */
 	LIST_HEAD(page_pool);
+	LIST_HEAD(spare_pages);
 	int page_idx;
 	int ret = 0;
 	loff_t isize = i_size_read(inode);
@@ -159,6 +189,13 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 
 	end_index = ((isize - 1) >> PAGE_CACHE_SHIFT);
 
+	/*
+	 * Allocate the pages for the holes in the range in one batch, the
+	 * loop below falls back to single allocations if it comes up short.
+	 */
+	readahead_alloc_pages(mapping, offset, nr_to_read, end_index,
+			      &spare_pages);
+
 	/*
 	 * Preallocate as many pages as we will need.
 	 */
@@ -174,13 +211,19 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (page)
 			continue;
 
-		page = page_cache_alloc_cold(mapping);
+		if (!list_empty(&spare_pages)) {
+			page = list_first_entry(&spare_pages, struct page, lru);
+			list_del(&page->lru);
+		} else
+			page = page_cache_alloc_cold(mapping);
 		if (!page)
 			break;
 		page->index = page_offset;
 		list_add(&page->lru, &page_pool);
 		if (page_idx == nr_to_read - lookahead_size)
 			SetPageReadahead(page);
+		/* the first access counts as a readahead hit */
+		SetPagePrefetched(page);
 		ret++;
 	}
 
@@ -192,6 +235,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	if (ret)
 		read_pages(mapping, filp, &page_pool, ret);
 	BUG_ON(!list_empty(&page_pool));
+	put_pages_list(&spare_pages);
 out:
 	return ret;
 }
@@ -328,6 +372,12 @@ static unsigned long get_next_ra_size(struct file_ra_state *ra,
  *
  * The code ramps up the readahead size aggressively at first, but slow down as
  * it approaches max_readhead.
+ *
+ * Small reads that are not sequential get two more chances: reads separated
+ * by a constant gap are detected as a strided stream, and read ahead stride
+ * by stride (see stride_readahead()); and the hot spots of files that are
+ * read at random may be recorded, to be read ahead again as soon as the
+ * file is opened next time (see FADV_RA_HISTORY).
  */
 
 /*
@@ -383,6 +433,200 @@ static int try_context_readahead(struct address_space *mapping,
 	return 1;
 }
 
+/*
+ * Number of reads in a row that must be separated by the same gap before
+ * they are taken for a strided stream: three reads, so two equal gaps.
+ */
+#define RA_STRIDE_HITS		3
+
+/*
+ * Is the read at @offset the next one of a strided stream?
+ *
+ * ra->stride is the gap, in pages, between the last page of the previous
+ * read request (prev_pos) and the first page of this one, and
+ * ra->stride_hits the number of reads that were seen with that same gap.
+ */
+static int ra_stride_update(struct file_ra_state *ra, pgoff_t offset)
+{
+	pgoff_t prev = ra->prev_pos >> PAGE_CACHE_SHIFT;
+
+	if (ra->prev_pos == -1 || offset <= prev + 1) {
+		ra->stride_hits = 0;
+		return 0;
+	}
+
+	if (offset - prev != ra->stride) {
+		ra->stride = offset - prev;
+		ra->stride_hits = 2;
+		return 0;
+	}
+
+	if (ra->stride_hits < RA_STRIDE_HITS)
+		ra->stride_hits++;
+	return ra->stride_hits >= RA_STRIDE_HITS;
+}
+
+/*
+ * Read ahead a strided stream: @req_size pages every @step pages from
+ * @offset, up to max pages in total.  The chunk in the middle is marked
+ * with PG_readahead, so that the next batch is submitted asynchronously
+ * while the application works through the second half of this one.
+ */
+static unsigned long
+stride_readahead(struct address_space *mapping, struct file_ra_state *ra,
+		 struct file *filp, pgoff_t offset, unsigned long req_size,
+		 unsigned long max)
+{
+	unsigned long step = ra->stride + req_size - 1;
+	unsigned long nr_chunks = max / req_size;
+	pgoff_t end_index;
+	unsigned long i;
+	unsigned long ret = 0;
+	loff_t isize;
+
+	isize = i_size_read(mapping->host);
+	if (!isize)
+		return 0;
+	end_index = (isize - 1) >> PAGE_CACHE_SHIFT;
+
+	for (i = 0; i < nr_chunks && offset <= end_index; i++) {
+		ret += __do_page_cache_readahead(mapping, filp, offset,
+				req_size, i == nr_chunks / 2 ? req_size : 0);
+		ra->stride_prev = offset;
+		if (end_index - offset < step)
+			break;
+		offset += step;
+	}
+	if (ret)
+		count_vm_event(FILE_RA_STRIDE);
+
+	return ret;
+}
+
+/*
+ * Per inode history of small random reads, replayed as readahead when the
+ * file is opened again.  Meant for files that are read at the same random
+ * spots over and over, like the index of a database: the first reads after
+ * the open are then served from the page cache instead of paying one seek
+ * each.
+ *
+ * Recording is enabled with fadvise(FADV_RA_HISTORY), and the history
+ * lives as long as the inode stays in core.  Once allocated it is only
+ * freed along with the inode, FADV_RA_NOHISTORY merely empties it.
+ */
+#define RA_HISTORY_SIZE		64
+
+struct file_ra_history {
+	spinlock_t lock;
+	int enabled;			/* record new reads */
+	unsigned int next;		/* slot to be reused next */
+	struct {
+		pgoff_t index;
+		unsigned long nr;	/* 0 for an unused slot */
+	} reads[RA_HISTORY_SIZE];
+};
+
+static void ra_history_record(struct address_space *mapping, pgoff_t offset,
+			      unsigned long nr)
+{
+	struct file_ra_history *history = ACCESS_ONCE(mapping->ra_history);
+	int i;
+
+	if (!history || !history->enabled)
+		return;
+
+	spin_lock(&history->lock);
+	for (i = 0; i < RA_HISTORY_SIZE; i++) {
+		if (history->reads[i].nr &&
+		    offset >= history->reads[i].index &&
+		    offset < history->reads[i].index + history->reads[i].nr)
+			goto out;
+	}
+	i = history->next;
+	history->reads[i].index = offset;
+	history->reads[i].nr = nr;
+	history->next = (i + 1) % RA_HISTORY_SIZE;
+out:
+	spin_unlock(&history->lock);
+}
+
+/**
+ * page_cache_ra_history_start - record the random reads of a file
+ * @mapping: address_space of the file
+ *
+ * Called for fadvise(FADV_RA_HISTORY).  Returns 0 or -ENOMEM.
+ */
+int page_cache_ra_history_start(struct address_space *mapping)
+{
+	struct file_ra_history *history = mapping->ra_history;
+
+	if (!history) {
+		history = kzalloc(sizeof(*history), GFP_KERNEL);
+		if (!history)
+			return -ENOMEM;
+		spin_lock_init(&history->lock);
+		if (cmpxchg(&mapping->ra_history, NULL, history)) {
+			kfree(history);
+			history = mapping->ra_history;
+		}
+	}
+	history->enabled = 1;
+	return 0;
+}
+
+/**
+ * page_cache_ra_history_stop - forget the random reads of a file
+ * @mapping: address_space of the file
+ *
+ * Called for fadvise(FADV_RA_NOHISTORY).
+ */
+void page_cache_ra_history_stop(struct address_space *mapping)
+{
+	struct file_ra_history *history = mapping->ra_history;
+
+	if (!history)
+		return;
+
+	spin_lock(&history->lock);
+	history->enabled = 0;
+	memset(history->reads, 0, sizeof(history->reads));
+	history->next = 0;
+	spin_unlock(&history->lock);
+}
+
+/**
+ * page_cache_ra_history_replay - read ahead the recorded hot spots of a file
+ * @mapping: address_space of the file
+ * @filp: the file being opened
+ *
+ * Called once open(2) has completed for files with a readahead history,
+ * so that ->readpages sees a fully set up @filp.  The reads that are
+ * still cached cost one radix tree lookup per page.
+ */
+void page_cache_ra_history_replay(struct address_space *mapping,
+				  struct file *filp)
+{
+	struct file_ra_history *history = mapping->ra_history;
+	unsigned long nr;
+	pgoff_t index;
+	int i;
+
+	if (!filp->f_ra.ra_pages || !mapping->a_ops->readpages)
+		return;
+
+	for (i = 0; i < RA_HISTORY_SIZE; i++) {
+		spin_lock(&history->lock);
+		index = history->reads[i].index;
+		nr = history->reads[i].nr;
+		spin_unlock(&history->lock);
+
+		if (nr)
+			count_vm_events(FILE_RA_REPLAY,
+				__do_page_cache_readahead(mapping, filp,
+							  index, nr, 0));
+	}
+}
+
 /*
  * A minimal readahead algorithm for trivial sequential/random reads.
  */
@@ -421,6 +665,20 @@ ondemand_readahead(struct address_space *mapping,
 	if (hit_readahead_marker) {
 		pgoff_t start;
 
+		/*
+		 * The marker in the middle of the last strided batch:
+		 * push on to the next batch.
+		 */
+		if (ra->stride_hits >= RA_STRIDE_HITS &&
+		    offset <= ra->stride_prev && req_size <= max) {
+			unsigned long step = ra->stride + req_size - 1;
+
+			if ((ra->stride_prev - offset) % step == 0)
+				return stride_readahead(mapping, ra, filp,
+						ra->stride_prev + step,
+						req_size, max);
+		}
+
 		rcu_read_lock();
 		start = radix_tree_next_hole(&mapping->page_tree, offset+1,max);
 		rcu_read_unlock();
@@ -455,10 +713,18 @@ ondemand_readahead(struct address_space *mapping,
 	if (try_context_readahead(mapping, ra, offset, req_size, max))
 		goto readit;
 
+	/*
+	 * Small reads separated by a constant gap.
+	 */
+	if (ra_stride_update(ra, offset))
+		return stride_readahead(mapping, ra, filp, offset,
+					req_size, max);
+
 	/*
 	 * standalone, small random read
 	 * Read as is, and do not pollute the readahead state.
 	 */
+	ra_history_record(mapping, offset, req_size);
 	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
 
 initial_readahead:
@@ -467,6 +733,7 @@ initial_readahead:
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
 
 readit:
+	ra->stride_hits = 0;
 	/*
 	 * Will this read hit the readahead marker made by itself?
 	 * If so, trigger the readahead marker hit now, and merge
@@ -504,6 +771,8 @@ void page_cache_sync_readahead(struct address_space *mapping,
 
 	/* be dumb */
 	if (filp && (filp->f_mode & FMODE_RANDOM)) {
+		ra_history_record(mapping, offset,
+				  min_t(unsigned long, req_size, ra->ra_pages));
 		force_page_cache_readahead(mapping, filp, offset, req_size);
 		return;
 	}
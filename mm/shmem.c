@@ -60,6 +60,8 @@ static struct vfsmount *shm_mnt;
 #include <linux/highmem.h>
 #include <linux/seq_file.h>
 #include <linux/magic.h>
+#include <linux/pagevec.h>
+#include <linux/khugepaged.h>
 
 #include <asm/uaccess.h>
 #include <asm/div64.h>
@@ -107,6 +109,27 @@ enum sgp_type {
 	SGP_WRITE,	/* may exceed i_size, may allocate page */
 };
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/*
+ * Huge page policy of a mount, set with the huge= option (or through
+ * /sys/kernel/mm/transparent_hugepage/shmem_enabled for the internal
+ * mount behind SysV SHM and shared anonymous mappings).
+ */
+#define SHMEM_HUGE_NEVER	0
+#define SHMEM_HUGE_ALWAYS	1
+#define SHMEM_HUGE_WITHIN_SIZE	2
+#define SHMEM_HUGE_ADVISE	3
+
+/*
+ * Only for shmem_enabled: DENY disables huge pages on all mounts, for
+ * use in emergencies; FORCE enables them on all mounts, for testing.
+ */
+#define SHMEM_HUGE_DENY		(-1)
+#define SHMEM_HUGE_FORCE	(-2)
+
+static int shmem_huge __read_mostly;
+#endif
+
 #ifdef CONFIG_TMPFS
 static unsigned long shmem_default_max_blocks(void)
 {
@@ -1208,6 +1231,279 @@ static inline struct mempolicy *shmem_get_sbmpol(struct shmem_sb_info *sbinfo)
 }
 #endif
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static int shmem_parse_huge(const char *str)
+{
+	if (!strcmp(str, "never"))
+		return SHMEM_HUGE_NEVER;
+	if (!strcmp(str, "always"))
+		return SHMEM_HUGE_ALWAYS;
+	if (!strcmp(str, "within_size"))
+		return SHMEM_HUGE_WITHIN_SIZE;
+	if (!strcmp(str, "advise"))
+		return SHMEM_HUGE_ADVISE;
+	if (!strcmp(str, "deny"))
+		return SHMEM_HUGE_DENY;
+	if (!strcmp(str, "force"))
+		return SHMEM_HUGE_FORCE;
+	return -EINVAL;
+}
+
+static const char *shmem_format_huge(int huge)
+{
+	switch (huge) {
+	case SHMEM_HUGE_NEVER:
+		return "never";
+	case SHMEM_HUGE_ALWAYS:
+		return "always";
+	case SHMEM_HUGE_WITHIN_SIZE:
+		return "within_size";
+	case SHMEM_HUGE_ADVISE:
+		return "advise";
+	case SHMEM_HUGE_DENY:
+		return "deny";
+	case SHMEM_HUGE_FORCE:
+		return "force";
+	default:
+		VM_BUG_ON(1);
+		return "bad_val";
+	}
+}
+
+/*
+ * May the block of HPAGE_PMD_NR indexes around @index be backed by a
+ * huge extent?  @vma is NULL when not called from a page fault.
+ */
+static int shmem_huge_allowed(struct inode *inode, pgoff_t index,
+			      struct vm_area_struct *vma)
+{
+	loff_t i_size;
+
+	if (shmem_huge == SHMEM_HUGE_DENY)
+		return 0;
+	if (shmem_huge == SHMEM_HUGE_FORCE)
+		return 1;
+
+	switch (SHMEM_SB(inode->i_sb)->huge) {
+	case SHMEM_HUGE_ALWAYS:
+		return 1;
+	case SHMEM_HUGE_WITHIN_SIZE:
+		i_size = PAGE_CACHE_ALIGN(i_size_read(inode));
+		return (i_size >> PAGE_CACHE_SHIFT) >= (index | (HPAGE_PMD_NR - 1)) + 1;
+	case SHMEM_HUGE_ADVISE:
+		return vma && (vma->vm_flags & VM_HUGEPAGE);
+	}
+	return 0;
+}
+
+/*
+ * Huge pmds only ever map shmem pages in mappings that can't COW them.
+ */
+static int shmem_huge_vma(struct vm_area_struct *vma)
+{
+	struct file *file = vma->vm_file;
+
+	if (!(vma->vm_flags & VM_MAYSHARE) ||
+	    (vma->vm_flags & (VM_NOHUGEPAGE | VM_NONLINEAR)))
+		return 0;
+	return file && file->f_mapping->a_ops == &shmem_aops;
+}
+
+int shmem_huge_enabled(struct vm_area_struct *vma)
+{
+	return shmem_huge_vma(vma) &&
+		shmem_huge_allowed(vma->vm_file->f_mapping->host, 0, vma);
+}
+
+static struct page *shmem_alloc_hugepage(gfp_t gfp,
+			struct shmem_inode_info *info, unsigned long idx)
+{
+#ifdef CONFIG_NUMA
+	struct vm_area_struct pvma;
+
+	/* Create a pseudo vma that just contains the policy */
+	pvma.vm_start = 0;
+	pvma.vm_pgoff = idx;
+	pvma.vm_ops = NULL;
+	pvma.vm_policy = mpol_shared_policy_lookup(&info->policy, idx);
+
+	/*
+	 * alloc_pages_vma() will drop the shared policy reference
+	 */
+	return alloc_pages_vma(gfp, HPAGE_PMD_ORDER, &pvma, 0);
+#else
+	return alloc_pages(gfp, HPAGE_PMD_ORDER);
+#endif
+}
+
+static int shmem_block_empty(struct address_space *mapping, pgoff_t start)
+{
+	struct page *page;
+	pgoff_t index;
+
+	if (!find_get_pages(mapping, start, 1, &page))
+		return 1;
+	index = page->index;
+	page_cache_release(page);
+	return index >= start + HPAGE_PMD_NR;
+}
+
+/*
+ * shmem_huge_populate - fill an empty block with a huge extent
+ *
+ * Fill the aligned block of HPAGE_PMD_NR indexes around @index with the
+ * pages of one naturally aligned, physically contiguous extent, which
+ * shmem_pmd_fault() can then map with a single huge pmd.  The pagecache
+ * still only ever sees small pages, so they are reclaimed, swapped,
+ * truncated and migrated one by one later on, like any other.
+ *
+ * Returns 0 once the block is populated; the caller falls back to
+ * small pages on any error.
+ */
+static int shmem_huge_populate(struct inode *inode, pgoff_t index,
+			       enum sgp_type sgp, struct vm_area_struct *vma)
+{
+	struct address_space *mapping = inode->i_mapping;
+	struct shmem_inode_info *info = SHMEM_I(inode);
+	struct shmem_sb_info *sbinfo = SHMEM_SB(inode->i_sb);
+	pgoff_t start = index & ~(pgoff_t)(HPAGE_PMD_NR - 1);
+	swp_entry_t *entry;
+	struct page *page;
+	int i, charged, nr = 0;
+	int error;
+
+	if (!shmem_huge_allowed(inode, index, vma))
+		return -EINVAL;
+	if (start + HPAGE_PMD_NR > SHMEM_MAX_INDEX)
+		return -EFBIG;
+	if (sgp != SGP_WRITE &&
+	    ((loff_t)(start + HPAGE_PMD_NR) << PAGE_CACHE_SHIFT) >
+	    i_size_read(inode))
+		return -EINVAL;
+	if (!shmem_block_empty(mapping, start))
+		return -EEXIST;
+
+	if (sbinfo->max_blocks) {
+		if (sbinfo->max_blocks < HPAGE_PMD_NR ||
+		    percpu_counter_compare(&sbinfo->used_blocks,
+				sbinfo->max_blocks - HPAGE_PMD_NR) > 0)
+			return -ENOSPC;
+		percpu_counter_add(&sbinfo->used_blocks, HPAGE_PMD_NR);
+		spin_lock(&inode->i_lock);
+		inode->i_blocks += BLOCKS_PER_PAGE * HPAGE_PMD_NR;
+		spin_unlock(&inode->i_lock);
+	}
+	if ((info->flags & VM_NORESERVE) &&
+	    security_vm_enough_memory_kern(VM_ACCT(PAGE_CACHE_SIZE) *
+					   HPAGE_PMD_NR)) {
+		shmem_free_blocks(inode, HPAGE_PMD_NR);
+		return -ENOSPC;
+	}
+
+	page = shmem_alloc_hugepage(mapping_gfp_mask(mapping) |
+				    __GFP_NORETRY | __GFP_NOWARN |
+				    __GFP_NO_KSWAPD, info, start);
+	if (!page) {
+		count_vm_event(THP_SHMEM_FALLBACK);
+		error = -ENOMEM;
+		goto unacct;
+	}
+	count_vm_event(THP_SHMEM_ALLOC);
+	split_page(page, HPAGE_PMD_ORDER);
+
+	for (charged = 0; charged < HPAGE_PMD_NR; charged++) {
+		clear_highpage(page + charged);
+		flush_dcache_page(page + charged);
+		SetPageUptodate(page + charged);
+		SetPageSwapBacked(page + charged);
+		if (mem_cgroup_cache_charge(page + charged, current->mm,
+					    GFP_KERNEL))
+			break;
+	}
+	error = -ENOMEM;
+	if (charged < HPAGE_PMD_NR)
+		goto free;
+
+	spin_lock(&info->lock);
+	shmem_recalc_inode(inode);
+	/* allocate the swap vector for the block: this may drop info->lock */
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		unsigned long swapped;
+
+		entry = shmem_swp_alloc(info, start + i, sgp);
+		if (IS_ERR(entry)) {
+			error = PTR_ERR(entry);
+			goto unlock;
+		}
+		swapped = entry->val;
+		shmem_swp_unmap(entry);
+		if (swapped) {
+			error = -EEXIST;
+			goto unlock;
+		}
+	}
+	/* so check again that the block is still empty and within i_size */
+	error = -EEXIST;
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		unsigned long swapped;
+
+		entry = shmem_swp_entry(info, start + i, NULL);
+		if (!entry)
+			goto unlock;
+		swapped = entry->val;
+		shmem_swp_unmap(entry);
+		if (swapped)
+			goto unlock;
+	}
+	if (sgp != SGP_WRITE &&
+	    ((loff_t)(start + HPAGE_PMD_NR) << PAGE_CACHE_SHIFT) >
+	    i_size_read(inode))
+		goto unlock;
+	if (!shmem_block_empty(mapping, start))
+		goto unlock;
+
+	/*
+	 * At add_to_page_cache_lru() failure, uncharge will be done
+	 * automatically: the rest of the block is left to small pages.
+	 */
+	for (nr = 0; nr < HPAGE_PMD_NR; nr++)
+		if (add_to_page_cache_lru(page + nr, mapping, start + nr,
+					  GFP_NOWAIT))
+			break;
+	info->alloced += nr;
+	if (nr)
+		info->flags |= SHMEM_PAGEIN;
+	error = 0;
+unlock:
+	spin_unlock(&info->lock);
+	for (i = 0; i < nr; i++) {
+		if (sgp == SGP_DIRTY)
+			set_page_dirty(page + i);
+		unlock_page(page + i);
+		page_cache_release(page + i);
+	}
+free:
+	for (i = nr; i < HPAGE_PMD_NR; i++) {
+		if (i < charged)
+			mem_cgroup_uncharge_cache_page(page + i);
+		page_cache_release(page + i);
+	}
+unacct:
+	if (nr < HPAGE_PMD_NR) {
+		shmem_unacct_blocks(info->flags, HPAGE_PMD_NR - nr);
+		shmem_free_blocks(inode, HPAGE_PMD_NR - nr);
+	}
+	return nr ? 0 : error;
+}
+#else /* !CONFIG_TRANSPARENT_HUGEPAGE */
+static inline int shmem_huge_populate(struct inode *inode, pgoff_t index,
+				      enum sgp_type sgp,
+				      struct vm_area_struct *vma)
+{
+	return -EINVAL;
+}
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
 /*
  * shmem_getpage - either get the page from swap or allocate a new one
  *
@@ -1258,6 +1554,10 @@ repeat:
 		if (error)
 			goto failed;
 		radix_tree_preload_end();
+		/* a whole empty block may be filled with a huge extent */
+		if (sgp != SGP_READ && !prealloc_page &&
+		    !shmem_huge_populate(inode, idx, sgp, NULL))
+			goto repeat;
 		if (sgp != SGP_READ && !prealloc_page) {
 			/* We don't care if this fails */
 			prealloc_page = shmem_alloc_page(gfp, info, idx);
@@ -1284,7 +1584,7 @@ repeat:
 
 	if (swap.val) {
 		/* Look it up and read it in.. */
-		swappage = lookup_swap_cache(swap);
+		swappage = lookup_swap_cache(swap, NULL, 0);
 		if (!swappage) {
 			shmem_swp_unmap(entry);
 			/* here we actually do the io */
@@ -1522,6 +1822,150 @@ static int shmem_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	return ret | VM_FAULT_LOCKED;
 }
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/*
+ * Map a whole huge extent of the pagecache with one pmd, populating the
+ * block first if it is still empty.  Anything short of an uptodate,
+ * naturally aligned and physically contiguous block falls back to
+ * ->fault() and small ptes.
+ */
+static int shmem_pmd_fault(struct vm_area_struct *vma, unsigned long address,
+			   pmd_t *pmd, unsigned int flags)
+{
+	struct inode *inode = vma->vm_file->f_path.dentry->d_inode;
+	struct address_space *mapping = inode->i_mapping;
+	unsigned long haddr = address & HPAGE_PMD_MASK;
+	struct page *pages[PAGEVEC_SIZE];
+	struct page *page;
+	pgoff_t pgoff;
+	int i, j, nr, locked = 0;
+	int ret = VM_FAULT_FALLBACK;
+
+	if (haddr < vma->vm_start || haddr + HPAGE_PMD_SIZE > vma->vm_end)
+		return VM_FAULT_FALLBACK;
+	pgoff = ((haddr - vma->vm_start) >> PAGE_SHIFT) + vma->vm_pgoff;
+	if (pgoff & (HPAGE_PMD_NR - 1))
+		return VM_FAULT_FALLBACK;
+	if (!shmem_huge_vma(vma) || !shmem_huge_allowed(inode, pgoff, vma))
+		return VM_FAULT_FALLBACK;
+	if (unlikely(khugepaged_enter_vma_merge(vma)))
+		return VM_FAULT_OOM;
+	if (((loff_t)(pgoff + HPAGE_PMD_NR) << PAGE_CACHE_SHIFT) >
+	    i_size_read(inode))
+		return VM_FAULT_FALLBACK;
+
+	page = find_get_page(mapping, pgoff);
+	if (!page) {
+		if (shmem_huge_populate(inode, pgoff,
+				(flags & FAULT_FLAG_WRITE) ? SGP_DIRTY : SGP_CACHE,
+				vma))
+			return VM_FAULT_FALLBACK;
+		page = find_get_page(mapping, pgoff);
+		if (!page)
+			return VM_FAULT_FALLBACK;
+	}
+	if (page_to_pfn(page) & (HPAGE_PMD_NR - 1)) {
+		page_cache_release(page);
+		return VM_FAULT_FALLBACK;
+	}
+
+	/* the first page is already held: collect references on the rest */
+	for (i = 1; i < HPAGE_PMD_NR; ) {
+		nr = find_get_pages_contig(mapping, pgoff + i,
+				min_t(int, PAGEVEC_SIZE, HPAGE_PMD_NR - i), pages);
+		for (j = 0; j < nr && pages[j] == page + i; j++)
+			i++;
+		if (!nr || j < nr) {
+			while (j < nr)
+				page_cache_release(pages[j++]);
+			break;
+		}
+	}
+	if (i < HPAGE_PMD_NR)
+		goto release;
+
+	for (locked = 0; locked < HPAGE_PMD_NR; locked++) {
+		struct page *p = page + locked;
+
+		if (!trylock_page(p))
+			break;
+		if (p->mapping != mapping || !PageUptodate(p)) {
+			unlock_page(p);
+			break;
+		}
+	}
+	if (locked == HPAGE_PMD_NR &&
+	    !do_set_huge_pmd_file(vma, haddr, pmd, page, flags)) {
+		/* the references are now held by the pmd */
+		i = 0;
+		ret = VM_FAULT_NOPAGE;
+	}
+	while (locked)
+		unlock_page(page + --locked);
+release:
+	while (i)
+		page_cache_release(page + --i);
+	return ret;
+}
+
+unsigned long shmem_get_unmapped_area(struct file *file,
+				      unsigned long uaddr, unsigned long len,
+				      unsigned long pgoff, unsigned long flags)
+{
+	unsigned long addr, offset;
+	unsigned long inflated_len, inflated_addr, inflated_offset;
+
+	if (len > TASK_SIZE)
+		return -ENOMEM;
+
+	addr = current->mm->get_unmapped_area(file, uaddr, len, pgoff, flags);
+	if (IS_ERR_VALUE(addr) || (addr & ~PAGE_MASK) ||
+	    addr > TASK_SIZE - len)
+		return addr;
+
+	/*
+	 * Leave hints, fixed mappings and anything that can't hold a
+	 * huge pmd alone.
+	 */
+	if (uaddr || (flags & MAP_FIXED) || len < HPAGE_PMD_SIZE)
+		return addr;
+	if (shmem_huge == SHMEM_HUGE_DENY)
+		return addr;
+	if (shmem_huge != SHMEM_HUGE_FORCE &&
+	    SHMEM_SB(file->f_path.dentry->d_inode->i_sb)->huge ==
+	    SHMEM_HUGE_NEVER)
+		return addr;
+
+	/*
+	 * Align the address to the file offset modulo HPAGE_PMD_SIZE, by
+	 * asking for a bigger area and picking the right place inside it.
+	 */
+	offset = (pgoff << PAGE_SHIFT) & (HPAGE_PMD_SIZE - 1);
+	if (offset && offset + len < 2 * HPAGE_PMD_SIZE)
+		return addr;
+	if ((addr & (HPAGE_PMD_SIZE - 1)) == offset)
+		return addr;
+
+	inflated_len = len + HPAGE_PMD_SIZE - PAGE_SIZE;
+	if (inflated_len > TASK_SIZE || inflated_len < len)
+		return addr;
+
+	inflated_addr = current->mm->get_unmapped_area(NULL, 0, inflated_len,
+						       0, flags);
+	if (IS_ERR_VALUE(inflated_addr) || (inflated_addr & ~PAGE_MASK))
+		return addr;
+
+	inflated_offset = inflated_addr & (HPAGE_PMD_SIZE - 1);
+	inflated_addr += offset - inflated_offset;
+	if (inflated_offset > offset)
+		inflated_addr += HPAGE_PMD_SIZE;
+
+	if (inflated_addr > TASK_SIZE - len)
+		return addr;
+	return inflated_addr;
+}
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
 #ifdef CONFIG_NUMA
 static int shmem_set_policy(struct vm_area_struct *vma, struct mempolicy *new)
 {
@@ -2250,6 +2694,17 @@ static int shmem_parse_options(char *options, struct shmem_sb_info *sbinfo,
 		} else if (!strcmp(this_char,"mpol")) {
 			if (mpol_parse_str(value, &sbinfo->mpol, 1))
 				goto bad_val;
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+		} else if (!strcmp(this_char, "huge")) {
+			int huge;
+			huge = shmem_parse_huge(value);
+			if (huge < 0)
+				goto bad_val;
+			if (!has_transparent_hugepage() &&
+			    huge != SHMEM_HUGE_NEVER)
+				goto bad_val;
+			sbinfo->huge = huge;
+#endif
 		} else {
 			printk(KERN_ERR "tmpfs: Bad mount option %s\n",
 			       this_char);
@@ -2296,6 +2751,7 @@ static int shmem_remount_fs(struct super_block *sb, int *flags, char *data)
 	sbinfo->max_blocks  = config.max_blocks;
 	sbinfo->max_inodes  = config.max_inodes;
 	sbinfo->free_inodes = config.max_inodes - inodes;
+	sbinfo->huge        = config.huge;
 
 	mpol_put(sbinfo->mpol);
 	sbinfo->mpol        = config.mpol;	/* transfers initial ref */
@@ -2319,6 +2775,11 @@ static int shmem_show_options(struct seq_file *seq, struct vfsmount *vfs)
 		seq_printf(seq, ",uid=%u", sbinfo->uid);
 	if (sbinfo->gid != 0)
 		seq_printf(seq, ",gid=%u", sbinfo->gid);
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	/* Rightly or wrongly, show huge mount option unmasked by shmem_huge */
+	if (sbinfo->huge)
+		seq_printf(seq, ",huge=%s", shmem_format_huge(sbinfo->huge));
+#endif
 	shmem_show_mpol(seq, sbinfo->mpol);
 	return 0;
 }
@@ -2442,7 +2903,7 @@ static int init_inodecache(void)
 {
 	shmem_inode_cachep = kmem_cache_create("shmem_inode_cache",
 				sizeof(struct shmem_inode_info),
-				0, SLAB_PANIC, init_once);
+				0, SLAB_PANIC|SLAB_ACCOUNT, init_once);
 	return 0;
 }
 
@@ -2465,6 +2926,9 @@ static const struct address_space_operations shmem_aops = {
 
 static const struct file_operations shmem_file_operations = {
 	.mmap		= shmem_mmap,
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	.get_unmapped_area = shmem_get_unmapped_area,
+#endif
 #ifdef CONFIG_TMPFS
 	.llseek		= generic_file_llseek,
 	.read		= do_sync_read,
@@ -2538,6 +3002,9 @@ static const struct super_operations shmem_ops = {
 
 static const struct vm_operations_struct shmem_vm_ops = {
 	.fault		= shmem_fault,
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	.pmd_fault	= shmem_pmd_fault,
+#endif
 #ifdef CONFIG_NUMA
 	.set_policy     = shmem_set_policy,
 	.get_policy     = shmem_get_policy,
@@ -2558,6 +3025,62 @@ static struct file_system_type tmpfs_fs_type = {
 	.kill_sb	= kill_litter_super,
 };
 
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) && defined(CONFIG_SYSFS)
+static ssize_t shmem_enabled_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	int values[] = {
+		SHMEM_HUGE_ALWAYS,
+		SHMEM_HUGE_WITHIN_SIZE,
+		SHMEM_HUGE_ADVISE,
+		SHMEM_HUGE_NEVER,
+		SHMEM_HUGE_DENY,
+		SHMEM_HUGE_FORCE,
+	};
+	int i, count;
+
+	for (i = 0, count = 0; i < ARRAY_SIZE(values); i++) {
+		const char *fmt = shmem_huge == values[i] ? "[%s] " : "%s ";
+
+		count += sprintf(buf + count, fmt,
+				 shmem_format_huge(values[i]));
+	}
+	buf[count - 1] = '\n';
+	return count;
+}
+
+static ssize_t shmem_enabled_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	char tmp[16];
+	int huge;
+
+	if (count + 1 > sizeof(tmp))
+		return -EINVAL;
+	memcpy(tmp, buf, count);
+	tmp[count] = '\0';
+	if (count && tmp[count - 1] == '\n')
+		tmp[count - 1] = '\0';
+
+	huge = shmem_parse_huge(tmp);
+	if (huge == -EINVAL)
+		return -EINVAL;
+	if (!has_transparent_hugepage() &&
+	    huge != SHMEM_HUGE_NEVER && huge != SHMEM_HUGE_DENY)
+		return -EINVAL;
+
+	shmem_huge = huge;
+	/* the internal mount backs SysV shm and shared anonymous memory */
+	if (shmem_huge >= SHMEM_HUGE_NEVER && !IS_ERR_OR_NULL(shm_mnt))
+		SHMEM_SB(shm_mnt->mnt_sb)->huge = shmem_huge;
+	return count;
+}
+
+struct kobj_attribute shmem_enabled_attr =
+	__ATTR(shmem_enabled, 0644, shmem_enabled_show, shmem_enabled_store);
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE && CONFIG_SYSFS */
+
 int __init init_tmpfs(void)
 {
 	int error;
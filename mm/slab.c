@@ -115,6 +115,7 @@
 #include	<linux/debugobjects.h>
 #include	<linux/kmemcheck.h>
 #include	<linux/memory.h>
+#include	<linux/memcontrol.h>
 
 #include	<asm/cacheflush.h>
 #include	<asm/tlbflush.h>
@@ -156,13 +157,15 @@
 			 SLAB_STORE_USER | \
 			 SLAB_RECLAIM_ACCOUNT | SLAB_PANIC | \
 			 SLAB_DESTROY_BY_RCU | SLAB_MEM_SPREAD | \
-			 SLAB_DEBUG_OBJECTS | SLAB_NOLEAKTRACE | SLAB_NOTRACK)
+			 SLAB_DEBUG_OBJECTS | SLAB_NOLEAKTRACE | SLAB_NOTRACK | \
+			 SLAB_ACCOUNT)
 #else
 # define CREATE_MASK	(SLAB_HWCACHE_ALIGN | \
 			 SLAB_CACHE_DMA | \
 			 SLAB_RECLAIM_ACCOUNT | SLAB_PANIC | \
 			 SLAB_DESTROY_BY_RCU | SLAB_MEM_SPREAD | \
-			 SLAB_DEBUG_OBJECTS | SLAB_NOLEAKTRACE | SLAB_NOTRACK)
+			 SLAB_DEBUG_OBJECTS | SLAB_NOLEAKTRACE | SLAB_NOTRACK | \
+			 SLAB_ACCOUNT)
 #endif
 
 /*
@@ -1696,6 +1699,12 @@ static void *kmem_getpages(struct kmem_cache *cachep, gfp_t flags, int nodeid)
 	if (!page)
 		return NULL;
 
+	if ((cachep->flags & SLAB_ACCOUNT) &&
+	    mem_cgroup_charge_slab(page, cachep->gfporder, flags)) {
+		__free_pages(page, cachep->gfporder);
+		return NULL;
+	}
+
 	nr_pages = (1 << cachep->gfporder);
 	if (cachep->flags & SLAB_RECLAIM_ACCOUNT)
 		add_zone_page_state(page_zone(page),
@@ -1729,6 +1738,9 @@ static void kmem_freepages(struct kmem_cache *cachep, void *addr)
 
 	kmemcheck_free_shadow(page, cachep->gfporder);
 
+	if (cachep->flags & SLAB_ACCOUNT)
+		mem_cgroup_uncharge_slab(page, cachep->gfporder);
+
 	if (cachep->flags & SLAB_RECLAIM_ACCOUNT)
 		sub_zone_page_state(page_zone(page),
 				NR_SLAB_RECLAIMABLE, nr_freed);
@@ -3806,6 +3818,92 @@ void kmem_cache_free(struct kmem_cache *cachep, void *objp)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+/**
+ * kmem_cache_alloc_bulk - Allocate several objects
+ * @cachep: The cache to allocate from.
+ * @flags: See kmalloc().
+ * @size: Number of objects to allocate.
+ * @p: Array receiving the objects.
+ *
+ * Allocate @size objects from this cache, taking them from the per cpu
+ * array cache in a single interrupt disabled section.  Either all objects
+ * are allocated and @size is returned, or none are and 0 is returned.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *cachep, gfp_t flags, size_t size,
+			  void **p)
+{
+	unsigned long save_flags;
+	size_t i, nr;
+
+	flags &= gfp_allowed_mask;
+
+	lockdep_trace_alloc(flags);
+
+	if (slab_should_failslab(cachep, flags))
+		return 0;
+
+	cache_alloc_debugcheck_before(cachep, flags);
+	local_irq_save(save_flags);
+	for (nr = 0; nr < size; nr++) {
+		p[nr] = __do_cache_alloc(cachep, flags);
+		if (unlikely(!p[nr]))
+			break;
+	}
+	local_irq_restore(save_flags);
+
+	for (i = 0; i < nr; i++) {
+		void *objp;
+
+		objp = cache_alloc_debugcheck_after(cachep, flags, p[i],
+						    __builtin_return_address(0));
+		kmemleak_alloc_recursive(objp, obj_size(cachep), 1,
+					 cachep->flags, flags);
+		kmemcheck_slab_alloc(cachep, flags, objp, obj_size(cachep));
+		if (unlikely(flags & __GFP_ZERO))
+			memset(objp, 0, obj_size(cachep));
+		trace_kmem_cache_alloc(_RET_IP_, objp, obj_size(cachep),
+				       cachep->buffer_size, flags);
+		p[i] = objp;
+	}
+
+	if (unlikely(nr < size)) {
+		kmem_cache_free_bulk(cachep, nr, p);
+		return 0;
+	}
+	return size;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
+/**
+ * kmem_cache_free_bulk - Deallocate several objects
+ * @cachep: The cache the allocations were from.
+ * @size: Number of objects in @p.
+ * @p: The previously allocated objects.
+ *
+ * Free @size objects back to this cache in a single interrupt
+ * disabled section.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *cachep, size_t size, void **p)
+{
+	unsigned long flags;
+	size_t i;
+
+	local_irq_save(flags);
+	for (i = 0; i < size; i++) {
+		void *objp = p[i];
+
+		debug_check_no_locks_freed(objp, obj_size(cachep));
+		if (!(cachep->flags & SLAB_DEBUG_OBJECTS))
+			debug_check_no_obj_freed(objp, obj_size(cachep));
+		__cache_free(cachep, objp);
+	}
+	local_irq_restore(flags);
+
+	for (i = 0; i < size; i++)
+		trace_kmem_cache_free(_RET_IP_, p[i]);
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
 /**
  * kfree - free previously allocated memory
  * @objp: pointer returned by kmalloc.
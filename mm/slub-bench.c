@@ -0,0 +1,272 @@
+/*
+ * mm/slub-bench.c
+ *
+ * Microbenchmark for the SLUB allocation and free fastpaths.
+ *
+ * The module runs a few timing loops when it is loaded, prints the
+ * average cost per operation in cycles and then refuses to stay loaded.
+ *
+ * Two groups of tests are run:
+ *
+ *  - the real allocator, through kmem_cache_alloc()/kmem_cache_free() on
+ *    a private cache, using whatever fastpath this kernel was built with;
+ *
+ *  - a model of the per cpu freelist that pops and pushes objects once
+ *    with interrupts disabled around the update (the classic fastpath)
+ *    and once with a transaction id and irqsafe_cpu_cmpxchg_double()
+ *    (the lockless fastpath), so the two can be compared on the same
+ *    kernel and the same hardware.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/irqflags.h>
+#include <linux/timex.h>
+
+static unsigned int iterations = 100000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Number of operations per test");
+
+static unsigned int size = 64;
+module_param(size, uint, 0444);
+MODULE_PARM_DESC(size, "Object size of the test cache");
+
+static unsigned int batch = 256;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Objects held at once by the batched test");
+
+#ifdef CONFIG_CMPXCHG_LOCAL
+#define SLUB_FASTPATH	"cmpxchg_double"
+#else
+#define SLUB_FASTPATH	"irq-off"
+#endif
+
+/* Number of objects on each cpu's list in the freelist model */
+#define BENCH_OBJS	64
+
+struct bench_cpu {
+	void **freelist;
+	unsigned long tid;
+};
+
+static struct bench_cpu __percpu *bench_cpu;
+static void ***bench_chunks;
+
+static void bench_report(const char *test, cycles_t cycles, unsigned int ops)
+{
+	printk(KERN_INFO "slub_bench: %-24s %10u ops %6lu cycles/op\n",
+	       test, ops, ops ? (unsigned long)(cycles / ops) : 0UL);
+}
+
+static void *bench_pop_irq(void)
+{
+	struct bench_cpu *c;
+	void **object;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	c = __this_cpu_ptr(bench_cpu);
+	object = c->freelist;
+	if (object)
+		c->freelist = *object;
+	local_irq_restore(flags);
+
+	return object;
+}
+
+static void bench_push_irq(void **object)
+{
+	struct bench_cpu *c;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	c = __this_cpu_ptr(bench_cpu);
+	*object = c->freelist;
+	c->freelist = object;
+	local_irq_restore(flags);
+}
+
+static void *bench_pop_cmpxchg(void)
+{
+	struct bench_cpu *c;
+	void **object;
+	unsigned long tid;
+
+redo:
+	c = __this_cpu_ptr(bench_cpu);
+	tid = c->tid;
+	barrier();
+	object = c->freelist;
+	if (!object)
+		return NULL;
+
+	if (!irqsafe_cpu_cmpxchg_double(bench_cpu->freelist, bench_cpu->tid,
+					object, tid, *object, tid + 1))
+		goto redo;
+
+	return object;
+}
+
+static void bench_push_cmpxchg(void **object)
+{
+	struct bench_cpu *c;
+	unsigned long tid;
+
+redo:
+	c = __this_cpu_ptr(bench_cpu);
+	tid = c->tid;
+	barrier();
+	*object = c->freelist;
+
+	if (!irqsafe_cpu_cmpxchg_double(bench_cpu->freelist, bench_cpu->tid,
+					*object, tid, object, tid + 1))
+		goto redo;
+}
+
+static void bench_model_exit(void)
+{
+	int cpu;
+
+	/*
+	 * Objects wander between the cpu lists while the model runs, so
+	 * free the chunks they were carved from instead of the lists.
+	 */
+	if (bench_chunks) {
+		for_each_possible_cpu(cpu)
+			kfree(bench_chunks[cpu]);
+		kfree(bench_chunks);
+		bench_chunks = NULL;
+	}
+	free_percpu(bench_cpu);
+	bench_cpu = NULL;
+}
+
+static int __init bench_model_init(void)
+{
+	int cpu;
+	int i;
+
+	bench_cpu = __alloc_percpu(sizeof(struct bench_cpu),
+				   2 * sizeof(void *));
+	bench_chunks = kcalloc(nr_cpu_ids, sizeof(void **), GFP_KERNEL);
+	if (!bench_cpu || !bench_chunks)
+		goto nomem;
+
+	for_each_possible_cpu(cpu) {
+		struct bench_cpu *c = per_cpu_ptr(bench_cpu, cpu);
+		void **objs;
+
+		objs = kmalloc(BENCH_OBJS * sizeof(void *), GFP_KERNEL);
+		if (!objs)
+			goto nomem;
+		bench_chunks[cpu] = objs;
+
+		for (i = 0; i < BENCH_OBJS - 1; i++)
+			objs[i] = &objs[i + 1];
+		objs[BENCH_OBJS - 1] = NULL;
+
+		c->freelist = objs;
+		c->tid = 0;
+	}
+	return 0;
+
+nomem:
+	bench_model_exit();
+	return -ENOMEM;
+}
+
+static void bench_model(void)
+{
+	cycles_t start;
+	unsigned int i;
+	void *object;
+
+	start = get_cycles();
+	for (i = 0; i < iterations; i++) {
+		object = bench_pop_irq();
+		if (object)
+			bench_push_irq(object);
+	}
+	bench_report("freelist irq-off", get_cycles() - start, iterations);
+
+	start = get_cycles();
+	for (i = 0; i < iterations; i++) {
+		object = bench_pop_cmpxchg();
+		if (object)
+			bench_push_cmpxchg(object);
+	}
+	bench_report("freelist cmpxchg_double", get_cycles() - start,
+		     iterations);
+}
+
+static void bench_cache(struct kmem_cache *s)
+{
+	void **objs;
+	cycles_t start;
+	unsigned int i, j, n, ops;
+
+	start = get_cycles();
+	for (i = 0; i < iterations; i++) {
+		void *object = kmem_cache_alloc(s, GFP_KERNEL);
+
+		if (object)
+			kmem_cache_free(s, object);
+	}
+	bench_report("alloc/free pair", get_cycles() - start, iterations);
+
+	objs = kmalloc(batch * sizeof(void *), GFP_KERNEL);
+	if (!objs)
+		return;
+
+	ops = 0;
+	start = get_cycles();
+	for (i = 0; i < iterations; i += batch) {
+		n = min(batch, iterations - i);
+		for (j = 0; j < n; j++)
+			objs[j] = kmem_cache_alloc(s, GFP_KERNEL);
+		for (j = 0; j < n; j++)
+			if (objs[j])
+				kmem_cache_free(s, objs[j]);
+		ops += n;
+	}
+	bench_report("alloc/free batched", get_cycles() - start, ops);
+
+	kfree(objs);
+}
+
+static int __init slub_bench_init(void)
+{
+	struct kmem_cache *s;
+
+	if (!iterations || !size || !batch)
+		return -EINVAL;
+
+	printk(KERN_INFO "slub_bench: %u iterations, %u byte objects, "
+	       "%s fastpath\n", iterations, size, SLUB_FASTPATH);
+
+	s = kmem_cache_create("slub_bench", size, 0, 0, NULL);
+	if (!s)
+		return -ENOMEM;
+	bench_cache(s);
+	kmem_cache_destroy(s);
+
+	if (bench_model_init())
+		return -ENOMEM;
+	bench_model();
+	bench_model_exit();
+
+	/* Fail so that the module is unloaded right away */
+	return -EAGAIN;
+}
+module_init(slub_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SLUB fastpath microbenchmark");
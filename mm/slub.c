@@ -27,6 +27,8 @@
 #include <linux/memory.h>
 #include <linux/math64.h>
 #include <linux/fault-inject.h>
+#include <linux/memcontrol.h>
+#include <linux/uaccess.h>
 
 #include <trace/events/kmem.h>
 
@@ -81,6 +83,12 @@
  * We track full slabs for debugging purposes though because otherwise we
  * cannot scan all objects.
  *
+ * In addition each processor keeps a few frozen slabs with free objects on
+ * a per cpu partial list. A deactivated cpu slab goes there first and the
+ * next cpu slab is taken from there first, so that in the common case
+ * neither operation needs the list_lock. The per cpu partial list is
+ * moved to the node partial lists when it overflows or is flushed.
+ *
  * Slabs are freed when they become empty. Teardown and setup is
  * minimal so we rely on the page allocators per cpu caches for
  * fast frees and allocs.
@@ -162,7 +170,7 @@ static inline int kmem_cache_debug(struct kmem_cache *s)
 		SLAB_FAILSLAB)
 
 #define SLUB_MERGE_SAME (SLAB_DEBUG_FREE | SLAB_RECLAIM_ACCOUNT | \
-		SLAB_CACHE_DMA | SLAB_NOTRACK)
+		SLAB_CACHE_DMA | SLAB_NOTRACK | SLAB_ACCOUNT)
 
 #define OO_SHIFT	16
 #define OO_MASK		((1 << OO_SHIFT) - 1)
@@ -261,6 +269,24 @@ static inline void *get_freepointer(struct kmem_cache *s, void *object)
 	return *(void **)(object + s->offset);
 }
 
+/*
+ * The lockless allocation fastpath may follow a free pointer of an object
+ * that another context has already allocated and, with DEBUG_PAGEALLOC,
+ * whose slab page has been unmapped. The cmpxchg will fail in that case,
+ * but the read itself must not fault.
+ */
+static inline void *get_freepointer_safe(struct kmem_cache *s, void *object)
+{
+	void *p;
+
+#ifdef CONFIG_DEBUG_PAGEALLOC
+	probe_kernel_read(&p, (void **)(object + s->offset), sizeof(p));
+#else
+	p = get_freepointer(s, object);
+#endif
+	return p;
+}
+
 static inline void set_freepointer(struct kmem_cache *s, void *object, void *fp)
 {
 	*(void **)(object + s->offset) = fp;
@@ -807,14 +833,24 @@ static inline void slab_post_alloc_hook(struct kmem_cache *s, gfp_t flags, void
 static inline void slab_free_hook(struct kmem_cache *s, void *x)
 {
 	kmemleak_free_recursive(x, s->flags);
-}
 
-static inline void slab_free_hook_irq(struct kmem_cache *s, void *object)
-{
-	kmemcheck_slab_free(s, object, s->objsize);
-	debug_check_no_locks_freed(object, s->objsize);
+	/*
+	 * The fast path may no longer run with interrupts disabled, so the
+	 * debug hooks that expect them off get a short irq-off section
+	 * of their own.
+	 */
+#if defined(CONFIG_KMEMCHECK) || defined(CONFIG_LOCKDEP)
+	{
+		unsigned long flags;
+
+		local_irq_save(flags);
+		kmemcheck_slab_free(s, x, s->objsize);
+		debug_check_no_locks_freed(x, s->objsize);
+		local_irq_restore(flags);
+	}
+#endif
 	if (!(s->flags & SLAB_DEBUG_OBJECTS))
-		debug_check_no_obj_freed(object, s->objsize);
+		debug_check_no_obj_freed(x, s->objsize);
 }
 
 /*
@@ -1101,9 +1137,6 @@ static inline void slab_post_alloc_hook(struct kmem_cache *s, gfp_t flags,
 
 static inline void slab_free_hook(struct kmem_cache *s, void *x) {}
 
-static inline void slab_free_hook_irq(struct kmem_cache *s,
-		void *object) {}
-
 #endif /* CONFIG_SLUB_DEBUG */
 
 /*
@@ -1150,6 +1183,12 @@ static struct page *allocate_slab(struct kmem_cache *s, gfp_t flags, int node)
 		stat(s, ORDER_FALLBACK);
 	}
 
+	if ((s->flags & SLAB_ACCOUNT) &&
+	    mem_cgroup_charge_slab(page, oo_order(oo), flags)) {
+		__free_pages(page, oo_order(oo));
+		return NULL;
+	}
+
 	if (kmemcheck_enabled
 		&& !(s->flags & (SLAB_NOTRACK | DEBUG_DEFAULT_FLAGS))) {
 		int pages = 1 << oo_order(oo);
@@ -1237,6 +1276,9 @@ static void __free_slab(struct kmem_cache *s, struct page *page)
 
 	kmemcheck_free_shadow(page, compound_order(page));
 
+	if (s->flags & SLAB_ACCOUNT)
+		mem_cgroup_uncharge_slab(page, order);
+
 	mod_zone_page_state(page_zone(page),
 		(s->flags & SLAB_RECLAIM_ACCOUNT) ?
 		NR_SLAB_RECLAIMABLE : NR_SLAB_UNRECLAIMABLE,
@@ -1297,18 +1339,40 @@ static __always_inline int slab_trylock(struct page *page)
 	return rc;
 }
 
+/*
+ * Take the node list_lock. With statistics enabled every acquisition and
+ * every acquisition that had to wait for another processor is counted.
+ */
+static inline void lock_node_list(struct kmem_cache *s,
+				struct kmem_cache_node *n)
+{
+#ifdef CONFIG_SLUB_STATS
+	stat(s, LIST_LOCK);
+	if (spin_trylock(&n->list_lock))
+		return;
+	stat(s, LIST_LOCK_CONTENDED);
+#endif
+	spin_lock(&n->list_lock);
+}
+
 /*
  * Management of partially allocated slabs
  */
-static void add_partial(struct kmem_cache_node *n,
+static inline void __add_partial(struct kmem_cache_node *n,
 				struct page *page, int tail)
 {
-	spin_lock(&n->list_lock);
 	n->nr_partial++;
 	if (tail)
 		list_add_tail(&page->lru, &n->partial);
 	else
 		list_add(&page->lru, &n->partial);
+}
+
+static void add_partial(struct kmem_cache *s, struct kmem_cache_node *n,
+				struct page *page, int tail)
+{
+	lock_node_list(s, n);
+	__add_partial(n, page, tail);
 	spin_unlock(&n->list_lock);
 }
 
@@ -1323,7 +1387,7 @@ static void remove_partial(struct kmem_cache *s, struct page *page)
 {
 	struct kmem_cache_node *n = get_node(s, page_to_nid(page));
 
-	spin_lock(&n->list_lock);
+	lock_node_list(s, n);
 	__remove_partial(n, page);
 	spin_unlock(&n->list_lock);
 }
@@ -1347,7 +1411,8 @@ static inline int lock_and_freeze_slab(struct kmem_cache_node *n,
 /*
  * Try to allocate a partial slab from a specific node.
  */
-static struct page *get_partial_node(struct kmem_cache_node *n)
+static struct page *get_partial_node(struct kmem_cache *s,
+					struct kmem_cache_node *n)
 {
 	struct page *page;
 
@@ -1360,7 +1425,7 @@ static struct page *get_partial_node(struct kmem_cache_node *n)
 	if (!n || !n->nr_partial)
 		return NULL;
 
-	spin_lock(&n->list_lock);
+	lock_node_list(s, n);
 	list_for_each_entry(page, &n->partial, lru)
 		if (lock_and_freeze_slab(n, page))
 			goto out;
@@ -1413,7 +1478,7 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 
 		if (n && cpuset_zone_allowed_hardwall(zone, flags) &&
 				n->nr_partial > s->min_partial) {
-			page = get_partial_node(n);
+			page = get_partial_node(s, n);
 			if (page) {
 				put_mems_allowed();
 				return page;
@@ -1433,7 +1498,7 @@ static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node)
 	struct page *page;
 	int searchnode = (node == NUMA_NO_NODE) ? numa_node_id() : node;
 
-	page = get_partial_node(get_node(s, searchnode));
+	page = get_partial_node(s, get_node(s, searchnode));
 	if (page || node != -1)
 		return page;
 
@@ -1456,7 +1521,7 @@ static void unfreeze_slab(struct kmem_cache *s, struct page *page, int tail)
 	if (page->inuse) {
 
 		if (page->freelist) {
-			add_partial(n, page, tail);
+			add_partial(s, n, page, tail);
 			stat(s, tail ? DEACTIVATE_TO_TAIL : DEACTIVATE_TO_HEAD);
 		} else {
 			stat(s, DEACTIVATE_FULL);
@@ -1477,7 +1542,7 @@ static void unfreeze_slab(struct kmem_cache *s, struct page *page, int tail)
 			 * kmem_cache_shrink can reclaim any empty slabs from
 			 * the partial list.
 			 */
-			add_partial(n, page, 1);
+			add_partial(s, n, page, 1);
 			slab_unlock(page);
 		} else {
 			slab_unlock(page);
@@ -1487,6 +1552,119 @@ static void unfreeze_slab(struct kmem_cache *s, struct page *page, int tail)
 	}
 }
 
+#ifdef CONFIG_CMPXCHG_LOCAL
+#ifdef CONFIG_PREEMPT
+/*
+ * Transaction ids start with the cpu number and are then incremented by
+ * a power of two at least as large as the number of cpus, so that a
+ * tid identifies both the cpu and the operation on its freelist.
+ */
+#define TID_STEP  roundup_pow_of_two(CONFIG_NR_CPUS)
+#else
+/*
+ * Without preemption the fastpath cannot migrate between reading the
+ * tid and the cmpxchg, so the tid only has to count operations.
+ */
+#define TID_STEP 1
+#endif
+
+static inline unsigned long next_tid(unsigned long tid)
+{
+	return tid + TID_STEP;
+}
+
+static inline unsigned int init_tid(int cpu)
+{
+	return cpu;
+}
+#endif
+
+static void init_kmem_cache_cpus(struct kmem_cache *s)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
+
+		INIT_LIST_HEAD(&c->partial);
+#ifdef CONFIG_CMPXCHG_LOCAL
+		c->tid = init_tid(cpu);
+#endif
+	}
+}
+
+/*
+ * Move all slabs on the per cpu partial list to the node partial lists.
+ *
+ * Must be called with interrupts disabled.
+ */
+static void unfreeze_partials(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct page *page, *t;
+
+	if (!c->nr_partial)
+		return;
+
+	list_for_each_entry_safe(page, t, &c->partial, lru) {
+		list_del(&page->lru);
+		slab_lock(page);
+		unfreeze_slab(s, page, 1);
+	}
+	c->nr_partial = 0;
+	stat(s, CPU_PARTIAL_DRAIN);
+}
+
+/*
+ * Keep a slab that is being deactivated frozen on the per cpu partial
+ * list if it still has free objects, instead of taking the list_lock to
+ * put it on the node partial list. If the per cpu list is full it is
+ * drained to the node lists first.
+ *
+ * Must be called with interrupts disabled and the slab locked. Returns 1
+ * with the slab unlocked if the slab was kept, 0 with the slab still
+ * locked otherwise.
+ */
+static int put_cpu_partial(struct kmem_cache *s, struct kmem_cache_cpu *c,
+				struct page *page)
+	__releases(bitlock)
+{
+	if (!s->cpu_partial || !page->freelist || kmem_cache_debug(s))
+		return 0;
+
+	slab_unlock(page);
+	if (c->nr_partial >= s->cpu_partial)
+		unfreeze_partials(s, c);
+
+	list_add(&page->lru, &c->partial);
+	c->nr_partial++;
+	stat(s, CPU_PARTIAL_FREE);
+	return 1;
+}
+
+/*
+ * Take a slab for the given node from the per cpu partial list and
+ * lock it. The slab is still frozen.
+ *
+ * Must be called with interrupts disabled.
+ */
+static struct page *get_cpu_partial(struct kmem_cache *s,
+				struct kmem_cache_cpu *c, int node)
+{
+	struct page *page;
+
+	list_for_each_entry(page, &c->partial, lru) {
+		if (node != NUMA_NO_NODE && page_to_nid(page) != node)
+			continue;
+
+		list_del(&page->lru);
+		c->nr_partial--;
+		slab_lock(page);
+		stat(s, CPU_PARTIAL_ALLOC);
+		return page;
+	}
+	return NULL;
+}
+
 /*
  * Remove the cpu slab
  */
@@ -1518,6 +1696,11 @@ static void deactivate_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 		page->inuse--;
 	}
 	c->page = NULL;
+#ifdef CONFIG_CMPXCHG_LOCAL
+	c->tid = next_tid(c->tid);
+#endif
+	if (put_cpu_partial(s, c, page))
+		return;
 	unfreeze_slab(s, page, tail);
 }
 
@@ -1537,8 +1720,12 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
-	if (likely(c && c->page))
-		flush_slab(s, c);
+	if (likely(c)) {
+		if (c->page)
+			flush_slab(s, c);
+
+		unfreeze_partials(s, c);
+	}
 }
 
 static void flush_cpu_slab(void *d)
@@ -1652,6 +1839,19 @@ static void *__slab_alloc(struct kmem_cache *s, gfp_t gfpflags, int node,
 {
 	void **object;
 	struct page *new;
+#ifdef CONFIG_CMPXCHG_LOCAL
+	unsigned long flags;
+
+	local_irq_save(flags);
+#ifdef CONFIG_PREEMPT
+	/*
+	 * We may have been preempted and rescheduled on a different
+	 * cpu before disabling interrupts. Need to reload cpu area
+	 * pointer.
+	 */
+	c = this_cpu_ptr(s->cpu_slab);
+#endif
+#endif
 
 	/* We handle __GFP_ZERO in the caller */
 	gfpflags &= ~__GFP_ZERO;
@@ -1678,6 +1878,10 @@ load_freelist:
 	c->node = page_to_nid(c->page);
 unlock_out:
 	slab_unlock(c->page);
+#ifdef CONFIG_CMPXCHG_LOCAL
+	c->tid = next_tid(c->tid);
+	local_irq_restore(flags);
+#endif
 	stat(s, ALLOC_SLOWPATH);
 	return object;
 
@@ -1685,6 +1889,12 @@ another_slab:
 	deactivate_slab(s, c);
 
 new_slab:
+	new = get_cpu_partial(s, c, node);
+	if (new) {
+		c->page = new;
+		goto load_freelist;
+	}
+
 	new = get_partial(s, gfpflags, node);
 	if (new) {
 		c->page = new;
@@ -1713,6 +1923,9 @@ new_slab:
 	}
 	if (!(gfpflags & __GFP_NOWARN) && printk_ratelimit())
 		slab_out_of_memory(s, gfpflags, node);
+#ifdef CONFIG_CMPXCHG_LOCAL
+	local_irq_restore(flags);
+#endif
 	return NULL;
 debug:
 	if (!alloc_debug_processing(s, c->page, object, addr))
@@ -1733,29 +1946,87 @@ debug:
  * If not then __slab_alloc is called for slow processing.
  *
  * Otherwise we can simply pick the next object from the lockless free list.
+ *
+ * With CONFIG_CMPXCHG_LOCAL the fastpath runs with interrupts and
+ * preemption enabled: the freelist head and the transaction id are
+ * replaced together by a cpu local cmpxchg_double, which only succeeds
+ * if nothing else touched this cpu's freelist since we looked at it
+ * and we are still running on the cpu we read the tid from.
  */
 static __always_inline void *slab_alloc(struct kmem_cache *s,
 		gfp_t gfpflags, int node, unsigned long addr)
 {
 	void **object;
 	struct kmem_cache_cpu *c;
+#ifdef CONFIG_CMPXCHG_LOCAL
+	unsigned long tid;
+#else
 	unsigned long flags;
+#endif
 
 	if (slab_pre_alloc_hook(s, gfpflags))
 		return NULL;
 
+#ifndef CONFIG_CMPXCHG_LOCAL
 	local_irq_save(flags);
+#else
+redo:
+#endif
+
+	/*
+	 * Must read kmem_cache cpu data via this cpu ptr. Preemption is
+	 * enabled. We may switch back and forth between cpus while
+	 * reading from one cpu area. That does not matter as long
+	 * as we end up on the original cpu again when doing the cmpxchg.
+	 */
 	c = __this_cpu_ptr(s->cpu_slab);
+
+#ifdef CONFIG_CMPXCHG_LOCAL
+	/*
+	 * The transaction ids are globally unique per cpu and per operation on
+	 * a per cpu queue. Thus they guarantee that the cmpxchg_double
+	 * occurs on the right processor and that there was no operation on the
+	 * linked list in between.
+	 */
+	tid = c->tid;
+	barrier();
+#endif
+
 	object = c->freelist;
 	if (unlikely(!object || !node_match(c, node)))
 
 		object = __slab_alloc(s, gfpflags, node, addr, c);
 
 	else {
+#ifdef CONFIG_CMPXCHG_LOCAL
+		/*
+		 * The cmpxchg does the following atomically (without lock
+		 * semantics!):
+		 * 1. Relocate first pointer to the current per cpu area.
+		 * 2. Verify that tid and freelist have not been changed.
+		 * 3. If they were not changed replace tid and freelist.
+		 *
+		 * Since this is without lock semantics the protection is only
+		 * against code executing on this cpu *not* from access by
+		 * other cpus.
+		 */
+		if (unlikely(!irqsafe_cpu_cmpxchg_double(
+				s->cpu_slab->freelist, s->cpu_slab->tid,
+				object, tid,
+				get_freepointer_safe(s, object), next_tid(tid)))) {
+
+			stat(s, CMPXCHG_DOUBLE_CPU_FAIL);
+			goto redo;
+		}
+#else
 		c->freelist = get_freepointer(s, object);
+#endif
 		stat(s, ALLOC_FASTPATH);
 	}
+
+#ifndef CONFIG_CMPXCHG_LOCAL
 	local_irq_restore(flags);
+#endif
 
 	if (unlikely(gfpflags & __GFP_ZERO) && object)
 		memset(object, 0, s->objsize);
@@ -1833,7 +2104,11 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 {
 	void *prior;
 	void **object = (void *)x;
+#ifdef CONFIG_CMPXCHG_LOCAL
+	unsigned long flags;
 
+	local_irq_save(flags);
+#endif
 	stat(s, FREE_SLOWPATH);
 	slab_lock(page);
 
@@ -1859,12 +2134,15 @@ checks_ok:
 	 * then add it.
 	 */
 	if (unlikely(!prior)) {
-		add_partial(get_node(s, page_to_nid(page)), page, 1);
+		add_partial(s, get_node(s, page_to_nid(page)), page, 1);
 		stat(s, FREE_ADD_PARTIAL);
 	}
 
 out_unlock:
 	slab_unlock(page);
+#ifdef CONFIG_CMPXCHG_LOCAL
+	local_irq_restore(flags);
+#endif
 	return;
 
 slab_empty:
@@ -1876,6 +2154,9 @@ slab_empty:
 		stat(s, FREE_REMOVE_PARTIAL);
 	}
 	slab_unlock(page);
+#ifdef CONFIG_CMPXCHG_LOCAL
+	local_irq_restore(flags);
+#endif
 	stat(s, FREE_SLAB);
 	discard_slab(s, page);
 	return;
@@ -1902,23 +2183,55 @@ static __always_inline void slab_free(struct kmem_cache *s,
 {
 	void **object = (void *)x;
 	struct kmem_cache_cpu *c;
+#ifdef CONFIG_CMPXCHG_LOCAL
+	unsigned long tid;
+#else
 	unsigned long flags;
+#endif
 
 	slab_free_hook(s, x);
 
+#ifndef CONFIG_CMPXCHG_LOCAL
 	local_irq_save(flags);
+#else
+redo:
+#endif
+
+	/*
+	 * Determine the current cpu's per cpu slab.
+	 * The cpu may change afterward. However that does not matter since
+	 * data is retrieved via this pointer. If we are on the same cpu
+	 * during the cmpxchg then the free will succeed.
+	 */
 	c = __this_cpu_ptr(s->cpu_slab);
 
-	slab_free_hook_irq(s, x);
+#ifdef CONFIG_CMPXCHG_LOCAL
+	tid = c->tid;
+	barrier();
+#endif
 
 	if (likely(page == c->page && c->node != NUMA_NO_NODE)) {
 		set_freepointer(s, object, c->freelist);
+
+#ifdef CONFIG_CMPXCHG_LOCAL
+		if (unlikely(!irqsafe_cpu_cmpxchg_double(
+				s->cpu_slab->freelist, s->cpu_slab->tid,
+				c->freelist, tid,
+				object, next_tid(tid)))) {
+
+			stat(s, CMPXCHG_DOUBLE_CPU_FAIL);
+			goto redo;
+		}
+#else
 		c->freelist = object;
+#endif
 		stat(s, FREE_FASTPATH);
 	} else
 		__slab_free(s, page, x, addr);
 
+#ifndef CONFIG_CMPXCHG_LOCAL
 	local_irq_restore(flags);
+#endif
 }
 
 void kmem_cache_free(struct kmem_cache *s, void *x)
@@ -1933,6 +2246,112 @@ void kmem_cache_free(struct kmem_cache *s, void *x)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+/*
+ * Bulk allocation and freeing.
+ *
+ * Objects are moved to or from the cpu freelist with interrupts disabled
+ * once for the whole batch instead of once per object. Objects that do
+ * not belong to the cpu slab, and refills of an exhausted cpu slab, go
+ * through the regular slowpaths, which may be entered with interrupts
+ * already disabled.
+ *
+ * Whenever the cpu freelist is changed here the transaction id is
+ * advanced so that a lockless fastpath interrupted on this cpu retries.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long flags;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		slab_free_hook(s, p[i]);
+
+	local_irq_save(flags);
+	c = __this_cpu_ptr(s->cpu_slab);
+	for (i = 0; i < size; i++) {
+		void **object = p[i];
+		struct page *page = virt_to_head_page(object);
+
+		if (likely(page == c->page && c->node != NUMA_NO_NODE)) {
+			set_freepointer(s, object, c->freelist);
+			c->freelist = object;
+			stat(s, FREE_FASTPATH);
+		} else
+			__slab_free(s, page, object, _RET_IP_);
+	}
+#ifdef CONFIG_CMPXCHG_LOCAL
+	c->tid = next_tid(c->tid);
+#endif
+	local_irq_restore(flags);
+
+	for (i = 0; i < size; i++)
+		trace_kmem_cache_free(_RET_IP_, p[i]);
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
+/*
+ * Returns @size if all objects were allocated. On failure the objects
+ * allocated so far are freed again and 0 is returned.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+			  void **p)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long irqflags;
+	size_t i;
+
+	if (slab_pre_alloc_hook(s, flags))
+		return 0;
+
+	local_irq_save(irqflags);
+	c = __this_cpu_ptr(s->cpu_slab);
+	for (i = 0; i < size; i++) {
+		void **object = c->freelist;
+
+		if (unlikely(!object)) {
+#ifdef CONFIG_CMPXCHG_LOCAL
+			c->tid = next_tid(c->tid);
+#endif
+			/*
+			 * __slab_alloc() may enable interrupts to grow the
+			 * cache, and we may come back on another cpu.
+			 */
+			p[i] = __slab_alloc(s, flags, NUMA_NO_NODE,
+					    _RET_IP_, c);
+			if (unlikely(!p[i]))
+				goto error;
+			c = __this_cpu_ptr(s->cpu_slab);
+			continue;
+		}
+		c->freelist = get_freepointer(s, object);
+		p[i] = object;
+		stat(s, ALLOC_FASTPATH);
+	}
+#ifdef CONFIG_CMPXCHG_LOCAL
+	c->tid = next_tid(c->tid);
+#endif
+	local_irq_restore(irqflags);
+
+	for (i = 0; i < size; i++) {
+		if (unlikely(flags & __GFP_ZERO))
+			memset(p[i], 0, s->objsize);
+		slab_post_alloc_hook(s, flags, p[i]);
+		trace_kmem_cache_alloc(_RET_IP_, p[i], s->objsize, s->size,
+				       flags);
+	}
+	return size;
+
+error:
+	local_irq_restore(irqflags);
+	size = i;
+	for (i = 0; i < size; i++)
+		slab_post_alloc_hook(s, flags, p[i]);
+	kmem_cache_free_bulk(s, size, p);
+	return 0;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
 /*
  * Object placement in a slab is made very easy because we always start at
  * offset 0. If we tune the size of the object to the alignment then we can
@@ -2110,9 +2529,24 @@ static inline int alloc_kmem_cache_cpus(struct kmem_cache *s)
 	BUILD_BUG_ON(PERCPU_DYNAMIC_EARLY_SIZE <
 			SLUB_PAGE_SHIFT * sizeof(struct kmem_cache_cpu));
 
+#ifdef CONFIG_CMPXCHG_LOCAL
+	/*
+	 * Must align to double word boundary for the double cmpxchg
+	 * instructions to work.
+	 */
+	s->cpu_slab = __alloc_percpu(sizeof(struct kmem_cache_cpu),
+				     2 * sizeof(void *));
+#else
+	/* Regular alignment is sufficient */
 	s->cpu_slab = alloc_percpu(struct kmem_cache_cpu);
+#endif
 
-	return s->cpu_slab != NULL;
+	if (!s->cpu_slab)
+		return 0;
+
+	init_kmem_cache_cpus(s);
+
+	return 1;
 }
 
 static struct kmem_cache *kmem_cache_node;
@@ -2162,7 +2596,9 @@ static void early_kmem_cache_node_alloc(int node)
 	 * the boot sequence, we still disable irqs.
 	 */
 	local_irq_save(flags);
-	add_partial(n, page, 0);
+	spin_lock(&n->list_lock);
+	__add_partial(n, page, 0);
+	spin_unlock(&n->list_lock);
 	local_irq_restore(flags);
 }
 
@@ -2370,6 +2806,24 @@ static int kmem_cache_open(struct kmem_cache *s,
 	 * list to avoid pounding the page allocator excessively.
 	 */
 	set_min_partial(s, ilog2(s->size));
+
+	/*
+	 * The number of frozen partial slabs each cpu may keep. Larger
+	 * objects have fewer objects per slab and are allocated less
+	 * often, so fewer slabs are kept for them. Debugging needs all
+	 * slabs on the node lists.
+	 */
+	if (kmem_cache_debug(s))
+		s->cpu_partial = 0;
+	else if (s->size >= PAGE_SIZE)
+		s->cpu_partial = 2;
+	else if (s->size >= 1024)
+		s->cpu_partial = 3;
+	else if (s->size >= 256)
+		s->cpu_partial = 4;
+	else
+		s->cpu_partial = 6;
+
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -3944,6 +4398,52 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(min_partial);
 
+static ssize_t cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	return sprintf(buf, "%d\n", s->cpu_partial);
+}
+
+static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
+				 size_t length)
+{
+	unsigned long nr;
+	int err;
+
+	err = strict_strtoul(buf, 10, &nr);
+	if (err)
+		return err;
+	if (nr > INT_MAX || (nr && kmem_cache_debug(s)))
+		return -EINVAL;
+
+	s->cpu_partial = nr;
+	flush_all(s);
+	return length;
+}
+SLAB_ATTR(cpu_partial);
+
+static ssize_t slabs_cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	int pages = 0;
+	int cpu;
+	int len;
+
+	for_each_online_cpu(cpu)
+		pages += per_cpu_ptr(s->cpu_slab, cpu)->nr_partial;
+
+	len = sprintf(buf, "%d", pages);
+
+#ifdef CONFIG_SMP
+	for_each_online_cpu(cpu) {
+		int nr = per_cpu_ptr(s->cpu_slab, cpu)->nr_partial;
+
+		if (nr && len < PAGE_SIZE - 20)
+			len += sprintf(buf + len, " C%d=%d", cpu, nr);
+	}
+#endif
+	return len + sprintf(buf + len, "\n");
+}
+SLAB_ATTR_RO(slabs_cpu_partial);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4284,6 +4784,12 @@ STAT_ATTR(DEACTIVATE_TO_HEAD, deactivate_to_head);
 STAT_ATTR(DEACTIVATE_TO_TAIL, deactivate_to_tail);
 STAT_ATTR(DEACTIVATE_REMOTE_FREES, deactivate_remote_frees);
 STAT_ATTR(ORDER_FALLBACK, order_fallback);
+STAT_ATTR(CMPXCHG_DOUBLE_CPU_FAIL, cmpxchg_double_cpu_fail);
+STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
+STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
+STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(LIST_LOCK, list_lock);
+STAT_ATTR(LIST_LOCK_CONTENDED, list_lock_contended);
 #endif
 
 static struct attribute *slab_attrs[] = {
@@ -4292,6 +4798,8 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+	&cpu_partial_attr.attr,
+	&slabs_cpu_partial_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -4340,6 +4848,12 @@ static struct attribute *slab_attrs[] = {
 	&deactivate_to_tail_attr.attr,
 	&deactivate_remote_frees_attr.attr,
 	&order_fallback_attr.attr,
+	&cmpxchg_double_cpu_fail_attr.attr,
+	&cpu_partial_alloc_attr.attr,
+	&cpu_partial_free_attr.attr,
+	&cpu_partial_drain_attr.attr,
+	&list_lock_attr.attr,
+	&list_lock_contended_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
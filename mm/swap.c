@@ -39,6 +39,7 @@ int page_cluster;
 
 static DEFINE_PER_CPU(struct pagevec[NR_LRU_LISTS], lru_add_pvecs);
 static DEFINE_PER_CPU(struct pagevec, lru_rotate_pvecs);
+static DEFINE_PER_CPU(struct pagevec, lru_deactivate_pvecs);
 
 /*
  * This path almost never happens for VM activity - pages are normally
@@ -199,8 +200,11 @@ static void pagevec_move_tail(struct pagevec *pvec)
 			spin_lock(&zone->lru_lock);
 		}
 		if (PageLRU(page) && !PageActive(page) && !PageUnevictable(page)) {
-			int lru = page_lru_base_type(page);
-			list_move_tail(&page->lru, &zone->lru[lru].list);
+			enum lru_list lru = page_lru_base_type(page);
+			struct lruvec *lruvec;
+
+			lruvec = mem_cgroup_lru_move_lists(zone, page, lru, lru);
+			list_move_tail(&page->lru, &lruvec->lists[lru]);
 			pgmoved++;
 		}
 	}
@@ -275,6 +279,71 @@ void activate_page(struct page *page)
 	spin_unlock_irq(&zone->lru_lock);
 }
 
+/*
+ * Move the pages to the tail of their inactive list, so that reclaim
+ * gets to them first, then drop the caller's refcount on them.
+ */
+static void pagevec_deactivate(struct pagevec *pvec)
+{
+	int i;
+	int pgmoved = 0;
+	struct zone *zone = NULL;
+
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		struct page *page = pvec->pages[i];
+		struct zone *pagezone = page_zone(page);
+		enum lru_list lru, to;
+		struct lruvec *lruvec;
+
+		if (pagezone != zone) {
+			if (zone)
+				spin_unlock_irq(&zone->lru_lock);
+			zone = pagezone;
+			spin_lock_irq(&zone->lru_lock);
+		}
+		if (!PageLRU(page) || PageUnevictable(page))
+			continue;
+
+		lru = page_lru(page);
+		to = page_lru_base_type(page);
+		if (PageActive(page)) {
+			ClearPageActive(page);
+			__dec_zone_state(zone, NR_LRU_BASE + lru);
+			__inc_zone_state(zone, NR_LRU_BASE + to);
+		}
+		ClearPageReferenced(page);
+		lruvec = mem_cgroup_lru_move_lists(zone, page, lru, to);
+		list_move_tail(&page->lru, &lruvec->lists[to]);
+		update_page_reclaim_stat(zone, page, page_is_file_cache(page), 0);
+		pgmoved++;
+	}
+	if (zone)
+		spin_unlock_irq(&zone->lru_lock);
+	__count_vm_events(PGDEACTIVATE, pgmoved);
+	release_pages(pvec->pages, pvec->nr, pvec->cold);
+	pagevec_reinit(pvec);
+}
+
+/**
+ * deactivate_page - queue a page for early reclaim
+ * @page: the page, which the caller holds a reference on
+ *
+ * The page is moved to the tail of its inactive list in batches.
+ */
+void deactivate_page(struct page *page)
+{
+	struct pagevec *pvec;
+
+	if (!PageLRU(page) || PageUnevictable(page))
+		return;
+
+	page_cache_get(page);
+	pvec = &get_cpu_var(lru_deactivate_pvecs);
+	if (!pagevec_add(pvec, page))
+		pagevec_deactivate(pvec);
+	put_cpu_var(lru_deactivate_pvecs);
+}
+
 /*
  * Mark a page as having seen activity.
  *
@@ -372,6 +441,10 @@ static void drain_cpu_pagevecs(int cpu)
 		pagevec_move_tail(pvec);
 		local_irq_restore(flags);
 	}
+
+	pvec = &per_cpu(lru_deactivate_pvecs, cpu);
+	if (pagevec_count(pvec))
+		pagevec_deactivate(pvec);
 }
 
 void lru_add_drain(void)
@@ -486,7 +559,7 @@ void lru_add_page_tail(struct zone* zone,
 	int active;
 	enum lru_list lru;
 	const int file = 0;
-	struct list_head *head;
+	struct lruvec *lruvec;
 
 	VM_BUG_ON(!PageHead(page));
 	VM_BUG_ON(PageCompound(page_tail));
@@ -505,11 +578,17 @@ void lru_add_page_tail(struct zone* zone,
 			lru = LRU_INACTIVE_ANON;
 		}
 		update_page_reclaim_stat(zone, page_tail, file, active);
+		/*
+		 * The tail inherited the head's page_cgroup, so it is
+		 * accounted to the lruvec the head is on and can be put
+		 * next to it there.
+		 */
+		lruvec = mem_cgroup_lru_add_list(zone, page_tail, lru);
 		if (likely(PageLRU(page)))
-			head = page->lru.prev;
+			list_add(&page_tail->lru, page->lru.prev);
 		else
-			head = &zone->lru[lru].list;
-		__add_page_to_lru_list(zone, page_tail, lru, head);
+			list_add(&page_tail->lru, &lruvec->lists[lru]);
+		__mod_zone_page_state(zone, NR_LRU_BASE + lru, 1);
 	} else {
 		SetPageUnevictable(page_tail);
 		add_page_to_lru_list(zone, page_tail, LRU_UNEVICTABLE);
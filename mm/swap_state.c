@@ -22,6 +22,34 @@
 
 #include <asm/pgtable.h>
 
+/*
+ * Non-zero selects readahead based on the ptes surrounding the faulting
+ * address instead of the physically adjacent swap slots.
+ */
+int vm_swap_vma_readahead __read_mostly;
+
+/*
+ * vma->swap_readahead_info packs the address of the last swap fault in the
+ * vma, the readahead window used for it and the number of readahead hits
+ * since then.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* The ptes of the window are copied on the stack, so bound its size */
+#define SWAP_RA_PTE_MAX		32
+
 /*
  * swapper_space is a fiction, retained to simplify the path through
  * vmscan's shrink_page_list, to make sync_page look nicer, and to allow
@@ -263,14 +291,29 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
+			       unsigned long addr)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			if (vma && vm_swap_vma_readahead) {
+				unsigned long ra_val;
+				unsigned long hits;
+
+				ra_val = atomic_long_read(&vma->swap_readahead_info);
+				hits = SWAP_RA_HITS(ra_val);
+				if (hits < SWAP_RA_HITS_MAX)
+					atomic_long_set(&vma->swap_readahead_info,
+							ra_val + 1);
+			}
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -280,14 +323,17 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * Locate a page of swap in physical memory, reserving swap cache space
  * and reading the disk if it is not already cached.
  * A failure return means that either the page allocation failed or that
- * the swap entry is no longer in use.
+ * the swap entry is no longer in use.  *@allocated is set when the read
+ * was started by us rather than found in the swap cache.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			int *allocated)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*allocated = 0;
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -338,6 +384,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*allocated = 1;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -355,6 +402,36 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	int allocated;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr, &allocated);
+}
+
+/*
+ * Start an asynchronous read of a swap entry.  Unless it is the entry the
+ * caller faulted on, mark it so that a later hit can be accounted.
+ */
+static int swap_readahead_one(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			int target)
+{
+	struct page *page;
+	int allocated;
+
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr, &allocated);
+	if (!page)
+		return 0;
+	if (allocated && !target) {
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+	return 1;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -378,7 +455,6 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
 	int nr_pages;
-	struct page *page;
 	unsigned long offset;
 	unsigned long end_offset;
 
@@ -392,12 +468,151 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
+		if (!swap_readahead_one(swp_entry(swp_type(entry), offset),
+					gfp_mask, vma, addr,
+					offset == swp_offset(entry)))
 			break;
-		page_cache_release(page);
 	}
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/*
+ * Size the next readahead window from the hits of the previous one: grow
+ * it while the readahead pages get used, and only then beyond a single
+ * neighbour of a sequential fault.  The window is never shrunk by more
+ * than half at once, so that a single miss does not kill a working stream.
+ */
+static unsigned int swap_ra_nr_pages(unsigned long prev_pfn, unsigned long pfn,
+			unsigned long hits, unsigned int max_pages,
+			unsigned int prev_win)
+{
+	unsigned int pages, last_ra;
+
+	pages = hits + 2;
+	if (pages == 2) {
+		/* No hits: only read around a sequential fault */
+		if (pfn != prev_pfn + 1 && pfn != prev_pfn - 1)
+			pages = 1;
+	} else {
+		unsigned int roundup = 4;
+
+		while (roundup < pages)
+			roundup <<= 1;
+		pages = roundup;
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	last_ra = prev_win / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+
+	return pages;
+}
+
+/*
+ * Clamp the window [lpfn, rpfn) to the vma and to the page table page
+ * which maps the faulting address.
+ */
+static void swap_ra_clamp_pfn(struct vm_area_struct *vma, unsigned long faddr,
+			unsigned long lpfn, unsigned long rpfn,
+			unsigned long *start, unsigned long *end)
+{
+	*start = max3(lpfn, PFN_DOWN(vma->vm_start),
+		      PFN_DOWN(faddr & PMD_MASK));
+	*end = min3(rpfn, PFN_DOWN(vma->vm_end),
+		    PFN_DOWN((faddr & PMD_MASK) + PMD_SIZE));
+}
+
+/**
+ * swap_vma_readahead - swap in pages mapped around the faulting address
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @faddr: faulting address
+ * @pmd: pmd mapping the page table of @faddr
+ *
+ * Returns the struct page for entry and faddr, after queueing swapin.
+ *
+ * Unlike swapin_readahead(), which reads the swap slots physically next to
+ * @entry whoever they belong to, this reads the swap entries installed in
+ * the ptes neighbouring @faddr within @vma.  The window follows the
+ * direction of consecutive faults and adapts to how many of the pages it
+ * read last time were actually faulted on.
+ *
+ * Falls back to swapin_readahead() unless vm.swap_vma_readahead is set.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swap_vma_readahead(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long faddr,
+			pmd_t *pmd)
+{
+	pte_t ptes[SWAP_RA_PTE_MAX];
+	unsigned long ra_val, prev_pfn, fpfn, start, end, pfn, addr;
+	unsigned int max_win, win, left;
+	pte_t *pte;
+	int i, nr;
+
+	if (!vm_swap_vma_readahead)
+		return swapin_readahead(entry, gfp_mask, vma, faddr);
+
+	max_win = 1 << min(page_cluster, ilog2(SWAP_RA_PTE_MAX));
+	faddr &= PAGE_MASK;
+	fpfn = PFN_DOWN(faddr);
+
+	ra_val = atomic_long_read(&vma->swap_readahead_info);
+	prev_pfn = PFN_DOWN(SWAP_RA_ADDR(ra_val));
+	win = swap_ra_nr_pages(prev_pfn, fpfn, SWAP_RA_HITS(ra_val),
+			       max_win, SWAP_RA_WIN(ra_val));
+	atomic_long_set(&vma->swap_readahead_info,
+			SWAP_RA_VAL(faddr, win, 0));
+
+	if (win == 1)
+		goto skip;
+
+	if (fpfn == prev_pfn + 1) {
+		/* Forward stream */
+		swap_ra_clamp_pfn(vma, faddr, fpfn, fpfn + win, &start, &end);
+	} else if (prev_pfn == fpfn + 1) {
+		/* Backward stream */
+		swap_ra_clamp_pfn(vma, faddr, fpfn - win + 1, fpfn + 1,
+				  &start, &end);
+	} else {
+		left = (win - 1) / 2;
+		swap_ra_clamp_pfn(vma, faddr, fpfn - left, fpfn + win - left,
+				  &start, &end);
+	}
+
+	/*
+	 * Copy the ptes out, reading swap entries may sleep.  A stale entry
+	 * is harmless: read_swap_cache_async() rechecks that it is in use.
+	 */
+	if (start >= end)
+		goto skip;
+	nr = end - start;
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (i = 0; i < nr; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	for (i = 0, pfn = start; i < nr; i++, pfn++) {
+		swp_entry_t ra_entry;
+
+		if (pte_none(ptes[i]) || pte_present(ptes[i]) ||
+		    pte_file(ptes[i]))
+			continue;
+		ra_entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(ra_entry)))
+			continue;
+		addr = pfn << PAGE_SHIFT;
+		if (!swap_readahead_one(ra_entry, gfp_mask, vma, addr,
+					pfn == fpfn))
+			break;
+	}
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
+	return read_swap_cache_async(entry, gfp_mask, vma, faddr);
+}
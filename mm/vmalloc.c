@@ -1479,11 +1479,15 @@ EXPORT_SYMBOL(vmap);
 static void *__vmalloc_node(unsigned long size, unsigned long align,
 			    gfp_t gfp_mask, pgprot_t prot,
 			    int node, void *caller);
+
+/* Pages taken from the bulk allocator at a time */
+#define VMALLOC_BULK_PAGES	100U
+
 static void *__vmalloc_area_node(struct vm_struct *area, gfp_t gfp_mask,
 				 pgprot_t prot, int node, void *caller)
 {
 	struct page **pages;
-	unsigned int nr_pages, array_size, i;
+	unsigned int nr_pages, array_size, i, nr;
 	gfp_t nested_gfp = (gfp_mask & GFP_RECLAIM_MASK) | __GFP_ZERO;
 
 	nr_pages = (area->size - PAGE_SIZE) >> PAGE_SHIFT;
@@ -1506,20 +1510,26 @@ static void *__vmalloc_area_node(struct vm_struct *area, gfp_t gfp_mask,
 		return NULL;
 	}
 
-	for (i = 0; i < area->nr_pages; i++) {
-		struct page *page;
-
-		if (node < 0)
-			page = alloc_page(gfp_mask);
-		else
-			page = alloc_pages_node(node, gfp_mask, 0);
-
-		if (unlikely(!page)) {
+	for (i = 0; i < area->nr_pages; i += nr) {
+		if (node < 0) {
+			/* alloc_page() follows the task's mempolicy */
+			area->pages[i] = alloc_page(gfp_mask);
+			nr = area->pages[i] ? 1 : 0;
+		} else {
+			/*
+			 * The page array was zeroed above, so each batch
+			 * fills the next slots in order.  Batches are kept
+			 * small so that interrupts are not disabled for long.
+			 */
+			nr = alloc_pages_bulk_node(node, gfp_mask,
+					min(area->nr_pages - i, VMALLOC_BULK_PAGES),
+					NULL, area->pages + i);
+		}
+		if (unlikely(!nr)) {
 			/* Successfully allocated i pages, free them in __vunmap() */
 			area->nr_pages = i;
 			goto fail;
 		}
-		area->pages[i] = page;
 	}
 
 	if (map_vm_area(area, prot, &pages))
@@ -29,6 +29,7 @@
 #include <linux/pagevec.h>
 #include <linux/backing-dev.h>
 #include <linux/rmap.h>
+#include <linux/ksm.h>
 #include <linux/topology.h>
 #include <linux/cpu.h>
 #include <linux/cpuset.h>
@@ -41,6 +42,7 @@
 #include <linux/memcontrol.h>
 #include <linux/delayacct.h>
 #include <linux/sysctl.h>
+#include <linux/vmpressure.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -103,7 +105,13 @@ struct scan_control {
 	 */
 	reclaim_mode_t reclaim_mode;
 
-	/* Which cgroup do we reclaim from */
+	/*
+	 * The memory cgroup that hit its limit and is the target of
+	 * reclaim, or NULL for global reclaim.
+	 */
+	struct mem_cgroup *target_mem_cgroup;
+
+	/* The memory cgroup whose LRU lists are being scanned */
 	struct mem_cgroup *mem_cgroup;
 
 	/*
@@ -111,6 +119,12 @@ struct scan_control {
 	 * are scanned.
 	 */
 	nodemask_t	*nodemask;
+
+	/*
+	 * Number of kswapd threads reclaiming the node together, each of
+	 * which scans its share of the per-priority scan target.
+	 */
+	int nr_kswapd_threads;
 };
 
 #define lru_to_page(_head) (list_entry((_head)->prev, struct page, lru))
@@ -153,15 +167,15 @@ static LIST_HEAD(shrinker_list);
 static DECLARE_RWSEM(shrinker_rwsem);
 
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR
-#define scanning_global_lru(sc)	(!(sc)->mem_cgroup)
+#define global_reclaim(sc)	(!(sc)->target_mem_cgroup)
 #else
-#define scanning_global_lru(sc)	(1)
+#define global_reclaim(sc)	(1)
 #endif
 
 static struct zone_reclaim_stat *get_reclaim_stat(struct zone *zone,
 						  struct scan_control *sc)
 {
-	if (!scanning_global_lru(sc))
+	if (!mem_cgroup_disabled())
 		return mem_cgroup_get_reclaim_stat(sc->mem_cgroup, zone);
 
 	return &zone->reclaim_stat;
@@ -170,7 +184,7 @@ static struct zone_reclaim_stat *get_reclaim_stat(struct zone *zone,
 static unsigned long zone_nr_lru_pages(struct zone *zone,
 				struct scan_control *sc, enum lru_list lru)
 {
-	if (!scanning_global_lru(sc))
+	if (!mem_cgroup_disabled())
 		return mem_cgroup_zone_nr_pages(sc->mem_cgroup, zone, lru);
 
 	return zone_page_state(zone, NR_LRU_BASE + lru);
@@ -201,27 +215,19 @@ void unregister_shrinker(struct shrinker *shrinker)
 EXPORT_SYMBOL(unregister_shrinker);
 
 #define SHRINK_BATCH 128
-/*
- * Call the shrink functions to age shrinkable caches
- *
- * Here we assume it costs one seek to replace a lru page and that it also
- * takes a seek to recreate a cache object.  With this in mind we age equal
- * percentages of the lru and ageable caches.  This should balance the seeks
- * generated by these structures.
- *
- * If the vm encountered mapped pages on the LRU it increase the pressure on
- * slab to avoid swapping.
- *
- * We do weird things to avoid (scanned*seeks*entries) overflowing 32 bits.
- *
- * `lru_pages' represents the number of on-LRU pages in all the zones which
- * are eligible for the caller's allocation attempt.  It is used for balancing
- * slab reclaim versus page reclaim.
- *
- * Returns the number of slab objects which we shrunk.
- */
-unsigned long shrink_slab(unsigned long scanned, gfp_t gfp_mask,
-			unsigned long lru_pages)
+
+static int do_shrinker(struct shrinker *shrinker, struct mem_cgroup *mem,
+		       int nr_to_scan, gfp_t gfp_mask)
+{
+	if (mem)
+		return (*shrinker->shrink_memcg)(shrinker, mem, nr_to_scan,
+						 gfp_mask);
+	return (*shrinker->shrink)(shrinker, nr_to_scan, gfp_mask);
+}
+
+static unsigned long __shrink_slab(struct mem_cgroup *mem,
+				   unsigned long scanned, gfp_t gfp_mask,
+				   unsigned long lru_pages)
 {
 	struct shrinker *shrinker;
 	unsigned long ret = 0;
@@ -236,17 +242,34 @@ unsigned long shrink_slab(unsigned long scanned, gfp_t gfp_mask,
 		unsigned long long delta;
 		unsigned long total_scan;
 		unsigned long max_pass;
+		long nr;
+
+		if (mem && !shrinker->shrink_memcg)
+			continue;
 
-		max_pass = (*shrinker->shrink)(shrinker, 0, gfp_mask);
+		/*
+		 * Work deferred by global reclaim is not owed by any one
+		 * cgroup, so cgroup reclaim leaves shrinker->nr alone.
+		 * Global reclaim takes it out while scanning, so that
+		 * concurrent reclaimers don't each do it all over again.
+		 */
+		if (mem)
+			nr = 0;
+		else {
+			nr = shrinker->nr;
+			shrinker->nr = 0;
+		}
+
+		max_pass = do_shrinker(shrinker, mem, 0, gfp_mask);
 		delta = (4 * scanned) / shrinker->seeks;
 		delta *= max_pass;
 		do_div(delta, lru_pages + 1);
-		shrinker->nr += delta;
-		if (shrinker->nr < 0) {
+		nr += delta;
+		if (nr < 0) {
 			printk(KERN_ERR "shrink_slab: %pF negative objects to "
 			       "delete nr=%ld\n",
-			       shrinker->shrink, shrinker->nr);
-			shrinker->nr = max_pass;
+			       shrinker->shrink, nr);
+			nr = max_pass;
 		}
 
 		/*
@@ -254,20 +277,19 @@ unsigned long shrink_slab(unsigned long scanned, gfp_t gfp_mask,
 		 * never try to free more than twice the estimate number of
 		 * freeable entries.
 		 */
-		if (shrinker->nr > max_pass * 2)
-			shrinker->nr = max_pass * 2;
+		if (nr > max_pass * 2)
+			nr = max_pass * 2;
 
-		total_scan = shrinker->nr;
-		shrinker->nr = 0;
+		total_scan = nr;
 
 		while (total_scan >= SHRINK_BATCH) {
 			long this_scan = SHRINK_BATCH;
 			int shrink_ret;
 			int nr_before;
 
-			nr_before = (*shrinker->shrink)(shrinker, 0, gfp_mask);
-			shrink_ret = (*shrinker->shrink)(shrinker, this_scan,
-								gfp_mask);
+			nr_before = do_shrinker(shrinker, mem, 0, gfp_mask);
+			shrink_ret = do_shrinker(shrinker, mem, this_scan,
+						 gfp_mask);
 			if (shrink_ret == -1)
 				break;
 			if (shrink_ret < nr_before)
@@ -278,12 +300,49 @@ unsigned long shrink_slab(unsigned long scanned, gfp_t gfp_mask,
 			cond_resched();
 		}
 
-		shrinker->nr += total_scan;
+		if (!mem)
+			shrinker->nr += total_scan;
 	}
 	up_read(&shrinker_rwsem);
 	return ret;
 }
 
+/*
+ * Call the shrink functions to age shrinkable caches
+ *
+ * Here we assume it costs one seek to replace a lru page and that it also
+ * takes a seek to recreate a cache object.  With this in mind we age equal
+ * percentages of the lru and ageable caches.  This should balance the seeks
+ * generated by these structures.
+ *
+ * If the vm encountered mapped pages on the LRU it increase the pressure on
+ * slab to avoid swapping.
+ *
+ * We do weird things to avoid (scanned*seeks*entries) overflowing 32 bits.
+ *
+ * `lru_pages' represents the number of on-LRU pages in all the zones which
+ * are eligible for the caller's allocation attempt.  It is used for balancing
+ * slab reclaim versus page reclaim.
+ *
+ * Returns the number of slab objects which we shrunk.
+ */
+unsigned long shrink_slab(unsigned long scanned, gfp_t gfp_mask,
+			unsigned long lru_pages)
+{
+	return __shrink_slab(NULL, scanned, gfp_mask, lru_pages);
+}
+
+/*
+ * Like shrink_slab(), but only calls the shrinkers that can reclaim the
+ * objects charged to @mem and its descendants.  `lru_pages' is the size
+ * of the cgroup's LRU lists.
+ */
+unsigned long shrink_slab_memcg(struct mem_cgroup *mem, unsigned long scanned,
+			gfp_t gfp_mask, unsigned long lru_pages)
+{
+	return __shrink_slab(mem, scanned, gfp_mask, lru_pages);
+}
+
 static void set_reclaim_mode(int priority, struct scan_control *sc,
 				   bool sync)
 {
@@ -634,7 +693,8 @@ static enum page_references page_check_references(struct page *page,
 	int referenced_ptes, referenced_page;
 	unsigned long vm_flags;
 
-	referenced_ptes = page_referenced(page, 1, sc->mem_cgroup, &vm_flags);
+	referenced_ptes = page_referenced(page, 1, sc->target_mem_cgroup,
+					  &vm_flags);
 	referenced_page = TestClearPageReferenced(page);
 
 	/* Lumpy reclaim - ignore references */
@@ -719,6 +779,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		struct address_space *mapping;
 		struct page *page;
 		int may_enter_fs;
+		int lazyfree;
 
 		cond_resched();
 
@@ -775,11 +836,22 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			; /* try to reclaim the page below */
 		}
 
+		/*
+		 * An anonymous page marked by MADV_FREE that has not been
+		 * dirtied since can be dropped without writing it to swap,
+		 * as long as none of its ptes got dirty again either.
+		 */
+		lazyfree = PageAnon(page) && PageLazyFree(page) &&
+			   !PageSwapCache(page) && !PageDirty(page) &&
+			   !PageTransHuge(page) && !PageKsm(page);
+
 		/*
 		 * Anonymous process memory has backing store?
 		 * Try to allocate it some swap space here.
 		 */
-		if (PageAnon(page) && !PageSwapCache(page)) {
+		if (PageAnon(page) && !PageSwapCache(page) && !lazyfree) {
+			/* the contents are wanted again, if it was freed */
+			ClearPageLazyFree(page);
 			if (!(sc->gfp_mask & __GFP_IO))
 				goto keep_locked;
 			if (!add_to_swap(page))
@@ -793,8 +865,13 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		 * The page is mapped into the page tables of one or more
 		 * processes. Try to unmap it here.
 		 */
-		if (page_mapped(page) && mapping) {
-			switch (try_to_unmap(page, TTU_UNMAP)) {
+		if (page_mapped(page) && (mapping || lazyfree)) {
+			enum ttu_flags flags = TTU_UNMAP | TTU_BATCH_FLUSH;
+
+			if (lazyfree)
+				flags |= TTU_FREE;
+
+			switch (try_to_unmap(page, flags)) {
 			case SWAP_FAIL:
 				goto activate_locked;
 			case SWAP_AGAIN:
@@ -806,6 +883,22 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
+		if (lazyfree) {
+			/*
+			 * Nobody else may hold a reference: see the
+			 * comments in __remove_mapping().
+			 */
+			if (!page_freeze_refs(page, 1))
+				goto keep_locked;
+			if (unlikely(PageDirty(page) || page_mapped(page))) {
+				page_unfreeze_refs(page, 1);
+				goto keep_locked;
+			}
+			count_vm_event(PGLAZYFREED);
+			__clear_page_locked(page);
+			goto free_it;
+		}
+
 		if (PageDirty(page)) {
 			nr_dirty++;
 
@@ -816,7 +909,12 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			if (!sc->may_writepage)
 				goto keep_locked;
 
-			/* Page is dirty, try to write it out here */
+			/*
+			 * Page is dirty. Flush the TLB if a writable entry
+			 * potentially exists to avoid CPU writes after IO
+			 * starts and then write it out here.
+			 */
+			try_to_unmap_flush_dirty();
 			switch (pageout(page, mapping, sc)) {
 			case PAGE_KEEP:
 				nr_congested++;
@@ -939,6 +1037,8 @@ keep_lumpy:
 	if (nr_dirty == nr_congested && nr_dirty != 0)
 		zone_set_flag(zone, ZONE_CONGESTED);
 
+	/* No stale TLB entry may point at a page once it is freed */
+	try_to_unmap_flush();
 	free_page_list(&free_pages);
 
 	list_splice(&ret_pages, page_list);
@@ -998,6 +1098,35 @@ int __isolate_lru_page(struct page *page, int mode, int file)
 	return ret;
 }
 
+/*
+ * Take zone->lru_lock with interrupts disabled, counting the times a
+ * reclaimer found it held by somebody else.
+ */
+static inline void lock_lru_irq(struct zone *zone)
+{
+	if (unlikely(!spin_trylock_irq(&zone->lru_lock))) {
+		count_vm_event(LRU_LOCK_CONTENDED);
+		spin_lock_irq(&zone->lru_lock);
+	}
+}
+
+/*
+ * Reclaimers process pages in batches under zone->lru_lock.  Between
+ * batches, let the lock go for a moment if somebody else is spinning on
+ * it or we ought to reschedule, so that lock hold times stay bounded
+ * when many CPUs reclaim from the same zone.
+ */
+static void lru_lock_break(struct zone *zone)
+{
+	if (!need_resched() && !spin_is_contended(&zone->lru_lock))
+		return;
+
+	spin_unlock_irq(&zone->lru_lock);
+	count_vm_event(LRU_LOCK_BREAK);
+	cond_resched();
+	lock_lru_irq(zone);
+}
+
 /*
  * zone->lru_lock is heavily contended.  Some of the functions that
  * shrink the lists perform better by taking out a batch of pages
@@ -1009,6 +1138,7 @@ int __isolate_lru_page(struct page *page, int mode, int file)
  * Appropriate locks must be held before calling this function.
  *
  * @nr_to_scan:	The number of pages to look through on the list.
+ * @zone:	The zone whose lru_lock is held.
  * @src:	The LRU list to pull pages off.
  * @dst:	The temp list to put pages on to.
  * @scanned:	The number of pages that were scanned.
@@ -1019,10 +1149,11 @@ int __isolate_lru_page(struct page *page, int mode, int file)
  * returns how many pages were moved onto *@dst.
  */
 static unsigned long isolate_lru_pages(unsigned long nr_to_scan,
-		struct list_head *src, struct list_head *dst,
+		struct zone *zone, struct list_head *src, struct list_head *dst,
 		unsigned long *scanned, int order, int mode, int file)
 {
 	unsigned long nr_taken = 0;
+	unsigned long nr_batch = 0;
 	unsigned long nr_lumpy_taken = 0;
 	unsigned long nr_lumpy_dirty = 0;
 	unsigned long nr_lumpy_failed = 0;
@@ -1042,15 +1173,14 @@ static unsigned long isolate_lru_pages(unsigned long nr_to_scan,
 
 		switch (__isolate_lru_page(page, mode, file)) {
 		case 0:
+			mem_cgroup_lru_del(page);
 			list_move(&page->lru, dst);
-			mem_cgroup_del_lru(page);
 			nr_taken += hpage_nr_pages(page);
 			break;
 
 		case -EBUSY:
 			/* else it is being freed elsewhere */
 			list_move(&page->lru, src);
-			mem_cgroup_rotate_lru_list(page, page_lru(page));
 			continue;
 
 		default:
@@ -1100,10 +1230,11 @@ static unsigned long isolate_lru_pages(unsigned long nr_to_scan,
 				break;
 
 			if (__isolate_lru_page(cursor_page, mode, file) == 0) {
+				mem_cgroup_lru_del(cursor_page);
 				list_move(&cursor_page->lru, dst);
-				mem_cgroup_del_lru(cursor_page);
 				nr_taken += hpage_nr_pages(page);
 				nr_lumpy_taken++;
+				nr_batch++;
 				if (PageDirty(cursor_page))
 					nr_lumpy_dirty++;
 				scan++;
@@ -1118,6 +1249,16 @@ static unsigned long isolate_lru_pages(unsigned long nr_to_scan,
 		/* If we break out of the loop above, lumpy reclaim failed */
 		if (pfn < end_pfn)
 			nr_lumpy_failed++;
+
+		/*
+		 * Lumpy reclaim may take many times nr_to_scan pages, keep
+		 * the lock hold time bounded.  The pages taken so far are
+		 * off the LRU already.
+		 */
+		if (nr_batch >= SWAP_CLUSTER_MAX) {
+			nr_batch = 0;
+			lru_lock_break(zone);
+		}
 	}
 
 	*scanned = scan;
@@ -1130,19 +1271,21 @@ static unsigned long isolate_lru_pages(unsigned long nr_to_scan,
 	return nr_taken;
 }
 
-static unsigned long isolate_pages_global(unsigned long nr,
-					struct list_head *dst,
-					unsigned long *scanned, int order,
-					int mode, struct zone *z,
-					int active, int file)
+static unsigned long isolate_pages(unsigned long nr, struct list_head *dst,
+				   unsigned long *scanned, int order,
+				   int mode, struct zone *z,
+				   struct scan_control *sc,
+				   int active, int file)
 {
+	struct lruvec *lruvec = mem_cgroup_zone_lruvec(z, sc->mem_cgroup);
 	int lru = LRU_BASE;
+
 	if (active)
 		lru += LRU_ACTIVE;
 	if (file)
 		lru += LRU_FILE;
-	return isolate_lru_pages(nr, &z->lru[lru].list, dst, scanned, order,
-								mode, file);
+	return isolate_lru_pages(nr, z, &lruvec->lists[lru], dst, scanned,
+				 order, mode, file);
 }
 
 /*
@@ -1227,7 +1370,7 @@ static int too_many_isolated(struct zone *zone, int file,
 	if (current_is_kswapd())
 		return 0;
 
-	if (!scanning_global_lru(sc))
+	if (!global_reclaim(sc))
 		return 0;
 
 	if (file) {
@@ -1243,6 +1386,12 @@ static int too_many_isolated(struct zone *zone, int file,
 
 /*
  * TODO: Try merging with migrations version of putback_lru_pages
+ *
+ * Called with zone->lru_lock held, which is released on return.  The
+ * isolation references are dropped under the lock and the pages whose
+ * last reference that was are freed in one batch afterwards, instead of
+ * dropping the lock for every pagevec of pages put back.  Unevictable
+ * pages are also handled after the lock is released.
  */
 static noinline_for_stack void
 putback_lru_pages(struct zone *zone, struct scan_control *sc,
@@ -1250,26 +1399,20 @@ putback_lru_pages(struct zone *zone, struct scan_control *sc,
 				struct list_head *page_list)
 {
 	struct page *page;
-	struct pagevec pvec;
 	struct zone_reclaim_stat *reclaim_stat = get_reclaim_stat(zone, sc);
+	LIST_HEAD(pages_to_free);
+	LIST_HEAD(unevictable);
+	unsigned long nr = 0;
 
-	pagevec_init(&pvec, 1);
-
-	/*
-	 * Put back any unfreeable pages.
-	 */
-	spin_lock(&zone->lru_lock);
 	while (!list_empty(page_list)) {
 		int lru;
 		page = lru_to_page(page_list);
 		VM_BUG_ON(PageLRU(page));
-		list_del(&page->lru);
 		if (unlikely(!page_evictable(page, NULL))) {
-			spin_unlock_irq(&zone->lru_lock);
-			putback_lru_page(page);
-			spin_lock_irq(&zone->lru_lock);
+			list_move(&page->lru, &unevictable);
 			continue;
 		}
+		list_del(&page->lru);
 		SetPageLRU(page);
 		lru = page_lru(page);
 		add_page_to_lru_list(zone, page, lru);
@@ -1278,17 +1421,33 @@ putback_lru_pages(struct zone *zone, struct scan_control *sc,
 			int numpages = hpage_nr_pages(page);
 			reclaim_stat->recent_rotated[file] += numpages;
 		}
-		if (!pagevec_add(&pvec, page)) {
-			spin_unlock_irq(&zone->lru_lock);
-			__pagevec_release(&pvec);
-			spin_lock_irq(&zone->lru_lock);
+		if (put_page_testzero(page)) {
+			__ClearPageLRU(page);
+			__ClearPageActive(page);
+			del_page_from_lru_list(zone, page, lru);
+
+			if (unlikely(PageCompound(page))) {
+				spin_unlock_irq(&zone->lru_lock);
+				(*get_compound_page_dtor(page))(page);
+				lock_lru_irq(zone);
+			} else
+				list_add(&page->lru, &pages_to_free);
 		}
+		if (!(++nr % SWAP_CLUSTER_MAX))
+			lru_lock_break(zone);
 	}
 	__mod_zone_page_state(zone, NR_ISOLATED_ANON, -nr_anon);
 	__mod_zone_page_state(zone, NR_ISOLATED_FILE, -nr_file);
 
 	spin_unlock_irq(&zone->lru_lock);
-	pagevec_release(&pvec);
+
+	free_page_list(&pages_to_free);
+
+	while (!list_empty(&unevictable)) {
+		page = lru_to_page(&unevictable);
+		list_del(&page->lru);
+		putback_lru_page(page);
+	}
 }
 
 static noinline_for_stack void update_isolated_counts(struct zone *zone,
@@ -1388,14 +1547,14 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 
 	set_reclaim_mode(priority, sc, false);
 	lru_add_drain();
-	spin_lock_irq(&zone->lru_lock);
+	lock_lru_irq(zone);
 
-	if (scanning_global_lru(sc)) {
-		nr_taken = isolate_pages_global(nr_to_scan,
-			&page_list, &nr_scanned, sc->order,
+	nr_taken = isolate_pages(nr_to_scan, &page_list, &nr_scanned,
+			sc->order,
 			sc->reclaim_mode & RECLAIM_MODE_LUMPYRECLAIM ?
 					ISOLATE_BOTH : ISOLATE_INACTIVE,
-			zone, 0, file);
+			zone, sc, 0, file);
+	if (global_reclaim(sc)) {
 		zone->pages_scanned += nr_scanned;
 		if (current_is_kswapd())
 			__count_zone_vm_events(PGSCAN_KSWAPD, zone,
@@ -1403,17 +1562,6 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 		else
 			__count_zone_vm_events(PGSCAN_DIRECT, zone,
 					       nr_scanned);
-	} else {
-		nr_taken = mem_cgroup_isolate_pages(nr_to_scan,
-			&page_list, &nr_scanned, sc->order,
-			sc->reclaim_mode & RECLAIM_MODE_LUMPYRECLAIM ?
-					ISOLATE_BOTH : ISOLATE_INACTIVE,
-			zone, sc->mem_cgroup,
-			0, file);
-		/*
-		 * mem_cgroup_isolate_pages() keeps track of
-		 * scanned pages on its own.
-		 */
 	}
 
 	if (nr_taken == 0) {
@@ -1433,7 +1581,7 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 		nr_reclaimed += shrink_page_list(&page_list, zone, sc);
 	}
 
-	local_irq_disable();
+	lock_lru_irq(zone);
 	if (current_is_kswapd())
 		__count_vm_events(KSWAPD_STEAL, nr_reclaimed);
 	__count_zone_vm_events(PGSTEAL, zone, nr_reclaimed);
@@ -1477,13 +1625,15 @@ static void move_active_pages_to_lru(struct zone *zone,
 	pagevec_init(&pvec, 1);
 
 	while (!list_empty(list)) {
+		struct lruvec *lruvec;
+
 		page = lru_to_page(list);
 
 		VM_BUG_ON(PageLRU(page));
 		SetPageLRU(page);
 
-		list_move(&page->lru, &zone->lru[lru].list);
-		mem_cgroup_add_lru_list(page, lru);
+		lruvec = mem_cgroup_lru_add_list(zone, page, lru);
+		list_move(&page->lru, &lruvec->lists[lru]);
 		pgmoved += hpage_nr_pages(page);
 
 		if (!pagevec_add(&pvec, page) || list_empty(list)) {
@@ -1491,7 +1641,7 @@ static void move_active_pages_to_lru(struct zone *zone,
 			if (buffer_heads_over_limit)
 				pagevec_strip(&pvec);
 			__pagevec_release(&pvec);
-			spin_lock_irq(&zone->lru_lock);
+			lock_lru_irq(zone);
 		}
 	}
 	__mod_zone_page_state(zone, NR_LRU_BASE + lru, pgmoved);
@@ -1513,23 +1663,11 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	unsigned long nr_rotated = 0;
 
 	lru_add_drain();
-	spin_lock_irq(&zone->lru_lock);
-	if (scanning_global_lru(sc)) {
-		nr_taken = isolate_pages_global(nr_pages, &l_hold,
-						&pgscanned, sc->order,
-						ISOLATE_ACTIVE, zone,
-						1, file);
+	lock_lru_irq(zone);
+	nr_taken = isolate_pages(nr_pages, &l_hold, &pgscanned, sc->order,
+				 ISOLATE_ACTIVE, zone, sc, 1, file);
+	if (global_reclaim(sc))
 		zone->pages_scanned += pgscanned;
-	} else {
-		nr_taken = mem_cgroup_isolate_pages(nr_pages, &l_hold,
-						&pgscanned, sc->order,
-						ISOLATE_ACTIVE, zone,
-						sc->mem_cgroup, 1, file);
-		/*
-		 * mem_cgroup_isolate_pages() keeps track of
-		 * scanned pages on its own.
-		 */
-	}
 
 	reclaim_stat->recent_scanned[file] += nr_taken;
 
@@ -1551,7 +1689,8 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 			continue;
 		}
 
-		if (page_referenced(page, 0, sc->mem_cgroup, &vm_flags)) {
+		if (page_referenced(page, 0, sc->target_mem_cgroup,
+				    &vm_flags)) {
 			nr_rotated += hpage_nr_pages(page);
 			/*
 			 * Identify referenced, file-backed active pages and
@@ -1575,7 +1714,7 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	/*
 	 * Move pages back to the lru list.
 	 */
-	spin_lock_irq(&zone->lru_lock);
+	lock_lru_irq(zone);
 	/*
 	 * Count referenced pages from currently used mappings as rotated,
 	 * even though only some of them are actually re-activated.  This
@@ -1625,10 +1764,10 @@ static int inactive_anon_is_low(struct zone *zone, struct scan_control *sc)
 	if (!total_swap_pages)
 		return 0;
 
-	if (scanning_global_lru(sc))
+	if (mem_cgroup_disabled())
 		low = inactive_anon_is_low_global(zone);
 	else
-		low = mem_cgroup_inactive_anon_is_low(sc->mem_cgroup);
+		low = mem_cgroup_inactive_anon_is_low(sc->mem_cgroup, zone);
 	return low;
 }
 #else
@@ -1668,10 +1807,10 @@ static int inactive_file_is_low(struct zone *zone, struct scan_control *sc)
 {
 	int low;
 
-	if (scanning_global_lru(sc))
+	if (mem_cgroup_disabled())
 		low = inactive_file_is_low_global(zone);
 	else
-		low = mem_cgroup_inactive_file_is_low(sc->mem_cgroup);
+		low = mem_cgroup_inactive_file_is_low(sc->mem_cgroup, zone);
 	return low;
 }
 
@@ -1751,11 +1890,15 @@ static void get_scan_count(struct zone *zone, struct scan_control *sc,
 	file  = zone_nr_lru_pages(zone, sc, LRU_ACTIVE_FILE) +
 		zone_nr_lru_pages(zone, sc, LRU_INACTIVE_FILE);
 
-	if (scanning_global_lru(sc)) {
+	if (global_reclaim(sc)) {
+		unsigned long zone_file;
+
 		free  = zone_page_state(zone, NR_FREE_PAGES);
-		/* If we have very few page cache pages,
+		zone_file = zone_page_state(zone, NR_ACTIVE_FILE) +
+			    zone_page_state(zone, NR_INACTIVE_FILE);
+		/* If the zone has very few page cache pages,
 		   force-scan anon pages. */
-		if (unlikely(file + free <= high_wmark_pages(zone))) {
+		if (unlikely(zone_file + free <= high_wmark_pages(zone))) {
 			fraction[0] = 1;
 			fraction[1] = 0;
 			denominator = 1;
@@ -1817,6 +1960,8 @@ out:
 			scan >>= priority;
 			scan = div64_u64(scan * fraction[file], denominator);
 		}
+		if (sc->nr_kswapd_threads > 1)
+			scan = DIV_ROUND_UP(scan, sc->nr_kswapd_threads);
 		nr[l] = nr_scan_try_batch(scan,
 					  &reclaim_stat->nr_saved_scan[l]);
 	}
@@ -1874,10 +2019,10 @@ static inline bool should_continue_reclaim(struct zone *zone,
 }
 
 /*
- * This is a basic per-zone page freer.  Used by both kswapd and direct reclaim.
+ * Shrink the LRU lists of sc->mem_cgroup in @zone.
  */
-static void shrink_zone(int priority, struct zone *zone,
-				struct scan_control *sc)
+static void shrink_mem_cgroup_zone(int priority, struct zone *zone,
+				   struct scan_control *sc)
 {
 	unsigned long nr[NR_LRU_LISTS];
 	unsigned long nr_to_scan;
@@ -1926,6 +2071,62 @@ restart:
 	if (should_continue_reclaim(zone, nr_reclaimed,
 					sc->nr_scanned - nr_scanned, sc))
 		goto restart;
+}
+
+/*
+ * Global reclaim leaves the memory cgroups that are within their soft
+ * limit alone at priorities down to this one, as long as there are
+ * other cgroups to reclaim from.
+ */
+#define SOFT_LIMIT_PRIORITY	(DEF_PRIORITY - 2)
+
+/*
+ * This is a basic per-zone page freer.  Used by both kswapd and direct reclaim.
+ *
+ * Every memory cgroup has its own LRU lists in each zone.  Limit reclaim
+ * scans only the lists of the cgroup it is called for, the caller picks
+ * the victims in a hierarchy.  Global reclaim scans the lists of all
+ * cgroups, each in proportion to its size.
+ */
+static void shrink_zone(int priority, struct zone *zone,
+				struct scan_control *sc)
+{
+	unsigned long start_scanned = sc->nr_scanned;
+	unsigned long start_reclaimed = sc->nr_reclaimed;
+	struct mem_cgroup *mem;
+	bool protect;
+	int skipped;
+
+	if (!global_reclaim(sc)) {
+		sc->mem_cgroup = sc->target_mem_cgroup;
+		shrink_mem_cgroup_zone(priority, zone, sc);
+		goto out;
+	}
+
+	protect = !mem_cgroup_disabled() && priority >= SOFT_LIMIT_PRIORITY;
+restart:
+	skipped = 0;
+	mem = mem_cgroup_iter(NULL, NULL);
+	do {
+		if (protect && mem_cgroup_soft_limit_protected(mem)) {
+			skipped++;
+		} else {
+			sc->mem_cgroup = mem;
+			shrink_mem_cgroup_zone(priority, zone, sc);
+		}
+		mem = mem_cgroup_iter(NULL, mem);
+	} while (mem);
+	sc->mem_cgroup = NULL;
+
+	/* Nothing but protected cgroups, go after them after all */
+	if (skipped && sc->nr_scanned == start_scanned) {
+		protect = false;
+		goto restart;
+	}
+out:
+	vmpressure(sc->gfp_mask, sc->target_mem_cgroup,
+		   sc->nr_scanned - start_scanned,
+		   sc->nr_reclaimed - start_reclaimed);
 
 	throttle_vm_writeout(sc->gfp_mask);
 }
@@ -1960,7 +2161,7 @@ static void shrink_zones(int priority, struct zonelist *zonelist,
 		 * Take care memory controller reclaiming has small influence
 		 * to global LRU.
 		 */
-		if (scanning_global_lru(sc)) {
+		if (global_reclaim(sc)) {
 			if (!cpuset_zone_allowed_hardwall(zone, GFP_KERNEL))
 				continue;
 			if (zone->all_unreclaimable && priority != DEF_PRIORITY)
@@ -2032,19 +2233,20 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 	get_mems_allowed();
 	delayacct_freepages_start();
 
-	if (scanning_global_lru(sc))
+	if (global_reclaim(sc))
 		count_vm_event(ALLOCSTALL);
 
 	for (priority = DEF_PRIORITY; priority >= 0; priority--) {
+		vmpressure_prio(sc->gfp_mask, sc->target_mem_cgroup, priority);
 		sc->nr_scanned = 0;
 		if (!priority)
 			disable_swap_token();
 		shrink_zones(priority, zonelist, sc);
 		/*
-		 * Don't shrink slabs when reclaiming memory from
-		 * over limit cgroups
+		 * Limit reclaim only shrinks the slab objects that are
+		 * charged to the cgroup being reclaimed.
 		 */
-		if (scanning_global_lru(sc)) {
+		if (global_reclaim(sc)) {
 			unsigned long lru_pages = 0;
 			for_each_zone_zonelist(zone, z, zonelist,
 					gfp_zone(sc->gfp_mask)) {
@@ -2055,10 +2257,12 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 			}
 
 			shrink_slab(sc->nr_scanned, sc->gfp_mask, lru_pages);
-			if (reclaim_state) {
-				sc->nr_reclaimed += reclaim_state->reclaimed_slab;
-				reclaim_state->reclaimed_slab = 0;
-			}
+		} else
+			mem_cgroup_shrink_slab(sc->target_mem_cgroup,
+					       sc->nr_scanned, sc->gfp_mask);
+		if (reclaim_state) {
+			sc->nr_reclaimed += reclaim_state->reclaimed_slab;
+			reclaim_state->reclaimed_slab = 0;
 		}
 		total_scanned += sc->nr_scanned;
 		if (sc->nr_reclaimed >= sc->nr_to_reclaim)
@@ -2097,7 +2301,7 @@ out:
 		return sc->nr_reclaimed;
 
 	/* top priority shrink_zones still had more to do? don't OOM, then */
-	if (scanning_global_lru(sc) && !all_unreclaimable(zonelist, sc))
+	if (global_reclaim(sc) && !all_unreclaimable(zonelist, sc))
 		return 1;
 
 	return 0;
@@ -2115,7 +2319,7 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 		.may_swap = 1,
 		.swappiness = vm_swappiness,
 		.order = order,
-		.mem_cgroup = NULL,
+		.target_mem_cgroup = NULL,
 		.nodemask = nodemask,
 	};
 
@@ -2144,7 +2348,7 @@ unsigned long mem_cgroup_shrink_node_zone(struct mem_cgroup *mem,
 		.may_swap = !noswap,
 		.swappiness = swappiness,
 		.order = 0,
-		.mem_cgroup = mem,
+		.target_mem_cgroup = mem,
 	};
 	sc.gfp_mask = (gfp_mask & GFP_RECLAIM_MASK) |
 			(GFP_HIGHUSER_MOVABLE & ~GFP_RECLAIM_MASK);
@@ -2181,7 +2385,7 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *mem_cont,
 		.nr_to_reclaim = SWAP_CLUSTER_MAX,
 		.swappiness = swappiness,
 		.order = 0,
-		.mem_cgroup = mem_cont,
+		.target_mem_cgroup = mem_cont,
 		.nodemask = NULL, /* we don't care the placement */
 	};
 
@@ -2201,6 +2405,26 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *mem_cont,
 }
 #endif
 
+/*
+ * Deactivate anon pages on the LRU lists of every memory cgroup in
+ * @zone that has too few inactive ones.
+ */
+static void age_active_anon(struct zone *zone, struct scan_control *sc,
+			    int priority)
+{
+	struct mem_cgroup *mem;
+
+	mem = mem_cgroup_iter(NULL, NULL);
+	do {
+		sc->mem_cgroup = mem;
+		if (inactive_anon_is_low(zone, sc))
+			shrink_active_list(SWAP_CLUSTER_MAX, zone,
+					   sc, priority, 0);
+		mem = mem_cgroup_iter(NULL, mem);
+	} while (mem);
+	sc->mem_cgroup = NULL;
+}
+
 /*
  * pgdat_balanced is used when checking if a node is balanced for high-order
  * allocations. Only zones that meet watermarks and are in a zone allowed
@@ -2297,9 +2521,13 @@ static bool sleeping_prematurely(pg_data_t *pgdat, int order, long remaining,
  * lower zones regardless of the number of free pages in the lower zones. This
  * interoperates with the page allocator fallback scheme to ensure that aging
  * of pages is balanced across the zones.
+ *
+ * With helper kswapd threads, every thread runs balance_pgdat() on the node
+ * and scans its share of each zone's LRU lists.  Memcg soft limit reclaim
+ * and compaction are left to the primary thread.
  */
 static unsigned long balance_pgdat(pg_data_t *pgdat, int order,
-							int *classzone_idx)
+					int *classzone_idx, int thread)
 {
 	int all_zones_ok;
 	unsigned long balanced;
@@ -2308,6 +2536,7 @@ static unsigned long balance_pgdat(pg_data_t *pgdat, int order,
 	int end_zone = 0;	/* Inclusive.  0 = ZONE_DMA */
 	unsigned long total_scanned;
 	struct reclaim_state *reclaim_state = current->reclaim_state;
+	struct kswapd_thread *kt = &pgdat->kswapd_threads[thread];
 	struct scan_control sc = {
 		.gfp_mask = GFP_KERNEL,
 		.may_unmap = 1,
@@ -2319,12 +2548,14 @@ static unsigned long balance_pgdat(pg_data_t *pgdat, int order,
 		.nr_to_reclaim = ULONG_MAX,
 		.swappiness = vm_swappiness,
 		.order = order,
-		.mem_cgroup = NULL,
+		.target_mem_cgroup = NULL,
 	};
 loop_again:
 	total_scanned = 0;
 	sc.nr_reclaimed = 0;
 	sc.may_writepage = !laptop_mode;
+	sc.nr_kswapd_threads = pgdat->nr_kswapd_threads;
+	kt->nr_runs++;
 	count_vm_event(PAGEOUTRUN);
 
 	for (priority = DEF_PRIORITY; priority >= 0; priority--) {
@@ -2355,9 +2586,7 @@ loop_again:
 			 * Do some background aging of the anon list, to give
 			 * pages a chance to be referenced before reclaiming.
 			 */
-			if (inactive_anon_is_low(zone, &sc))
-				shrink_active_list(SWAP_CLUSTER_MAX, zone,
-							&sc, priority, 0);
+			age_active_anon(zone, &sc, priority);
 
 			if (!zone_watermark_ok_safe(zone, order,
 					high_wmark_pages(zone), 0, 0)) {
@@ -2387,6 +2616,7 @@ loop_again:
 		for (i = 0; i <= end_zone; i++) {
 			int compaction;
 			struct zone *zone = pgdat->node_zones + i;
+			unsigned long nr_reclaimed;
 			int nr_slab;
 
 			if (!populated_zone(zone))
@@ -2396,12 +2626,15 @@ loop_again:
 				continue;
 
 			sc.nr_scanned = 0;
+			nr_reclaimed = sc.nr_reclaimed;
 
 			/*
 			 * Call soft limit reclaim before calling shrink_zone.
 			 * For now we ignore the return value
 			 */
-			mem_cgroup_soft_limit_reclaim(zone, order, sc.gfp_mask);
+			if (!thread)
+				mem_cgroup_soft_limit_reclaim(zone, order,
+							      sc.gfp_mask);
 
 			/*
 			 * We put equal pressure on every zone, unless one
@@ -2416,8 +2649,15 @@ loop_again:
 			sc.nr_reclaimed += reclaim_state->reclaimed_slab;
 			total_scanned += sc.nr_scanned;
 
+			nr_reclaimed = sc.nr_reclaimed - nr_reclaimed;
+			kt->nr_scanned += sc.nr_scanned;
+			kt->nr_reclaimed += nr_reclaimed;
+			if (thread)
+				count_vm_events(KSWAPD_HELPER_STEAL,
+						nr_reclaimed);
+
 			compaction = 0;
-			if (order &&
+			if (!thread && order &&
 			    zone_watermark_ok(zone, 0,
 					       high_wmark_pages(zone),
 					      end_zone, 0) &&
@@ -2621,23 +2861,17 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
  * If there are applications that are active memory-allocators
  * (most normal use), this basically shouldn't matter.
  */
-static int kswapd(void *p)
+static void kswapd_init_task(pg_data_t *pgdat,
+			     struct reclaim_state *reclaim_state)
 {
-	unsigned long order;
-	int classzone_idx;
-	pg_data_t *pgdat = (pg_data_t*)p;
 	struct task_struct *tsk = current;
-
-	struct reclaim_state reclaim_state = {
-		.reclaimed_slab = 0,
-	};
 	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
 
 	lockdep_set_current_reclaim_state(GFP_KERNEL);
 
 	if (!cpumask_empty(cpumask))
 		set_cpus_allowed_ptr(tsk, cpumask);
-	current->reclaim_state = &reclaim_state;
+	tsk->reclaim_state = reclaim_state;
 
 	/*
 	 * Tell the memory management that we're a "memory allocator",
@@ -2653,6 +2887,35 @@ static int kswapd(void *p)
 	 */
 	tsk->flags |= PF_MEMALLOC | PF_SWAPWRITE | PF_KSWAPD;
 	set_freezable();
+}
+
+/*
+ * Hand the order and zone the primary kswapd is about to balance the node
+ * for to the helper threads, which then reclaim alongside it.
+ */
+static void kswapd_kick_helpers(pg_data_t *pgdat, int order,
+				int classzone_idx)
+{
+	if (pgdat->nr_kswapd_threads <= 1)
+		return;
+
+	pgdat->kswapd_helper_order = order;
+	pgdat->kswapd_helper_classzone_idx = classzone_idx;
+	smp_wmb();
+	pgdat->kswapd_helper_seq++;
+	wake_up_interruptible(&pgdat->kswapd_helper_wait);
+}
+
+static int kswapd(void *p)
+{
+	unsigned long order;
+	int classzone_idx;
+	pg_data_t *pgdat = (pg_data_t*)p;
+	struct reclaim_state reclaim_state = {
+		.reclaimed_slab = 0,
+	};
+
+	kswapd_init_task(pgdat, &reclaim_state);
 
 	order = 0;
 	classzone_idx = MAX_NR_ZONES - 1;
@@ -2690,12 +2953,49 @@ static int kswapd(void *p)
 		 */
 		if (!ret) {
 			trace_mm_vmscan_kswapd_wake(pgdat->node_id, order);
-			order = balance_pgdat(pgdat, order, &classzone_idx);
+			kswapd_kick_helpers(pgdat, order, classzone_idx);
+			order = balance_pgdat(pgdat, order, &classzone_idx, 0);
 		}
 	}
 	return 0;
 }
 
+/*
+ * A helper kswapd thread sleeps until the primary kswapd of its node kicks
+ * it, then balances the node alongside it.  It does not decide on its own
+ * when the node needs reclaim, nor does it adjust the vmstat thresholds.
+ */
+static int kswapd_helper(void *p)
+{
+	struct kswapd_thread *kt = p;
+	pg_data_t *pgdat = kt->pgdat;
+	unsigned long seq = pgdat->kswapd_helper_seq;
+	struct reclaim_state reclaim_state = {
+		.reclaimed_slab = 0,
+	};
+
+	kswapd_init_task(pgdat, &reclaim_state);
+
+	for ( ; ; ) {
+		int order, classzone_idx;
+
+		wait_event_freezable(pgdat->kswapd_helper_wait,
+				     pgdat->kswapd_helper_seq != seq ||
+				     kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+
+		seq = pgdat->kswapd_helper_seq;
+		smp_rmb();
+		order = pgdat->kswapd_helper_order;
+		classzone_idx = pgdat->kswapd_helper_classzone_idx;
+
+		count_vm_event(KSWAPD_HELPER_WAKE);
+		balance_pgdat(pgdat, order, &classzone_idx, kt->id);
+	}
+	return 0;
+}
+
 /*
  * A zone is low on free memory, so wake its kswapd task to service it.
  */
@@ -2798,6 +3098,79 @@ unsigned long shrink_all_memory(unsigned long nr_to_reclaim)
 }
 #endif /* CONFIG_HIBERNATION */
 
+/*
+ * Number of kswapd threads per node, including the primary one.  Changed
+ * for all nodes through the kswapd_threads sysctl, or per node through
+ * the node's kswapd_threads sysfs attribute.
+ */
+int kswapd_threads = 1;
+
+/* Serializes starting and stopping helper threads */
+static DEFINE_MUTEX(kswapd_threads_mutex);
+
+/*
+ * Start or stop helper kswapd threads until the node runs @nr threads.
+ * Returns the number of threads running on the node.
+ */
+static int kswapd_set_threads(pg_data_t *pgdat, int nr)
+{
+	int i;
+
+	nr = clamp(nr, 1, MAX_KSWAPD_THREADS);
+
+	mutex_lock(&kswapd_threads_mutex);
+	if (!pgdat->kswapd) {
+		/* Not running, kswapd_run() starts the helpers */
+		mutex_unlock(&kswapd_threads_mutex);
+		return 0;
+	}
+
+	for (i = pgdat->nr_kswapd_threads; i < nr; i++) {
+		struct kswapd_thread *kt = &pgdat->kswapd_threads[i];
+		struct task_struct *tsk;
+
+		kt->pgdat = pgdat;
+		kt->id = i;
+		tsk = kthread_run(kswapd_helper, kt, "kswapd%d:%d",
+				  pgdat->node_id, i);
+		if (IS_ERR(tsk)) {
+			printk(KERN_WARNING "Failed to start kswapd helper %d "
+			       "on node %d\n", i, pgdat->node_id);
+			break;
+		}
+		kt->task = tsk;
+		pgdat->nr_kswapd_threads = i + 1;
+	}
+
+	while (pgdat->nr_kswapd_threads > nr) {
+		struct kswapd_thread *kt;
+
+		kt = &pgdat->kswapd_threads[--pgdat->nr_kswapd_threads];
+		kthread_stop(kt->task);
+		kt->task = NULL;
+	}
+	nr = pgdat->nr_kswapd_threads;
+	mutex_unlock(&kswapd_threads_mutex);
+
+	return nr;
+}
+
+int kswapd_threads_handler(struct ctl_table *table, int write,
+			   void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int nid;
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kswapd_set_threads(NODE_DATA(nid), kswapd_threads);
+
+	return 0;
+}
+
 /* It's optimal to keep kswapds on the same CPUs as their memory, but
    not required for correctness.  So if the last cpu in a node goes
    away, we get changed to run anywhere: as the first one comes back,
@@ -2814,9 +3187,17 @@ static int __devinit cpu_callback(struct notifier_block *nfb,
 
 			mask = cpumask_of_node(pgdat->node_id);
 
-			if (cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids)
+			if (cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids) {
+				int i;
+
 				/* One of our CPUs online: restore mask */
-				set_cpus_allowed_ptr(pgdat->kswapd, mask);
+				mutex_lock(&kswapd_threads_mutex);
+				for (i = 0; i < pgdat->nr_kswapd_threads; i++)
+					set_cpus_allowed_ptr(
+						pgdat->kswapd_threads[i].task,
+						mask);
+				mutex_unlock(&kswapd_threads_mutex);
+			}
 		}
 	}
 	return NOTIFY_OK;
@@ -2834,12 +3215,17 @@ int kswapd_run(int nid)
 	if (pgdat->kswapd)
 		return 0;
 
+	pgdat->kswapd_threads[0].pgdat = pgdat;
 	pgdat->kswapd = kthread_run(kswapd, pgdat, "kswapd%d", nid);
 	if (IS_ERR(pgdat->kswapd)) {
 		/* failure at boot is fatal */
 		BUG_ON(system_state == SYSTEM_BOOTING);
 		printk("Failed to start kswapd on node %d\n",nid);
 		ret = -1;
+	} else {
+		pgdat->kswapd_threads[0].task = pgdat->kswapd;
+		pgdat->nr_kswapd_threads = 1;
+		kswapd_set_threads(pgdat, kswapd_threads);
 	}
 	return ret;
 }
@@ -2849,10 +3235,17 @@ int kswapd_run(int nid)
  */
 void kswapd_stop(int nid)
 {
-	struct task_struct *kswapd = NODE_DATA(nid)->kswapd;
+	pg_data_t *pgdat = NODE_DATA(nid);
+	struct task_struct *kswapd = pgdat->kswapd;
 
-	if (kswapd)
+	if (kswapd) {
+		kswapd_set_threads(pgdat, 1);
+		mutex_lock(&kswapd_threads_mutex);
 		kthread_stop(kswapd);
+		pgdat->kswapd = NULL;
+		pgdat->nr_kswapd_threads = 0;
+		mutex_unlock(&kswapd_threads_mutex);
+	}
 }
 
 static int __init kswapd_init(void)
@@ -3119,6 +3512,8 @@ int page_evictable(struct page *page, struct vm_area_struct *vma)
  */
 static void check_move_unevictable_page(struct page *page, struct zone *zone)
 {
+	struct lruvec *lruvec;
+
 	VM_BUG_ON(PageActive(page));
 
 retry:
@@ -3127,8 +3522,9 @@ retry:
 		enum lru_list l = page_lru_base_type(page);
 
 		__dec_zone_state(zone, NR_UNEVICTABLE);
-		list_move(&page->lru, &zone->lru[l].list);
-		mem_cgroup_move_lists(page, LRU_UNEVICTABLE, l);
+		lruvec = mem_cgroup_lru_move_lists(zone, page,
+						   LRU_UNEVICTABLE, l);
+		list_move(&page->lru, &lruvec->lists[l]);
 		__inc_zone_state(zone, NR_INACTIVE_ANON + l);
 		__count_vm_event(UNEVICTABLE_PGRESCUED);
 	} else {
@@ -3136,8 +3532,9 @@ retry:
 		 * rotate unevictable list
 		 */
 		SetPageUnevictable(page);
-		list_move(&page->lru, &zone->lru[LRU_UNEVICTABLE].list);
-		mem_cgroup_rotate_lru_list(page, LRU_UNEVICTABLE);
+		lruvec = mem_cgroup_lru_move_lists(zone, page, LRU_UNEVICTABLE,
+						   LRU_UNEVICTABLE);
+		list_move(&page->lru, &lruvec->lists[LRU_UNEVICTABLE]);
 		if (page_evictable(page, NULL))
 			goto retry;
 	}
@@ -3206,37 +3603,57 @@ void scan_mapping_unevictable_pages(struct address_space *mapping)
  * evictable.  Move those that have to @zone's inactive list where they
  * become candidates for reclaim, unless shrink_inactive_zone() decides
  * to reactivate them.  Pages that are still unevictable are rotated
- * back onto @zone's unevictable list.
+ * back onto @zone's unevictable list.  With the memory controller, the
+ * unevictable list of every cgroup in @zone is scanned.
  */
 #define SCAN_UNEVICTABLE_BATCH_SIZE 16UL /* arbitrary lock hold batch size */
 static void scan_zone_unevictable_pages(struct zone *zone)
 {
-	struct list_head *l_unevictable = &zone->lru[LRU_UNEVICTABLE].list;
-	unsigned long scan;
-	unsigned long nr_to_scan = zone_page_state(zone, NR_UNEVICTABLE);
+	struct mem_cgroup *mem;
+
+	mem = mem_cgroup_iter(NULL, NULL);
+	do {
+		struct lruvec *lruvec = mem_cgroup_zone_lruvec(zone, mem);
+		struct list_head *l_unevictable = &lruvec->lists[LRU_UNEVICTABLE];
+		unsigned long nr_to_scan;
+		unsigned long scan;
+
+		if (mem)
+			nr_to_scan = mem_cgroup_zone_nr_pages(mem, zone,
+							LRU_UNEVICTABLE);
+		else
+			nr_to_scan = zone_page_state(zone, NR_UNEVICTABLE);
 
-	while (nr_to_scan > 0) {
-		unsigned long batch_size = min(nr_to_scan,
+		while (nr_to_scan > 0) {
+			unsigned long batch_size = min(nr_to_scan,
 						SCAN_UNEVICTABLE_BATCH_SIZE);
 
-		spin_lock_irq(&zone->lru_lock);
-		for (scan = 0;  scan < batch_size; scan++) {
-			struct page *page = lru_to_page(l_unevictable);
+			spin_lock_irq(&zone->lru_lock);
+			for (scan = 0;  scan < batch_size; scan++) {
+				struct page *page;
 
-			if (!trylock_page(page))
-				continue;
+				if (list_empty(l_unevictable))
+					break;
+				page = lru_to_page(l_unevictable);
 
-			prefetchw_prev_lru_page(page, l_unevictable, flags);
+				if (!trylock_page(page))
+					continue;
 
-			if (likely(PageLRU(page) && PageUnevictable(page)))
-				check_move_unevictable_page(page, zone);
+				prefetchw_prev_lru_page(page, l_unevictable,
+							flags);
 
-			unlock_page(page);
-		}
-		spin_unlock_irq(&zone->lru_lock);
+				if (likely(PageLRU(page) &&
+					   PageUnevictable(page)))
+					check_move_unevictable_page(page, zone);
 
-		nr_to_scan -= batch_size;
-	}
+				unlock_page(page);
+			}
+			spin_unlock_irq(&zone->lru_lock);
+
+			nr_to_scan -= batch_size;
+		}
+		mem = mem_cgroup_iter(NULL, mem);
+	} while (mem);
 }
 
 
@@ -3327,3 +3744,72 @@ void scan_unevictable_unregister_node(struct node *node)
 	sysdev_remove_file(&node->sysdev, &attr_scan_unevictable_pages);
 }
 #endif
+
+#ifdef CONFIG_NUMA
+/*
+ * per node 'kswapd_threads' attribute: number of kswapd threads reclaiming
+ * the node, and 'kswapd_stat' showing the work done by each of them.
+ */
+static ssize_t read_kswapd_threads_node(struct sys_device *dev,
+					struct sysdev_attribute *attr,
+					char *buf)
+{
+	return sprintf(buf, "%d\n", NODE_DATA(dev->id)->nr_kswapd_threads);
+}
+
+static ssize_t write_kswapd_threads_node(struct sys_device *dev,
+					 struct sysdev_attribute *attr,
+					 const char *buf, size_t count)
+{
+	unsigned long nr;
+
+	if (strict_strtoul(buf, 10, &nr) || !nr || nr > MAX_KSWAPD_THREADS)
+		return -EINVAL;
+
+	if (!kswapd_set_threads(NODE_DATA(dev->id), nr))
+		return -ENODEV;
+	return count;
+}
+
+static SYSDEV_ATTR(kswapd_threads, S_IRUGO | S_IWUSR,
+			read_kswapd_threads_node,
+			write_kswapd_threads_node);
+
+static ssize_t read_kswapd_stat_node(struct sys_device *dev,
+				     struct sysdev_attribute *attr,
+				     char *buf)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	int n = 0;
+	int i;
+
+	mutex_lock(&kswapd_threads_mutex);
+	for (i = 0; i < pgdat->nr_kswapd_threads; i++) {
+		struct kswapd_thread *kt = &pgdat->kswapd_threads[i];
+
+		n += sprintf(buf + n, "%d %lu %lu %lu\n", i, kt->nr_runs,
+			     kt->nr_scanned, kt->nr_reclaimed);
+	}
+	mutex_unlock(&kswapd_threads_mutex);
+
+	return n;
+}
+
+static SYSDEV_ATTR(kswapd_stat, S_IRUGO, read_kswapd_stat_node, NULL);
+
+int kswapd_register_node(struct node *node)
+{
+	int ret;
+
+	ret = sysdev_create_file(&node->sysdev, &attr_kswapd_threads);
+	if (!ret)
+		ret = sysdev_create_file(&node->sysdev, &attr_kswapd_stat);
+	return ret;
+}
+
+void kswapd_unregister_node(struct node *node)
+{
+	sysdev_remove_file(&node->sysdev, &attr_kswapd_threads);
+	sysdev_remove_file(&node->sysdev, &attr_kswapd_stat);
+}
+#endif
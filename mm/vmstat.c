@@ -914,10 +914,25 @@ static const char * const vmstat_text[] = {
 	"kswapd_low_wmark_hit_quickly",
 	"kswapd_high_wmark_hit_quickly",
 	"kswapd_skip_congestion_wait",
+	"kswapd_helper_wake",
+	"kswapd_helper_steal",
 	"pageoutrun",
 	"allocstall",
 
 	"pgrotated",
+	"pglazyfreed",
+
+	"lru_lock_contended",
+	"lru_lock_break",
+	"file_ra_hit",
+	"file_ra_waste",
+	"file_ra_stride",
+	"file_ra_replay",
+
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+#endif
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -926,11 +941,26 @@ static const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
+	"compact_daemon_throttle",
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	"numa_pte_updates",
+	"numa_hint_faults",
+	"numa_hint_faults_local",
+	"numa_pages_migrated",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
 	"htlb_buddy_alloc_success",
 	"htlb_buddy_alloc_fail",
+#endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	"thp_shmem_alloc",
+	"thp_shmem_fallback",
+	"thp_shmem_pmd_mapped",
+	"thp_shmem_pmd_split",
+	"thp_shmem_collapse",
 #endif
 	"unevictable_pgs_culled",
 	"unevictable_pgs_scanned",
@@ -2780,21 +2780,18 @@ static void net_tx_action(struct softirq_action *h)
 	struct softnet_data *sd = &__get_cpu_var(softnet_data);
 
 	if (sd->completion_queue) {
-		struct sk_buff *clist;
+		struct sk_buff *clist, *skb;
 
 		local_irq_disable();
 		clist = sd->completion_queue;
 		sd->completion_queue = NULL;
 		local_irq_enable();
 
-		while (clist) {
-			struct sk_buff *skb = clist;
-			clist = clist->next;
-
+		for (skb = clist; skb; skb = skb->next) {
 			WARN_ON(atomic_read(&skb->users));
 			trace_kfree_skb(skb, net_tx_action);
-			__kfree_skb(skb);
 		}
+		__kfree_skb_list(clist);
 	}
 
 	if (sd->output_queue) {
@@ -0,0 +1,305 @@
+/*
+ * dl_latency.c - wakeup latency and deadline misses of periodic tasks
+ *
+ * Starts a number of periodic threads, each of which sleeps until the
+ * start of its next period, burns a fixed amount of cpu time and goes
+ * back to sleep.  For every activation we record how late the thread
+ * woke up and whether it finished its work before the end of its
+ * period.  The threads run under SCHED_DEADLINE by default, or under
+ * SCHED_FIFO with -f for comparison.  With -H a SCHED_FIFO hog that
+ * never sleeps is started on every cpu at a priority above the
+ * periodic threads, which starves a FIFO workload but only eats into
+ * the slack of a DEADLINE one.
+ *
+ * Build with "make", or "make STATIC=1" for a binary that can be
+ * dropped into a QEMU initramfs as is.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE		6
+#endif
+
+/*
+ * The numbers of this tree, not whatever the C library headers say:
+ * those may carry different numbers for the same calls.
+ */
+#if defined(__x86_64__)
+# define NR_sched_setattr	303
+#elif defined(__i386__)
+# define NR_sched_setattr	341
+#elif defined(__arm__)
+# define NR_sched_setattr	370
+#else
+# define NR_sched_setattr	264
+#endif
+
+#define NSEC_PER_USEC	1000ULL
+#define NSEC_PER_SEC	1000000000ULL
+
+struct sched_attr {
+	uint32_t size;
+	uint32_t sched_policy;
+	uint64_t sched_flags;
+	int32_t  sched_nice;
+	uint32_t sched_priority;
+	uint64_t sched_runtime;
+	uint64_t sched_deadline;
+	uint64_t sched_period;
+};
+
+static int sched_setattr(pid_t pid, const struct sched_attr *attr,
+			 unsigned int flags)
+{
+	return syscall(NR_sched_setattr, pid, attr, flags);
+}
+
+struct thread_stats {
+	pthread_t thread;
+	int id;
+	uint64_t activations;
+	uint64_t misses;
+	uint64_t lat_sum;
+	uint64_t lat_max;
+	int error;
+};
+
+static unsigned int nr_threads = 2;
+static uint64_t period_us = 10000;
+static uint64_t runtime_us = 2000;
+static uint64_t work_us = 1000;
+static unsigned int duration = 5;
+static int use_fifo;
+static int hog;
+static volatile int stop;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void ns_to_ts(uint64_t ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+/* spin for @ns of our own cpu time, not wall time */
+static void burn(uint64_t ns)
+{
+	struct timespec ts;
+	uint64_t start, t;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	start = ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+	do {
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		t = ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+	} while (t - start < ns);
+}
+
+static int set_policy(void)
+{
+	struct sched_attr attr;
+	struct sched_param sp;
+
+	if (use_fifo) {
+		sp.sched_priority = 50;
+		return sched_setscheduler(0, SCHED_FIFO, &sp);
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.sched_policy = SCHED_DEADLINE;
+	attr.sched_runtime = runtime_us * NSEC_PER_USEC;
+	attr.sched_deadline = period_us * NSEC_PER_USEC;
+	attr.sched_period = period_us * NSEC_PER_USEC;
+
+	return sched_setattr(0, &attr, 0);
+}
+
+static void *periodic_thread(void *arg)
+{
+	struct thread_stats *st = arg;
+	uint64_t period = period_us * NSEC_PER_USEC;
+	uint64_t next, lat, t;
+	struct timespec ts;
+
+	if (set_policy()) {
+		st->error = errno;
+		return NULL;
+	}
+
+	next = now_ns() + period;
+	while (!stop) {
+		ns_to_ts(next, &ts);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+		t = now_ns();
+		lat = t > next ? t - next : 0;
+		st->lat_sum += lat;
+		if (lat > st->lat_max)
+			st->lat_max = lat;
+
+		burn(work_us * NSEC_PER_USEC);
+
+		st->activations++;
+		next += period;
+		if (now_ns() > next) {
+			st->misses++;
+			/* don't try to catch up on the periods we lost */
+			while (next < now_ns())
+				next += period;
+		}
+	}
+
+	return NULL;
+}
+
+static void *hog_thread(void *arg)
+{
+	struct sched_param sp = { .sched_priority = 60 };
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET((long)arg, &mask);
+	sched_setaffinity(0, sizeof(mask), &mask);
+
+	if (sched_setscheduler(0, SCHED_FIFO, &sp))
+		return NULL;
+
+	while (!stop)
+		;
+
+	return NULL;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-n threads] [-p period_us] [-r runtime_us] "
+		"[-w work_us] [-d seconds] [-f] [-H]\n"
+		"  -f  run the threads as SCHED_FIFO instead of SCHED_DEADLINE\n"
+		"  -H  add a SCHED_FIFO cpu hog on every cpu\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct thread_stats *st;
+	pthread_t *hogs = NULL;
+	long nr_cpus = 0;
+	uint64_t act = 0, miss = 0, max = 0, sum = 0;
+	int opt, ret = 0;
+	long i;
+
+	while ((opt = getopt(argc, argv, "n:p:r:w:d:fH")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr_threads = atoi(optarg);
+			break;
+		case 'p':
+			period_us = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			runtime_us = strtoull(optarg, NULL, 0);
+			break;
+		case 'w':
+			work_us = strtoull(optarg, NULL, 0);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'f':
+			use_fifo = 1;
+			break;
+		case 'H':
+			hog = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!nr_threads || !period_us || runtime_us > period_us ||
+	    work_us > runtime_us)
+		usage(argv[0]);
+
+	st = calloc(nr_threads, sizeof(*st));
+	if (!st)
+		return 1;
+
+	if (hog) {
+		nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		hogs = calloc(nr_cpus, sizeof(*hogs));
+		if (!hogs)
+			return 1;
+		for (i = 0; i < nr_cpus; i++)
+			pthread_create(&hogs[i], NULL, hog_thread, (void *)i);
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		st[i].id = i;
+		pthread_create(&st[i].thread, NULL, periodic_thread, &st[i]);
+	}
+
+	sleep(duration);
+	stop = 1;
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(st[i].thread, NULL);
+	for (i = 0; i < nr_cpus; i++)
+		pthread_join(hogs[i], NULL);
+
+	printf("policy %s, %u threads, period %llu us, runtime %llu us, "
+	       "work %llu us%s\n", use_fifo ? "FIFO" : "DEADLINE", nr_threads,
+	       (unsigned long long)period_us, (unsigned long long)runtime_us,
+	       (unsigned long long)work_us, hog ? ", with hogs" : "");
+	printf("%6s %12s %8s %12s %12s\n",
+	       "thread", "activations", "misses", "avg lat(us)", "max lat(us)");
+
+	for (i = 0; i < nr_threads; i++) {
+		if (st[i].error) {
+			fprintf(stderr, "thread %ld: setting policy: %s\n",
+				i, strerror(st[i].error));
+			ret = 1;
+			continue;
+		}
+		printf("%6ld %12llu %8llu %12llu %12llu\n", i,
+		       (unsigned long long)st[i].activations,
+		       (unsigned long long)st[i].misses,
+		       (unsigned long long)(st[i].activations ?
+				st[i].lat_sum / st[i].activations / NSEC_PER_USEC : 0),
+		       (unsigned long long)(st[i].lat_max / NSEC_PER_USEC));
+		act += st[i].activations;
+		miss += st[i].misses;
+		sum += st[i].lat_sum;
+		if (st[i].lat_max > max)
+			max = st[i].lat_max;
+	}
+	printf("%6s %12llu %8llu %12llu %12llu\n", "total",
+	       (unsigned long long)act, (unsigned long long)miss,
+	       (unsigned long long)(act ? sum / act / NSEC_PER_USEC : 0),
+	       (unsigned long long)(max / NSEC_PER_USEC));
+
+	return ret;
+}
@@ -0,0 +1,204 @@
+/*
+ * numa_placement.c - watch automatic NUMA balancing move memory
+ *
+ * Faults in a buffer while running on the cpus of one node, then moves
+ * itself to the cpus of another node and keeps touching the buffer.
+ * Every second it prints how much of the buffer is on each of the two
+ * nodes (from move_pages(2) in query mode) and the numa_* counters from
+ * /proc/vmstat.  With CONFIG_NUMA_BALANCING the memory should follow
+ * the task to the second node; the exit status says whether at least
+ * half of it did.
+ *
+ * Needs two nodes with cpus; on an ordinary machine or in QEMU boot with
+ * numa=fake=2.  Build with "make", or "make STATIC=1" for an initramfs.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static unsigned long size_mb = 64;
+static unsigned int duration = 30;
+static int src_node = 0, dst_node = 1;
+
+static int node_cpus(int node, cpu_set_t *set)
+{
+	char path[64], buf[4096], *p;
+	FILE *f;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/node/node%d/cpulist", node);
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+	if (!fgets(buf, sizeof(buf), f)) {
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	CPU_ZERO(set);
+	p = buf;
+	while (*p && *p != '\n') {
+		long a, b;
+
+		a = b = strtol(p, &p, 10);
+		if (*p == '-')
+			b = strtol(p + 1, &p, 10);
+		for (; a <= b; a++)
+			CPU_SET(a, set);
+		if (*p == ',')
+			p++;
+	}
+
+	return CPU_COUNT(set) ? 0 : -1;
+}
+
+static void touch(char *buf, unsigned long len, long page_size)
+{
+	unsigned long i;
+
+	for (i = 0; i < len; i += page_size)
+		buf[i]++;
+}
+
+static void count_nodes(char *buf, unsigned long nr_pages, long page_size,
+			unsigned long *on_src, unsigned long *on_dst)
+{
+	void **pages = malloc(nr_pages * sizeof(*pages));
+	int *status = malloc(nr_pages * sizeof(*status));
+	unsigned long i;
+
+	*on_src = *on_dst = 0;
+	if (!pages || !status)
+		goto out;
+
+	for (i = 0; i < nr_pages; i++)
+		pages[i] = buf + i * page_size;
+	if (syscall(__NR_move_pages, 0, nr_pages, pages, NULL, status, 0))
+		goto out;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (status[i] == src_node)
+			(*on_src)++;
+		else if (status[i] == dst_node)
+			(*on_dst)++;
+	}
+out:
+	free(pages);
+	free(status);
+}
+
+static void print_vmstat(void)
+{
+	char line[128];
+	FILE *f = fopen("/proc/vmstat", "r");
+
+	if (!f)
+		return;
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, "numa_pte", 8) ||
+		    !strncmp(line, "numa_hint", 9) ||
+		    !strncmp(line, "numa_pages", 10)) {
+			line[strcspn(line, "\n")] = '\0';
+			printf("  %s", line);
+		}
+	}
+	fclose(f);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-m MB] [-d seconds] [-s src_node] "
+		"[-t dst_node]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long len, nr_pages, on_src, on_dst;
+	long page_size = sysconf(_SC_PAGESIZE);
+	cpu_set_t src_set, dst_set;
+	unsigned int t;
+	char *buf;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:d:s:t:")) != -1) {
+		switch (opt) {
+		case 'm':
+			size_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 's':
+			src_node = atoi(optarg);
+			break;
+		case 't':
+			dst_node = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!size_mb || src_node == dst_node)
+		usage(argv[0]);
+
+	if (node_cpus(src_node, &src_set) || node_cpus(dst_node, &dst_set)) {
+		fprintf(stderr, "need cpus on nodes %d and %d "
+			"(try booting with numa=fake=2)\n", src_node, dst_node);
+		return 1;
+	}
+
+	if (sched_setaffinity(0, sizeof(src_set), &src_set)) {
+		perror("sched_setaffinity");
+		return 1;
+	}
+
+	len = size_mb << 20;
+	nr_pages = len / page_size;
+	buf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	/* keep THP out of it, huge pmds are not sampled */
+	madvise(buf, len, MADV_NOHUGEPAGE);
+	memset(buf, 1, len);
+
+	if (sched_setaffinity(0, sizeof(dst_set), &dst_set)) {
+		perror("sched_setaffinity");
+		return 1;
+	}
+
+	for (t = 0; t <= duration; t++) {
+		time_t end = time(NULL) + 1;
+
+		count_nodes(buf, nr_pages, page_size, &on_src, &on_dst);
+		printf("%3us: node%d %6lu pages, node%d %6lu pages",
+		       t, src_node, on_src, dst_node, on_dst);
+		print_vmstat();
+		printf("\n");
+
+		if (t == duration)
+			break;
+		while (time(NULL) < end)
+			touch(buf, len, page_size);
+	}
+
+	return on_dst * 2 >= nr_pages ? 0 : 1;
+}